@@ -0,0 +1,288 @@
+#include "Animation.h"
+#include "AnimationLanes.h"
+
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <random>
+
+namespace Helpers
+{
+	namespace
+	{
+#if HELPERS_SSE2
+		// Dot product of all four lanes, broadcast to every lane
+		inline __m128 Dot4(__m128 a, __m128 b)
+		{
+			__m128 product{ _mm_mul_ps(a, b) };
+			__m128 shuffled{ _mm_shuffle_ps(product, product, _MM_SHUFFLE(2, 3, 0, 1)) };
+			__m128 sums{ _mm_add_ps(product, shuffled) };
+			shuffled = _mm_shuffle_ps(sums, sums, _MM_SHUFFLE(1, 0, 3, 2));
+			return _mm_add_ps(sums, shuffled);
+		}
+
+		inline __m128 LoadVec3(const glm::vec3& v) { return _mm_set_ps(0, v.z, v.y, v.x); }
+		inline __m128 LoadQuat(const glm::quat& q) { return _mm_set_ps(q.w, q.z, q.y, q.x); }
+
+		inline glm::vec3 StoreVec3(__m128 v)
+		{
+			alignas(16) float out[4];
+			_mm_store_ps(out, v);
+			return glm::vec3(out[0], out[1], out[2]);
+		}
+
+		inline glm::quat StoreQuat(__m128 v)
+		{
+			alignas(16) float out[4];
+			_mm_store_ps(out, v);
+			return glm::quat(out[3], out[0], out[1], out[2]);
+		}
+#endif
+
+		// Samples one track of one instance, keys are the track's three cursor keys
+		void SampleTrack(const NodeTrack& track, float time, unsigned int* keys, NodePose& pose)
+		{
+			if (!track.translations.empty())
+			{
+				const float blend{ KeyBlend(track.translationTimes, time, keys[0]) };
+				const unsigned int next{ std::min(keys[0] + 1, (unsigned int)track.translations.size() - 1) };
+				pose.translation = LerpVec3(track.translations[keys[0]], track.translations[next], blend);
+			}
+
+			if (!track.rotations.empty())
+			{
+				const float blend{ KeyBlend(track.rotationTimes, time, keys[1]) };
+				const unsigned int next{ std::min(keys[1] + 1, (unsigned int)track.rotations.size() - 1) };
+				pose.rotation = NlerpQuat(track.rotations[keys[1]], track.rotations[next], blend);
+			}
+
+			if (!track.scales.empty())
+			{
+				const float blend{ KeyBlend(track.scaleTimes, time, keys[2]) };
+				const unsigned int next{ std::min(keys[2] + 1, (unsigned int)track.scales.size() - 1) };
+				pose.scale = LerpVec3(track.scales[keys[2]], track.scales[next], blend);
+			}
+		}
+
+		// Samples one instance, poses has room for every track
+		void SampleInstance(const AnimationClip& clip, float time, AnimationCursor& cursor, NodePose* poses)
+		{
+			if (cursor.keys.size() != clip.tracks.size() * 3)
+				cursor.Reset(clip);
+
+			for (size_t t = 0; t < clip.tracks.size(); t++)
+				SampleTrack(clip.tracks[t], time, &cursor.keys[t * 3], poses[t]);
+		}
+
+#if HELPERS_SSE2
+		// A vec3 channel of one track for four instances
+		void SampleVec3Channel4(const std::vector<float>& keyTimes, const std::vector<glm::vec3>& values, const float* times,
+			AnimationCursor* cursors, size_t keyIndex, NodePose* poses, size_t posesPerInstance, glm::vec3 NodePose::* member)
+		{
+			unsigned int keys[4], nextKeys[4];
+			float blends[4];
+			KeyBlend4(keyTimes, times, cursors, keyIndex, keys, nextKeys, blends);
+
+			__m128 from[4], to[4];
+			for (int lane = 0; lane < 4; lane++)
+			{
+				from[lane] = LoadKey(values[keys[lane]]);
+				to[lane] = LoadKey(values[nextKeys[lane]]);
+			}
+			LerpVec3Lanes(from, to, blends, poses, posesPerInstance, member);
+		}
+
+		// The rotation channel of one track for four instances, the keys either side transposed into SoA form
+		void SampleQuatChannel4(const std::vector<float>& keyTimes, const std::vector<glm::quat>& values, const float* times,
+			AnimationCursor* cursors, size_t keyIndex, NodePose* poses, size_t posesPerInstance)
+		{
+			unsigned int keys[4], nextKeys[4];
+			float blends[4];
+			KeyBlend4(keyTimes, times, cursors, keyIndex, keys, nextKeys, blends);
+
+			__m128 from[4], to[4];
+			for (int lane = 0; lane < 4; lane++)
+			{
+				from[lane] = LoadKey(values[keys[lane]]);
+				to[lane] = LoadKey(values[nextKeys[lane]]);
+			}
+			_MM_TRANSPOSE4_PS(from[0], from[1], from[2], from[3]);
+			_MM_TRANSPOSE4_PS(to[0], to[1], to[2], to[3]);
+			NlerpQuatLanes(from, to, blends, poses, posesPerInstance);
+		}
+#endif
+	}
+
+	// Converts a playback time in seconds to ticks, wrapping so the clip loops
+	float AnimationClip::SecondsToTicks(float seconds) const
+	{
+		const float ticks{ seconds * ticksPerSecond };
+		if (duration <= 0)
+			return 0;
+
+		const float wrapped{ std::fmod(ticks, duration) };
+		return wrapped < 0 ? wrapped + duration : wrapped;
+	}
+
+	// Local transform: translate * rotate * scale
+	glm::mat4 NodePose::ToMatrix() const
+	{
+		glm::mat4 result{ glm::mat4_cast(rotation) };
+		result[0] *= scale.x;
+		result[1] *= scale.y;
+		result[2] *= scale.z;
+		result[3] = glm::vec4(translation, 1.0f);
+		return result;
+	}
+
+	// a + (b - a) * t
+	glm::vec3 LerpVec3(const glm::vec3& a, const glm::vec3& b, float t)
+	{
+#if HELPERS_SSE2
+		const __m128 va{ LoadVec3(a) };
+		return StoreVec3(_mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(LoadVec3(b), va), _mm_set1_ps(t))));
+#else
+		return a + (b - a) * t;
+#endif
+	}
+
+	// Normalised lerp along the shortest arc, close enough to slerp for neighbouring keys and much cheaper
+	glm::quat NlerpQuat(const glm::quat& a, const glm::quat& b, float t)
+	{
+#if HELPERS_SSE2
+		const __m128 qa{ LoadQuat(a) };
+		__m128 qb{ LoadQuat(b) };
+
+		// Flip b if needed so the blend takes the short way round
+		const __m128 negative{ _mm_cmplt_ps(Dot4(qa, qb), _mm_setzero_ps()) };
+		qb = _mm_xor_ps(qb, _mm_and_ps(negative, _mm_set1_ps(-0.0f)));
+
+		const __m128 blended{ _mm_add_ps(qa, _mm_mul_ps(_mm_sub_ps(qb, qa), _mm_set1_ps(t))) };
+		return StoreQuat(_mm_div_ps(blended, _mm_sqrt_ps(Dot4(blended, blended))));
+#else
+		glm::quat target{ b };
+		if (glm::dot(a, b) < 0)
+			target = -b;
+		return glm::normalize(a + (target - a) * t);
+#endif
+	}
+
+	// Samples every track of the clip at time (ticks)
+	void SampleClip(const AnimationClip& clip, float time, AnimationCursor& cursor, NodePose* poses)
+	{
+		SampleInstance(clip, time, cursor, poses);
+	}
+
+	// Samples count instances of the clip, each at its own time and with its own cursor
+	// With SSE2 four instances go at once in blocks (see SampleClipBlocks), the instances left over one at a time
+	void SampleClipBatch(const AnimationClip& clip, const float* times, AnimationCursor* cursors, size_t count, NodePose* poses)
+	{
+		const size_t posesPerInstance{ clip.tracks.size() };
+		size_t first{ 0 };
+
+#if HELPERS_SSE2
+		first = SampleClipBlocks(clip, cursors, count, poses, [&](size_t t, size_t group)
+		{
+			const NodeTrack& track{ clip.tracks[t] };
+			NodePose* groupPoses{ poses + group * posesPerInstance + t };
+			if (!track.translations.empty())
+				SampleVec3Channel4(track.translationTimes, track.translations, times + group, cursors + group, t * 3,
+					groupPoses, posesPerInstance, &NodePose::translation);
+			if (!track.rotations.empty())
+				SampleQuatChannel4(track.rotationTimes, track.rotations, times + group, cursors + group, t * 3 + 1,
+					groupPoses, posesPerInstance);
+			if (!track.scales.empty())
+				SampleVec3Channel4(track.scaleTimes, track.scales, times + group, cursors + group, t * 3 + 2,
+					groupPoses, posesPerInstance, &NodePose::scale);
+		});
+#endif
+
+		for (; first < count; first++)
+			SampleInstance(clip, times[first], cursors[first], poses + first * posesPerInstance);
+	}
+
+	// Times sampling a generated clip for many instances one instance at a time and as a batch
+	AnimationBenchmarkResult BenchmarkAnimation(size_t numInstances, size_t numTracks, size_t numKeys, int iterations)
+	{
+		AnimationBenchmarkResult result;
+		result.numInstances = numInstances;
+		result.numTracks = numTracks;
+		result.numKeys = numKeys;
+		if (numInstances == 0 || numTracks == 0 || numKeys < 2 || iterations <= 0)
+			return result;
+
+		// Fixed seed so runs are comparable, rotations random so some neighbouring keys take the short way round
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+		AnimationClip clip;
+		clip.duration = (float)(numKeys - 1);
+		clip.tracks.resize(numTracks);
+		for (NodeTrack& track : clip.tracks)
+		{
+			for (size_t key = 0; key < numKeys; key++)
+			{
+				track.translationTimes.push_back((float)key);
+				track.translations.push_back(glm::vec3(value(random), value(random), value(random)) * 10.0f);
+				track.rotationTimes.push_back((float)key);
+				track.rotations.push_back(glm::normalize(glm::quat(value(random), value(random), value(random), value(random))));
+				track.scaleTimes.push_back((float)key);
+				track.scales.push_back(glm::vec3(1.0f) + glm::vec3(value(random), value(random), value(random)) * 0.1f);
+			}
+		}
+
+		// Every instance at its own point in the clip, moving on a frame at 60Hz each iteration
+		std::uniform_real_distribution<float> start(0.0f, clip.duration);
+		std::vector<float> times(numInstances);
+		for (float& time : times)
+			time = start(random);
+
+		const auto milliseconds{ [&](auto&& sample)
+		{
+			std::vector<AnimationCursor> cursors(numInstances);
+			std::vector<float> frameTimes(numInstances);
+			double fastest{ std::numeric_limits<double>::max() };
+			for (int i = 0; i < iterations; i++)
+			{
+				for (size_t instance = 0; instance < numInstances; instance++)
+					frameTimes[instance] = clip.SecondsToTicks(times[instance] / clip.ticksPerSecond + i / 60.0f);
+				const auto begin{ std::chrono::high_resolution_clock::now() };
+				sample(frameTimes.data(), cursors.data());
+				fastest = std::min(fastest, std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count());
+			}
+			return fastest;
+		} };
+
+		std::vector<NodePose> loopPoses(numInstances * numTracks);
+		std::vector<NodePose> batchPoses(numInstances * numTracks);
+		result.loopMilliseconds = milliseconds([&](const float* frameTimes, AnimationCursor* cursors) {
+			for (size_t instance = 0; instance < numInstances; instance++)
+				SampleClip(clip, frameTimes[instance], cursors[instance], &loopPoses[instance * numTracks]);
+		});
+		result.batchMilliseconds = milliseconds([&](const float* frameTimes, AnimationCursor* cursors) {
+			SampleClipBatch(clip, frameTimes, cursors, numInstances, batchPoses.data());
+		});
+
+		// Both ran the same frames, so the last frame's poses should agree
+		for (size_t pose = 0; pose < loopPoses.size(); pose++)
+		{
+			const NodePose& a{ loopPoses[pose] };
+			const NodePose& b{ batchPoses[pose] };
+			result.maxDifference = std::max({ result.maxDifference, glm::length(a.translation - b.translation),
+				glm::length(glm::vec4(a.rotation.x, a.rotation.y, a.rotation.z, a.rotation.w) - glm::vec4(b.rotation.x, b.rotation.y, b.rotation.z, b.rotation.w)),
+				glm::length(a.scale - b.scale) });
+		}
+
+		return result;
+	}
+
+	// Writes sampled poses into the hierarchy's local transforms
+	void ApplyPoses(const AnimationClip& clip, const NodePose* poses, NodeHierarchy& hierarchy)
+	{
+		for (size_t t = 0; t < clip.tracks.size(); t++)
+		{
+			const int node{ clip.tracks[t].nodeIndex };
+			if (node >= 0 && (size_t)node < hierarchy.Size())
+				hierarchy.localTransforms[node] = poses[t].ToMatrix();
+		}
+	}
+}
@@ -0,0 +1,155 @@
+#pragma once
+// Keyframe animation clips and the sampler that evaluates them
+
+#include "ExternalLibraryHeaders.h"
+#include "NodeHierarchy.h"
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+
+namespace Helpers
+{
+	// Keyframes for one node. Translation, rotation and scale are separate tracks as each can have its own key times.
+	struct NodeTrack
+	{
+		// Index into the model's NodeHierarchy
+		int nodeIndex{ NodeHierarchy::kInvalidNode };
+
+		std::vector<float> translationTimes;
+		std::vector<glm::vec3> translations;
+
+		std::vector<float> rotationTimes;
+		std::vector<glm::quat> rotations;
+
+		std::vector<float> scaleTimes;
+		std::vector<glm::vec3> scales;
+	};
+
+	// One animation, times are in ticks
+	struct AnimationClip
+	{
+		std::string name;
+		float duration{ 0 };
+		float ticksPerSecond{ 25.0f };
+		std::vector<NodeTrack> tracks;
+
+		// Converts a playback time in seconds to ticks, wrapping so the clip loops
+		float SecondsToTicks(float seconds) const;
+	};
+
+	// The sampled state of one node
+	struct NodePose
+	{
+		glm::vec3 translation{ 0 };
+		glm::quat rotation{ 1, 0, 0, 0 };
+		glm::vec3 scale{ 1 };
+
+		// Local transform: translate * rotate * scale
+		glm::mat4 ToMatrix() const;
+	};
+
+	// Per instance playback state, the key each track was last sampled from
+	// Playing forwards the next sample almost always starts from the same or the next key
+	struct AnimationCursor
+	{
+		// Three per track: translation, rotation, scale
+		std::vector<unsigned int> keys;
+
+		// Sizes the cursor for the clip (raw or compressed) and rewinds it
+		template<typename Clip>
+		void Reset(const Clip& clip) { keys.assign(clip.tracks.size() * 3, 0); }
+	};
+
+	// Finds k with times[k] <= time < times[k + 1], starting from hint.
+	// Amortised O(1) when time moves forwards a little each call, falls back to a binary search otherwise.
+	// TimeType is float for raw clips and the quantised integer time for compressed ones.
+	template<typename TimeType>
+	unsigned int FindKey(const std::vector<TimeType>& times, float time, unsigned int hint)
+	{
+		if (times.size() < 2)
+			return 0;
+
+		const unsigned int lastKey{ (unsigned int)times.size() - 2 };
+		if (hint > lastKey)
+			hint = lastKey;
+
+		// Playing forwards the answer is nearly always the hint or a key or two on
+		if (time >= times[hint])
+		{
+			const unsigned int kMaxSteps{ 4 };
+			for (unsigned int step = 0; step < kMaxSteps; step++)
+			{
+				if (hint == lastKey || time < times[hint + 1])
+					return hint;
+				hint++;
+			}
+		}
+
+		// Jumped backwards (e.g. looped) or a long way forwards
+		const auto upper{ std::upper_bound(times.begin(), times.end(), time,
+			[](float value, TimeType key) { return value < (float)key; }) };
+		if (upper == times.begin())
+			return 0;
+
+		return std::min((unsigned int)(upper - times.begin()) - 1, lastKey);
+	}
+
+	// Updates cursor to the key before time and returns the blend factor towards the next key
+	template<typename TimeType>
+	float KeyBlend(const std::vector<TimeType>& times, float time, unsigned int& cursor)
+	{
+		cursor = FindKey(times, time, cursor);
+		if (cursor + 1 >= times.size())
+			return 0;
+
+		const float span{ (float)times[cursor + 1] - (float)times[cursor] };
+		if (span <= 0)
+			return 0;
+
+		return std::min(std::max((time - (float)times[cursor]) / span, 0.0f), 1.0f);
+	}
+
+	// a + (b - a) * t
+	glm::vec3 LerpVec3(const glm::vec3& a, const glm::vec3& b, float t);
+
+	// Normalised lerp along the shortest arc, close enough to slerp for neighbouring keys and much cheaper
+	glm::quat NlerpQuat(const glm::quat& a, const glm::quat& b, float t);
+
+	// Samples every track of the clip at time (ticks). poses must have room for one pose per track.
+	void SampleClip(const AnimationClip& clip, float time, AnimationCursor& cursor, NodePose* poses);
+
+	// Samples count instances of the clip, each at its own time and with its own cursor
+	// poses receives clip.tracks.size() poses per instance, instance by instance. With SSE2 the batch goes a track at a
+	// time, four instances at once.
+	void SampleClipBatch(const AnimationClip& clip, const float* times, AnimationCursor* cursors, size_t count, NodePose* poses);
+
+	struct AnimationBenchmarkResult
+	{
+		size_t numInstances{ 0 };
+		size_t numTracks{ 0 };
+		size_t numKeys{ 0 };
+
+		// Per frame, every instance sampled
+		double loopMilliseconds{ 0 };
+		double batchMilliseconds{ 0 };
+
+		// Largest difference between the two in any translation, rotation or scale
+		float maxDifference{ 0 };
+
+		// The batch gives the same poses as sampling an instance at a time
+		bool Passed() const { return maxDifference <= 1e-5f; }
+
+		std::string ToString() const {
+			return "Sampling " + std::to_string(numInstances) + " instances of " + std::to_string(numTracks) + " tracks, " +
+				std::to_string(numKeys) + " keys. Per instance: " + std::to_string(loopMilliseconds) + " ms Batch: " +
+				std::to_string(batchMilliseconds) + " ms Max difference: " + std::to_string(maxDifference) + (Passed() ? " PASS" : " FAIL");
+		}
+	};
+
+	// Times sampling a generated clip for numInstances instances one instance at a time and with SampleClipBatch
+	AnimationBenchmarkResult BenchmarkAnimation(size_t numInstances = 4096, size_t numTracks = 64, size_t numKeys = 240, int iterations = 20);
+
+	// Writes sampled poses into the hierarchy's local transforms. Call UpdateWorldTransforms afterwards.
+	void ApplyPoses(const AnimationClip& clip, const NodePose* poses, NodeHierarchy& hierarchy);
+}
@@ -0,0 +1,678 @@
+#include "AnimationCompression.h"
+#include "AnimationLanes.h"
+
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <random>
+
+namespace Helpers
+{
+	namespace
+	{
+		const float kQuantisedTimeMax{ 65535.0f };
+		const float kQuantisedValueMax{ 65535.0f };
+
+		// Smallest three components lie in [-1/sqrt(2), 1/sqrt(2)]
+		const float kSmallestThreeRange{ 0.70710678f };
+		const float kSmallestThreeMax{ 32767.0f };
+
+		// Longest run of keys one segment may replace, keeps reduction linear on long smooth captures
+		const size_t kMaxSegmentKeys{ 256 };
+
+		// Angle between two unit quaternions. acos of the dot product has no precision left at the small angles of interest.
+		float QuatAngle(const glm::quat& a, const glm::quat& b)
+		{
+			const glm::quat difference{ glm::conjugate(a) * b };
+			const float sine{ glm::length(glm::vec3(difference.x, difference.y, difference.z)) };
+			return 2.0f * std::atan2(sine, std::abs(difference.w));
+		}
+
+		float MaxAxisDifference(const glm::vec3& a, const glm::vec3& b)
+		{
+			const glm::vec3 d{ glm::abs(a - b) };
+			return std::max(d.x, std::max(d.y, d.z));
+		}
+
+		// Indices of the keys to keep. A key is dropped when interpolating between its kept neighbours
+		// lands within tolerance of it and of every other key dropped between them.
+		template<typename T, typename Interpolate, typename Distance>
+		std::vector<size_t> ReduceKeys(const std::vector<float>& times, const std::vector<T>& values, float tolerance,
+			Interpolate interpolate, Distance distance)
+		{
+			std::vector<size_t> kept;
+			if (values.empty())
+				return kept;
+
+			kept.push_back(0);
+
+			// A track that never moves only needs one key
+			bool constant{ true };
+			for (size_t i = 1; i < values.size() && constant; i++)
+				constant = distance(values[i], values[0]) <= tolerance;
+			if (constant)
+				return kept;
+
+			size_t anchor{ 0 };
+			for (size_t candidate = 2; candidate < values.size(); candidate++)
+			{
+				bool fits{ candidate - anchor <= kMaxSegmentKeys };
+				const float span{ times[candidate] - times[anchor] };
+				for (size_t k = anchor + 1; k < candidate && fits; k++)
+				{
+					const float t{ span > 0 ? (times[k] - times[anchor]) / span : 0.0f };
+					fits = distance(interpolate(values[anchor], values[candidate], t), values[k]) <= tolerance;
+				}
+
+				// The key before the candidate cannot be dropped, it becomes the start of the next segment
+				if (!fits)
+				{
+					anchor = candidate - 1;
+					kept.push_back(anchor);
+				}
+			}
+
+			kept.push_back(values.size() - 1);
+			return kept;
+		}
+
+		// Picks the ticks to QuantisedTime scale for a clip
+		float ChooseTimeScale(const AnimationClip& clip)
+		{
+			if (clip.duration <= 0)
+				return 0;
+
+			std::vector<float> times;
+			for (const NodeTrack& track : clip.tracks)
+			{
+				times.insert(times.end(), track.translationTimes.begin(), track.translationTimes.end());
+				times.insert(times.end(), track.rotationTimes.begin(), track.rotationTimes.end());
+				times.insert(times.end(), track.scaleTimes.begin(), track.scaleTimes.end());
+			}
+			std::sort(times.begin(), times.end());
+			times.erase(std::unique(times.begin(), times.end()), times.end());
+
+			// Captured and baked animation usually has a key every frame, if so store the frame number
+			float step{ clip.duration };
+			for (size_t i = 1; i < times.size(); i++)
+				step = std::min(step, times[i] - times[i - 1]);
+
+			bool onGrid{ step > 0 && clip.duration / step <= kQuantisedTimeMax };
+			for (size_t i = 0; i < times.size() && onGrid; i++)
+			{
+				const float frame{ times[i] / step };
+				onGrid = std::abs(frame - std::round(frame)) < 0.001f;
+			}
+
+			return onGrid ? 1.0f / step : kQuantisedTimeMax / clip.duration;
+		}
+
+		QuantisedTime QuantiseTime(float time, float timeScale)
+		{
+			const float scaled{ std::min(std::max(time * timeScale, 0.0f), kQuantisedTimeMax) };
+			return (QuantisedTime)std::lround(scaled);
+		}
+
+		uint16_t QuantiseUnit(float value, float minimum, float extent)
+		{
+			if (extent <= 0)
+				return 0;
+			const float fraction{ std::min(std::max((value - minimum) / extent, 0.0f), 1.0f) };
+			return (uint16_t)std::lround(fraction * kQuantisedValueMax);
+		}
+
+		QuantisedVec3Track QuantiseVec3Track(const std::vector<float>& times, const std::vector<glm::vec3>& values,
+			const std::vector<size_t>& kept, float timeScale)
+		{
+			QuantisedVec3Track track;
+			if (kept.empty())
+				return track;
+
+			glm::vec3 maximum{ values[kept[0]] };
+			track.rangeMin = maximum;
+			for (size_t k : kept)
+			{
+				track.rangeMin = glm::min(track.rangeMin, values[k]);
+				maximum = glm::max(maximum, values[k]);
+			}
+			track.rangeExtent = maximum - track.rangeMin;
+
+			track.times.reserve(kept.size());
+			track.values.reserve(kept.size() * 3);
+			for (size_t k : kept)
+			{
+				track.times.push_back(QuantiseTime(times[k], timeScale));
+				for (int c = 0; c < 3; c++)
+					track.values.push_back(QuantiseUnit(values[k][c], track.rangeMin[c], track.rangeExtent[c]));
+			}
+
+			return track;
+		}
+
+		QuantisedQuatTrack QuantiseQuatTrack(const std::vector<float>& times, const std::vector<glm::quat>& values,
+			const std::vector<size_t>& kept, float timeScale)
+		{
+			QuantisedQuatTrack track;
+			track.times.reserve(kept.size());
+			track.values.reserve(kept.size() * 3);
+
+			for (size_t k : kept)
+			{
+				track.times.push_back(QuantiseTime(times[k], timeScale));
+
+				const glm::quat q{ glm::normalize(values[k]) };
+				const float components[4]{ q.x, q.y, q.z, q.w };
+
+				unsigned int largest{ 0 };
+				for (unsigned int c = 1; c < 4; c++)
+					if (std::abs(components[c]) > std::abs(components[largest]))
+						largest = c;
+
+				// q and -q are the same rotation, pick the one with a positive largest component so it can be rebuilt
+				const float sign{ components[largest] < 0 ? -1.0f : 1.0f };
+
+				uint16_t packed[3];
+				unsigned int slot{ 0 };
+				for (unsigned int c = 0; c < 4; c++)
+				{
+					if (c == largest)
+						continue;
+					const float fraction{ (components[c] * sign + kSmallestThreeRange) / (2.0f * kSmallestThreeRange) };
+					packed[slot++] = (uint16_t)std::lround(std::min(std::max(fraction, 0.0f), 1.0f) * kSmallestThreeMax);
+				}
+
+				packed[0] |= (uint16_t)((largest & 1) << 15);
+				packed[1] |= (uint16_t)((largest >> 1) << 15);
+				track.values.insert(track.values.end(), packed, packed + 3);
+			}
+
+			return track;
+		}
+
+		// Decodes every kept key and compares it with the source. If any is further out than tolerance, 16 bits are
+		// too few for the track's range and its keys are stored at full precision instead. True if that happened.
+		template<typename Track, typename T, typename Distance>
+		bool KeepExactIfOutOfTolerance(Track& track, const std::vector<T>& values, const std::vector<size_t>& kept,
+			float tolerance, Distance distance)
+		{
+			bool fits{ true };
+			for (size_t i = 0; i < kept.size() && fits; i++)
+				fits = distance(track.Decode(i), values[kept[i]]) <= tolerance;
+			if (fits)
+				return false;
+
+			track.values.clear();
+			track.exact.reserve(kept.size());
+			for (size_t k : kept)
+				track.exact.push_back(values[k]);
+			return true;
+		}
+
+		// Decoded key pair and blend for one compressed track, mirrors the raw sampler
+		template<typename Track>
+		bool CompressedBlend(const Track& track, float quantisedTime, unsigned int& cursor, size_t& next, float& blend)
+		{
+			if (track.empty())
+				return false;
+
+			blend = KeyBlend(track.times, quantisedTime, cursor);
+			next = std::min((size_t)cursor + 1, track.size() - 1);
+			return true;
+		}
+
+		void SampleInstance(const CompressedClip& clip, float time, AnimationCursor& cursor, NodePose* poses)
+		{
+			if (cursor.keys.size() != clip.tracks.size() * 3)
+				cursor.Reset(clip);
+
+			const float quantisedTime{ time * clip.timeScale };
+
+			for (size_t t = 0; t < clip.tracks.size(); t++)
+			{
+				const CompressedTrack& track{ clip.tracks[t] };
+				NodePose& pose{ poses[t] };
+				unsigned int* keys{ &cursor.keys[t * 3] };
+
+				size_t next;
+				float blend;
+				if (CompressedBlend(track.translations, quantisedTime, keys[0], next, blend))
+					pose.translation = LerpVec3(track.translations.Decode(keys[0]), track.translations.Decode(next), blend);
+
+				if (CompressedBlend(track.rotations, quantisedTime, keys[1], next, blend))
+					pose.rotation = NlerpQuat(track.rotations.Decode(keys[1]), track.rotations.Decode(next), blend);
+
+				if (CompressedBlend(track.scales, quantisedTime, keys[2], next, blend))
+					pose.scale = LerpVec3(track.scales.Decode(keys[2]), track.scales.Decode(next), blend);
+			}
+		}
+
+#if HELPERS_SSE2
+		// Keys from a full precision track, a register per lane
+		template<typename T>
+		void LoadExactKeys(const std::vector<T>& exact, const unsigned int* keys, __m128* out)
+		{
+			for (int lane = 0; lane < 4; lane++)
+				out[lane] = LoadKey(exact[keys[lane]]);
+		}
+
+		// Four keys of a vec3 track as QuantisedVec3Track::Decode gives them, a register per lane
+		void DecodeVec3Keys(const QuantisedVec3Track& track, const unsigned int* keys, __m128* out)
+		{
+			if (!track.exact.empty())
+			{
+				LoadExactKeys(track.exact, keys, out);
+				return;
+			}
+
+			const __m128 rangeMin{ LoadKey(track.rangeMin) };
+			const __m128 rangeExtent{ LoadKey(track.rangeExtent) };
+			const __m128 scale{ _mm_set1_ps(1.0f / kQuantisedValueMax) };
+			for (int lane = 0; lane < 4; lane++)
+			{
+				const uint16_t* packed{ &track.values[keys[lane] * 3] };
+				const __m128 value{ _mm_cvtepi32_ps(_mm_setr_epi32(packed[0], packed[1], packed[2], 0)) };
+				out[lane] = _mm_add_ps(rangeMin, _mm_mul_ps(_mm_mul_ps(rangeExtent, value), scale));
+			}
+		}
+
+		// Picks a where mask is set and b elsewhere
+		inline __m128 Select(__m128 mask, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+		// Four keys of a rotation track in SoA form, out[c] holding component c (x, y, z, w) of every lane. Smallest three
+		// keys are rebuilt four at once, each lane's missing component put back in its place with masks rather than a branch.
+		// Same arithmetic as QuantisedQuatTrack::Decode so the keys match it to the bit.
+		void DecodeQuatKeys(const QuantisedQuatTrack& track, const unsigned int* keys, __m128 (&out)[4])
+		{
+			if (!track.exact.empty())
+			{
+				LoadExactKeys(track.exact, keys, out);
+				_MM_TRANSPOSE4_PS(out[0], out[1], out[2], out[3]);
+				return;
+			}
+
+			alignas(16) int packed[3][4];
+			for (int lane = 0; lane < 4; lane++)
+			{
+				const uint16_t* values{ &track.values[keys[lane] * 3] };
+				for (int slot = 0; slot < 3; slot++)
+					packed[slot][lane] = values[slot];
+			}
+
+			const __m128i first{ _mm_load_si128((const __m128i*)packed[0]) };
+			const __m128i second{ _mm_load_si128((const __m128i*)packed[1]) };
+			const __m128i largest{ _mm_or_si128(_mm_srli_epi32(first, 15), _mm_slli_epi32(_mm_srli_epi32(second, 15), 1)) };
+
+			const __m128i lowBits{ _mm_set1_epi32(0x7fff) };
+			const __m128 range{ _mm_set1_ps(kSmallestThreeRange) };
+			__m128 slots[3];
+			__m128 sumSquares{ _mm_setzero_ps() };
+			for (int slot = 0; slot < 3; slot++)
+			{
+				const __m128i bits{ _mm_and_si128(_mm_load_si128((const __m128i*)packed[slot]), lowBits) };
+				const __m128 fraction{ _mm_mul_ps(_mm_cvtepi32_ps(bits), _mm_set1_ps(1.0f / kSmallestThreeMax)) };
+				slots[slot] = _mm_sub_ps(_mm_mul_ps(_mm_mul_ps(fraction, _mm_set1_ps(2.0f)), range), range);
+				sumSquares = _mm_add_ps(sumSquares, _mm_mul_ps(slots[slot], slots[slot]));
+			}
+			const __m128 rebuilt{ _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(_mm_set1_ps(1.0f), sumSquares), _mm_setzero_ps())) };
+
+			// Components before the missing one are in the slot of the same number, those after it a slot down
+			__m128 missing[4];
+			for (int c = 0; c < 4; c++)
+				missing[c] = _mm_castsi128_ps(_mm_cmpeq_epi32(largest, _mm_set1_epi32(c)));
+			out[0] = Select(missing[0], rebuilt, slots[0]);
+			out[1] = Select(missing[1], rebuilt, Select(missing[0], slots[0], slots[1]));
+			out[2] = Select(missing[2], rebuilt, Select(missing[3], slots[2], slots[1]));
+			out[3] = Select(missing[3], rebuilt, slots[2]);
+		}
+
+		// One track of four instances, times already in QuantisedTime units
+		void SampleTrack4(const CompressedTrack& track, const float* quantisedTimes, AnimationCursor* cursors, size_t keyIndex,
+			NodePose* poses, size_t posesPerInstance)
+		{
+			unsigned int keys[4], nextKeys[4];
+			float blends[4];
+			__m128 from[4], to[4];
+
+			if (!track.translations.empty())
+			{
+				KeyBlend4(track.translations.times, quantisedTimes, cursors, keyIndex, keys, nextKeys, blends);
+				DecodeVec3Keys(track.translations, keys, from);
+				DecodeVec3Keys(track.translations, nextKeys, to);
+				LerpVec3Lanes(from, to, blends, poses, posesPerInstance, &NodePose::translation);
+			}
+
+			if (!track.rotations.empty())
+			{
+				KeyBlend4(track.rotations.times, quantisedTimes, cursors, keyIndex + 1, keys, nextKeys, blends);
+				DecodeQuatKeys(track.rotations, keys, from);
+				DecodeQuatKeys(track.rotations, nextKeys, to);
+				NlerpQuatLanes(from, to, blends, poses, posesPerInstance);
+			}
+
+			if (!track.scales.empty())
+			{
+				KeyBlend4(track.scales.times, quantisedTimes, cursors, keyIndex + 2, keys, nextKeys, blends);
+				DecodeVec3Keys(track.scales, keys, from);
+				DecodeVec3Keys(track.scales, nextKeys, to);
+				LerpVec3Lanes(from, to, blends, poses, posesPerInstance, &NodePose::scale);
+			}
+		}
+#endif
+
+		template<typename Track>
+		size_t TrackBytes(const Track& track)
+		{
+			return track.times.size() * sizeof(QuantisedTime) + track.values.size() * sizeof(uint16_t) +
+				track.exact.size() * sizeof(*track.exact.data());
+		}
+
+		// Samples both clips at every key time and halfway between, recording the worst difference
+		void MeasureError(const AnimationClip& source, const CompressedClip& compressed, ClipCompressionReport& report)
+		{
+			std::vector<float> sampleTimes;
+			for (const NodeTrack& track : source.tracks)
+			{
+				sampleTimes.insert(sampleTimes.end(), track.translationTimes.begin(), track.translationTimes.end());
+				sampleTimes.insert(sampleTimes.end(), track.rotationTimes.begin(), track.rotationTimes.end());
+				sampleTimes.insert(sampleTimes.end(), track.scaleTimes.begin(), track.scaleTimes.end());
+			}
+			std::sort(sampleTimes.begin(), sampleTimes.end());
+			sampleTimes.erase(std::unique(sampleTimes.begin(), sampleTimes.end()), sampleTimes.end());
+
+			const size_t numKeyTimes{ sampleTimes.size() };
+			for (size_t i = 1; i < numKeyTimes; i++)
+				sampleTimes.push_back((sampleTimes[i - 1] + sampleTimes[i]) * 0.5f);
+			std::sort(sampleTimes.begin(), sampleTimes.end());
+
+			AnimationCursor sourceCursor;
+			AnimationCursor compressedCursor;
+			std::vector<NodePose> sourcePoses(source.tracks.size());
+			std::vector<NodePose> compressedPoses(compressed.tracks.size());
+
+			for (float time : sampleTimes)
+			{
+				SampleClip(source, time, sourceCursor, sourcePoses.data());
+				SampleClip(compressed, time, compressedCursor, compressedPoses.data());
+
+				for (size_t t = 0; t < sourcePoses.size(); t++)
+				{
+					report.maxTranslationError = std::max(report.maxTranslationError,
+						glm::length(sourcePoses[t].translation - compressedPoses[t].translation));
+					report.maxRotationError = std::max(report.maxRotationError,
+						QuatAngle(sourcePoses[t].rotation, compressedPoses[t].rotation));
+					report.maxScaleError = std::max(report.maxScaleError,
+						MaxAxisDifference(sourcePoses[t].scale, compressedPoses[t].scale));
+				}
+			}
+		}
+	}
+
+	glm::vec3 QuantisedVec3Track::Decode(size_t key) const
+	{
+		if (!exact.empty())
+			return exact[key];
+
+		const uint16_t* packed{ &values[key * 3] };
+		return rangeMin + rangeExtent * glm::vec3(packed[0], packed[1], packed[2]) * (1.0f / kQuantisedValueMax);
+	}
+
+	glm::quat QuantisedQuatTrack::Decode(size_t key) const
+	{
+		if (!exact.empty())
+			return exact[key];
+
+		const uint16_t* packed{ &values[key * 3] };
+		const unsigned int largest{ (unsigned int)((packed[0] >> 15) | ((packed[1] >> 15) << 1)) };
+
+		float components[4];
+		float sumSquares{ 0 };
+		unsigned int slot{ 0 };
+		for (unsigned int c = 0; c < 4; c++)
+		{
+			if (c == largest)
+				continue;
+			const float fraction{ (packed[slot++] & 0x7fff) * (1.0f / kSmallestThreeMax) };
+			components[c] = fraction * 2.0f * kSmallestThreeRange - kSmallestThreeRange;
+			sumSquares += components[c] * components[c];
+		}
+		components[largest] = std::sqrt(std::max(1.0f - sumSquares, 0.0f));
+
+		return glm::quat(components[3], components[0], components[1], components[2]);
+	}
+
+	// Converts a playback time in seconds to ticks, wrapping so the clip loops
+	float CompressedClip::SecondsToTicks(float seconds) const
+	{
+		const float ticks{ seconds * ticksPerSecond };
+		if (duration <= 0)
+			return 0;
+
+		const float wrapped{ std::fmod(ticks, duration) };
+		return wrapped < 0 ? wrapped + duration : wrapped;
+	}
+
+	// Bytes held by the clip's tracks
+	size_t CompressedClip::MemoryBytes() const
+	{
+		size_t bytes{ tracks.size() * sizeof(CompressedTrack) };
+		for (const CompressedTrack& track : tracks)
+			bytes += TrackBytes(track.translations) + TrackBytes(track.rotations) + TrackBytes(track.scales);
+		return bytes;
+	}
+
+	// Same as the raw byte size of the clip, for comparison with CompressedClip::MemoryBytes
+	size_t ClipMemoryBytes(const AnimationClip& clip)
+	{
+		size_t bytes{ clip.tracks.size() * sizeof(NodeTrack) };
+		for (const NodeTrack& track : clip.tracks)
+		{
+			bytes += (track.translationTimes.size() + track.rotationTimes.size() + track.scaleTimes.size()) * sizeof(float);
+			bytes += (track.translations.size() + track.scales.size()) * sizeof(glm::vec3);
+			bytes += track.rotations.size() * sizeof(glm::quat);
+		}
+		return bytes;
+	}
+
+	// Compresses the clip
+	CompressedClip CompressClip(const AnimationClip& clip, const ClipCompressionSettings& settings, ClipCompressionReport* report)
+	{
+		CompressedClip result;
+		result.name = clip.name;
+		result.duration = clip.duration;
+		result.ticksPerSecond = clip.ticksPerSecond;
+		result.timeScale = ChooseTimeScale(clip);
+		result.tracks.reserve(clip.tracks.size());
+
+		// Tolerances are split so quantisation has some room too
+		const float kReductionShare{ 0.75f };
+		const float quantisationShare{ 1.0f - kReductionShare };
+
+		const auto lerp{ [](const glm::vec3& a, const glm::vec3& b, float t) { return a + (b - a) * t; } };
+		const auto translationDistance{ [](const glm::vec3& a, const glm::vec3& b) { return glm::length(a - b); } };
+
+		for (const NodeTrack& source : clip.tracks)
+		{
+			result.tracks.push_back(CompressedTrack());
+			CompressedTrack& track{ result.tracks.back() };
+			track.nodeIndex = source.nodeIndex;
+
+			const std::vector<size_t> translationKeys{ ReduceKeys(source.translationTimes, source.translations,
+				settings.translationTolerance * kReductionShare, lerp, translationDistance) };
+			track.translations = QuantiseVec3Track(source.translationTimes, source.translations, translationKeys, result.timeScale);
+			size_t exactTracks{ KeepExactIfOutOfTolerance(track.translations, source.translations, translationKeys,
+				settings.translationTolerance * quantisationShare, translationDistance) ? 1u : 0u };
+
+			const std::vector<size_t> rotationKeys{ ReduceKeys(source.rotationTimes, source.rotations,
+				settings.rotationTolerance * kReductionShare, NlerpQuat, QuatAngle) };
+			track.rotations = QuantiseQuatTrack(source.rotationTimes, source.rotations, rotationKeys, result.timeScale);
+			if (KeepExactIfOutOfTolerance(track.rotations, source.rotations, rotationKeys, settings.rotationTolerance * quantisationShare, QuatAngle))
+				exactTracks++;
+
+			const std::vector<size_t> scaleKeys{ ReduceKeys(source.scaleTimes, source.scales,
+				settings.scaleTolerance * kReductionShare, lerp, MaxAxisDifference) };
+			track.scales = QuantiseVec3Track(source.scaleTimes, source.scales, scaleKeys, result.timeScale);
+			if (KeepExactIfOutOfTolerance(track.scales, source.scales, scaleKeys, settings.scaleTolerance * quantisationShare, MaxAxisDifference))
+				exactTracks++;
+
+			if (report)
+			{
+				report->sourceKeys += source.translations.size() + source.rotations.size() + source.scales.size();
+				report->compressedKeys += translationKeys.size() + rotationKeys.size() + scaleKeys.size();
+				report->exactTracks += exactTracks;
+			}
+		}
+
+		if (report)
+		{
+			report->sourceBytes += ClipMemoryBytes(clip);
+			report->compressedBytes += result.MemoryBytes();
+			MeasureError(clip, result, *report);
+		}
+
+		return result;
+	}
+
+	// Samples every track of the compressed clip at time (ticks)
+	void SampleClip(const CompressedClip& clip, float time, AnimationCursor& cursor, NodePose* poses)
+	{
+		SampleInstance(clip, time, cursor, poses);
+	}
+
+	// Samples count instances of the compressed clip, each at its own time and with its own cursor
+	// With SSE2 four instances go at once in blocks (see SampleClipBlocks), the instances left over one at a time
+	void SampleClipBatch(const CompressedClip& clip, const float* times, AnimationCursor* cursors, size_t count, NodePose* poses)
+	{
+		const size_t posesPerInstance{ clip.tracks.size() };
+		size_t first{ 0 };
+
+#if HELPERS_SSE2
+		first = SampleClipBlocks(clip, cursors, count, poses, [&](size_t t, size_t group)
+		{
+			alignas(16) float quantisedTimes[4];
+			_mm_store_ps(quantisedTimes, _mm_mul_ps(_mm_loadu_ps(times + group), _mm_set1_ps(clip.timeScale)));
+			SampleTrack4(clip.tracks[t], quantisedTimes, cursors + group, t * 3, poses + group * posesPerInstance + t, posesPerInstance);
+		});
+#endif
+
+		for (; first < count; first++)
+			SampleInstance(clip, times[first], cursors[first], poses + first * posesPerInstance);
+	}
+
+	// Compresses a generated clip with a key every frame on every track, as captured motion comes in
+	ClipCompressionBenchmarkResult BenchmarkClipCompression(size_t numTracks, size_t numFrames, const ClipCompressionSettings& settings,
+		size_t numInstances)
+	{
+		ClipCompressionBenchmarkResult result;
+		result.numTracks = numTracks;
+		result.numFrames = numFrames;
+		result.settings = settings;
+		if (numTracks == 0 || numFrames < 2)
+			return result;
+
+		// Each joint turns through a few slow sine waves of its own plus capture jitter well under the tolerance.
+		// Track 0 is the root, which also travels. Scale never changes, as in most captures.
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		std::uniform_real_distribution<float> jitter(-1.0f, 1.0f);
+		const float kTwoPi{ 6.2831853f };
+
+		AnimationClip clip;
+		clip.name = "Benchmark";
+		clip.ticksPerSecond = 30.0f;
+		clip.duration = (float)(numFrames - 1);
+		clip.tracks.resize(numTracks);
+		for (size_t t = 0; t < numTracks; t++)
+		{
+			NodeTrack& track{ clip.tracks[t] };
+			track.nodeIndex = (int)t;
+
+			glm::vec3 frequency, phase, amplitude;
+			for (int c = 0; c < 3; c++)
+			{
+				frequency[c] = 0.1f + unit(random) * 1.5f;
+				phase[c] = unit(random) * kTwoPi;
+				amplitude[c] = 0.1f + unit(random) * 0.8f;
+			}
+			const glm::vec3 offset{ jitter(random) * 10.0f, jitter(random) * 10.0f, jitter(random) * 10.0f };
+
+			for (size_t frame = 0; frame < numFrames; frame++)
+			{
+				const float time{ (float)frame };
+				const float seconds{ time / clip.ticksPerSecond };
+				const glm::vec3 wave{ glm::sin(frequency * seconds + phase) };
+
+				track.translationTimes.push_back(time);
+				track.translations.push_back(t == 0 ? glm::vec3(seconds * 1.5f, 0.9f + wave.y * 0.05f, wave.x * 2.0f) : offset);
+
+				glm::vec3 angles{ wave * amplitude };
+				for (int c = 0; c < 3; c++)
+					angles[c] += jitter(random) * settings.rotationTolerance * 0.1f;
+				track.rotationTimes.push_back(time);
+				track.rotations.push_back(glm::quat(angles));
+
+				track.scaleTimes.push_back(time);
+				track.scales.push_back(glm::vec3(1.0f));
+			}
+		}
+
+		const auto begin{ std::chrono::high_resolution_clock::now() };
+		const CompressedClip compressed{ CompressClip(clip, settings, &result.report) };
+		result.compressMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+
+		// Plays numInstances copies of the compressed clip from points of their own, an instance at a time and as a batch,
+		// a 60Hz frame on each iteration. The fastest frame of each counts.
+		std::uniform_real_distribution<float> start(0.0f, clip.duration);
+		std::vector<float> startTimes(numInstances);
+		for (float& time : startTimes)
+			time = start(random);
+
+		const int kIterations{ 20 };
+		const auto milliseconds{ [&](auto&& sample)
+		{
+			std::vector<AnimationCursor> cursors(numInstances);
+			std::vector<float> frameTimes(numInstances);
+			double fastest{ std::numeric_limits<double>::max() };
+			for (int i = 0; i < kIterations; i++)
+			{
+				for (size_t instance = 0; instance < numInstances; instance++)
+					frameTimes[instance] = compressed.SecondsToTicks(startTimes[instance] / compressed.ticksPerSecond + i / 60.0f);
+				const auto frameBegin{ std::chrono::high_resolution_clock::now() };
+				sample(frameTimes.data(), cursors.data());
+				fastest = std::min(fastest, std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - frameBegin).count());
+			}
+			return fastest;
+		} };
+
+		std::vector<NodePose> loopPoses(numInstances * numTracks);
+		std::vector<NodePose> batchPoses(numInstances * numTracks);
+		result.numInstances = numInstances;
+		result.loopMilliseconds = milliseconds([&](const float* frameTimes, AnimationCursor* cursors) {
+			for (size_t instance = 0; instance < numInstances; instance++)
+				SampleClip(compressed, frameTimes[instance], cursors[instance], &loopPoses[instance * numTracks]);
+		});
+		result.batchMilliseconds = milliseconds([&](const float* frameTimes, AnimationCursor* cursors) {
+			SampleClipBatch(compressed, frameTimes, cursors, numInstances, batchPoses.data());
+		});
+
+		for (size_t pose = 0; pose < loopPoses.size(); pose++)
+		{
+			const NodePose& a{ loopPoses[pose] };
+			const NodePose& b{ batchPoses[pose] };
+			result.maxBatchDifference = std::max({ result.maxBatchDifference, glm::length(a.translation - b.translation),
+				QuatAngle(a.rotation, b.rotation), MaxAxisDifference(a.scale, b.scale) });
+		}
+
+		return result;
+	}
+
+	// Writes sampled poses into the hierarchy's local transforms
+	void ApplyPoses(const CompressedClip& clip, const NodePose* poses, NodeHierarchy& hierarchy)
+	{
+		for (size_t t = 0; t < clip.tracks.size(); t++)
+		{
+			const int node{ clip.tracks[t].nodeIndex };
+			if (node >= 0 && (size_t)node < hierarchy.Size())
+				hierarchy.localTransforms[node] = poses[t].ToMatrix();
+		}
+	}
+}
@@ -0,0 +1,184 @@
+#pragma once
+// Load time compression of animation clips: keys that interpolation can recover are dropped,
+// rotations are stored smallest three and translation / scale are quantised against each track's range
+
+#include "ExternalLibraryHeaders.h"
+#include "Animation.h"
+
+#include <cstdint>
+
+namespace Helpers
+{
+	// How far the compressed clip may stray from the source before a key has to be kept
+	struct ClipCompressionSettings
+	{
+		// Model units
+		float translationTolerance{ 0.001f };
+
+		// Radians
+		float rotationTolerance{ 0.001f };
+
+		// Absolute difference in each axis
+		float scaleTolerance{ 0.001f };
+	};
+
+	// Key times as 16 bit integers, ticks multiplied by the clip's timeScale
+	using QuantisedTime = uint16_t;
+
+	// A vec3 track with 16 bits per component spread between the track's min and max
+	struct QuantisedVec3Track
+	{
+		std::vector<QuantisedTime> times;
+
+		// Three per key
+		std::vector<uint16_t> values;
+
+		glm::vec3 rangeMin{ 0 };
+		glm::vec3 rangeExtent{ 0 };
+
+		// Full precision keys, used instead of values when 16 bits over the track's range would exceed the tolerance
+		std::vector<glm::vec3> exact;
+
+		glm::vec3 Decode(size_t key) const;
+		bool empty() const { return times.empty(); }
+		size_t size() const { return times.size(); }
+	};
+
+	// Unit quaternions stored smallest three: the largest component is dropped and rebuilt from the other three.
+	// 15 bits per component, the dropped component's index lives in the top bit of the first two.
+	struct QuantisedQuatTrack
+	{
+		std::vector<QuantisedTime> times;
+
+		// Three per key
+		std::vector<uint16_t> values;
+
+		// Full precision keys, used instead of values when 15 bits would exceed the tolerance
+		std::vector<glm::quat> exact;
+
+		glm::quat Decode(size_t key) const;
+		bool empty() const { return times.empty(); }
+		size_t size() const { return times.size(); }
+	};
+
+	struct CompressedTrack
+	{
+		// Index into the model's NodeHierarchy
+		int nodeIndex{ NodeHierarchy::kInvalidNode };
+
+		QuantisedVec3Track translations;
+		QuantisedQuatTrack rotations;
+		QuantisedVec3Track scales;
+	};
+
+	// The compressed form of an AnimationClip, times are in ticks like the source
+	struct CompressedClip
+	{
+		std::string name;
+		float duration{ 0 };
+		float ticksPerSecond{ 25.0f };
+		std::vector<CompressedTrack> tracks;
+
+		// Ticks to QuantisedTime. Keys on a regular grid (e.g. one per frame) are stored exactly,
+		// anything else as a fraction of the duration.
+		float timeScale{ 0 };
+
+		// Converts a playback time in seconds to ticks, wrapping so the clip loops
+		float SecondsToTicks(float seconds) const;
+
+		// Bytes held by the clip's tracks
+		size_t MemoryBytes() const;
+	};
+
+	// What compression saved and what it cost, errors are measured by sampling both clips
+	struct ClipCompressionReport
+	{
+		size_t sourceKeys{ 0 };
+		size_t compressedKeys{ 0 };
+
+		// Tracks (translation, rotation and scale counted apart) kept at full precision as quantising failed the tolerance
+		size_t exactTracks{ 0 };
+
+		size_t sourceBytes{ 0 };
+		size_t compressedBytes{ 0 };
+
+		float maxTranslationError{ 0 };
+		float maxRotationError{ 0 };
+		float maxScaleError{ 0 };
+
+		// Combines another clip's report into this one
+		void Add(const ClipCompressionReport& other)
+		{
+			sourceKeys += other.sourceKeys;
+			compressedKeys += other.compressedKeys;
+			exactTracks += other.exactTracks;
+			sourceBytes += other.sourceBytes;
+			compressedBytes += other.compressedBytes;
+			maxTranslationError = std::max(maxTranslationError, other.maxTranslationError);
+			maxRotationError = std::max(maxRotationError, other.maxRotationError);
+			maxScaleError = std::max(maxScaleError, other.maxScaleError);
+		}
+
+		std::string ToString() const {
+			const float ratio{ compressedBytes ? (float)sourceBytes / compressedBytes : 0.0f };
+			return "Keys: " + std::to_string(sourceKeys) + " -> " + std::to_string(compressedKeys) +
+				" Bytes: " + std::to_string(sourceBytes) + " -> " + std::to_string(compressedBytes) +
+				" (" + std::to_string(ratio) + "x)" +
+				" Full precision tracks: " + std::to_string(exactTracks) +
+				" Max error T: " + std::to_string(maxTranslationError) +
+				" R: " + std::to_string(maxRotationError) + " rad" +
+				" S: " + std::to_string(maxScaleError);
+		}
+	};
+
+	// Same as the raw byte size of the clip, for comparison with CompressedClip::MemoryBytes
+	size_t ClipMemoryBytes(const AnimationClip& clip);
+
+	// Compresses the clip. If report is given it is filled in, which samples both clips so takes a little longer.
+	CompressedClip CompressClip(const AnimationClip& clip, const ClipCompressionSettings& settings = ClipCompressionSettings(), ClipCompressionReport* report = nullptr);
+
+	// Samples every track of the compressed clip at time (ticks). poses must have room for one pose per track.
+	void SampleClip(const CompressedClip& clip, float time, AnimationCursor& cursor, NodePose* poses);
+
+	// Samples count instances of the compressed clip, each at its own time and with its own cursor.
+	// With SSE2 four instances go at once, their smallest three rotations rebuilt together.
+	void SampleClipBatch(const CompressedClip& clip, const float* times, AnimationCursor* cursors, size_t count, NodePose* poses);
+
+	struct ClipCompressionBenchmarkResult
+	{
+		size_t numTracks{ 0 };
+		size_t numFrames{ 0 };
+		double compressMilliseconds{ 0 };
+		ClipCompressionSettings settings;
+		ClipCompressionReport report;
+
+		// Per frame, every instance of the compressed clip sampled one at a time and with SampleClipBatch
+		size_t numInstances{ 0 };
+		double loopMilliseconds{ 0 };
+		double batchMilliseconds{ 0 };
+
+		// Largest difference between the two in any translation, rotation (radians) or scale
+		float maxBatchDifference{ 0 };
+
+		// The compressed clip stays within the tolerances everywhere it was sampled, and the batch agrees with SampleClip
+		bool Passed() const {
+			return report.maxTranslationError <= settings.translationTolerance && report.maxRotationError <= settings.rotationTolerance &&
+				report.maxScaleError <= settings.scaleTolerance && maxBatchDifference <= 1e-5f;
+		}
+
+		std::string ToString() const {
+			return "Compressing " + std::to_string(numTracks) + " tracks of " + std::to_string(numFrames) + " frames: " +
+				std::to_string(compressMilliseconds) + " ms " + report.ToString() + " Sampling " + std::to_string(numInstances) +
+				" instances per instance: " + std::to_string(loopMilliseconds) + " ms Batch: " + std::to_string(batchMilliseconds) +
+				" ms Max difference: " + std::to_string(maxBatchDifference) + (Passed() ? " PASS" : " FAIL");
+		}
+	};
+
+	// Compresses a generated motion capture like clip, a key per frame on every track, and measures the result.
+	// Then times sampling numInstances instances of it.
+	ClipCompressionBenchmarkResult BenchmarkClipCompression(size_t numTracks = 60, size_t numFrames = 3000,
+		const ClipCompressionSettings& settings = ClipCompressionSettings(), size_t numInstances = 1024);
+
+	// Writes sampled poses into the hierarchy's local transforms. Call UpdateWorldTransforms afterwards.
+	void ApplyPoses(const CompressedClip& clip, const NodePose* poses, NodeHierarchy& hierarchy);
+}
@@ -0,0 +1,132 @@
+#pragma once
+// The four instances at a time pieces of SampleClipBatch, shared by raw and compressed clips
+// Brings in the SSE intrinsics so is only for the animation .cpp files, everything here needs HELPERS_SSE2
+
+#include "Animation.h"
+#include "Simd.h"
+
+#if HELPERS_SSE2
+
+namespace Helpers
+{
+	// Instances SampleClipBlocks takes at a time, their poses and cursors stay in cache while every track is sampled
+	const size_t kAnimationBlock{ 64 };
+
+	// KeyBlend a lane at a time, lane i sampling times[i] with cursors[i].keys[keyIndex]. Gives each lane's key, the key
+	// after it and the blend towards it. Playing forwards a cursor moves on at most a key a frame, so a lane steps on by
+	// one comparison and FindKey is only called for a lane that has looped or jumped.
+	template<typename TimeType>
+	void KeyBlend4(const std::vector<TimeType>& keyTimes, const float* times, AnimationCursor* cursors, size_t keyIndex,
+		unsigned int* keys, unsigned int* nextKeys, float* blends)
+	{
+		const unsigned int lastTime{ (unsigned int)keyTimes.size() - 1 };
+		const unsigned int lastKey{ lastTime ? lastTime - 1 : 0 };
+		for (int lane = 0; lane < 4; lane++)
+		{
+			unsigned int& cursor{ cursors[lane].keys[keyIndex] };
+			const float time{ times[lane] };
+			unsigned int key{ std::min(cursor, lastKey) };
+			key += (unsigned int)(key < lastKey && time >= (float)keyTimes[key + 1]);
+			if ((time < (float)keyTimes[key] && key != 0) || (key < lastKey && time >= (float)keyTimes[key + 1]))
+				key = FindKey(keyTimes, time, key);
+
+			cursor = key;
+			keys[lane] = key;
+			nextKeys[lane] = std::min(key + 1, lastTime);
+
+			// As KeyBlend: clamped, and nothing for the last key or keys at the same time
+			const float span{ (float)keyTimes[nextKeys[lane]] - (float)keyTimes[key] };
+			blends[lane] = span > 0 ? std::min(std::max((time - (float)keyTimes[key]) / span, 0.0f), 1.0f) : 0.0f;
+		}
+	}
+
+	// A key's value in a register, vec3 with a zero w
+	inline __m128 LoadKey(const glm::vec3& v)
+	{
+		return _mm_movelh_ps(_mm_castpd_ps(_mm_load_sd((const double*)&v.x)), _mm_load_ss(&v.z));
+	}
+
+	// x, y, z, w, the order glm keeps them in
+	inline __m128 LoadKey(const glm::quat& q) { return _mm_loadu_ps(&q.x); }
+
+	// x and y then z, as a 16 byte store would run into whatever follows the vec3
+	inline void StoreKey(__m128 v, glm::vec3& out)
+	{
+		_mm_storel_pi((__m64*)&out.x, v);
+		_mm_store_ss(&out.z, _mm_movehl_ps(v, v));
+	}
+
+	// Blends a vec3 channel of four instances, a vec3 a register. Three components would leave a quarter of any
+	// register in SoA form idle and the transposes cost more than they save. Lane i writes poses[i * posesPerInstance].
+	inline void LerpVec3Lanes(const __m128* from, const __m128* to, const float* blends, NodePose* poses, size_t posesPerInstance,
+		glm::vec3 NodePose::* member)
+	{
+		for (int lane = 0; lane < 4; lane++)
+			StoreKey(_mm_add_ps(from[lane], _mm_mul_ps(_mm_sub_ps(to[lane], from[lane]), _mm_set1_ps(blends[lane]))),
+				poses[lane * posesPerInstance].*member);
+	}
+
+	// NlerpQuat for four instances in SoA form, from and to hold x, y, z and w of all four lanes a register each.
+	// Sums go in the same order as NlerpQuat's so the result is the same to the bit. Lane i writes poses[i * posesPerInstance].
+	inline void NlerpQuatLanes(__m128 (&from)[4], const __m128 (&to)[4], const float* blends, NodePose* poses, size_t posesPerInstance)
+	{
+		// Flip the far key of any lane where the blend would go the long way round
+		const __m128 dot{ _mm_add_ps(_mm_add_ps(_mm_mul_ps(from[0], to[0]), _mm_mul_ps(from[1], to[1])),
+			_mm_add_ps(_mm_mul_ps(from[2], to[2]), _mm_mul_ps(from[3], to[3]))) };
+		const __m128 flip{ _mm_and_ps(_mm_cmplt_ps(dot, _mm_setzero_ps()), _mm_set1_ps(-0.0f)) };
+
+		const __m128 blend{ _mm_loadu_ps(blends) };
+		for (int c = 0; c < 4; c++)
+			from[c] = _mm_add_ps(from[c], _mm_mul_ps(_mm_sub_ps(_mm_xor_ps(to[c], flip), from[c]), blend));
+
+		const __m128 length{ _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(from[0], from[0]), _mm_mul_ps(from[1], from[1])),
+			_mm_add_ps(_mm_mul_ps(from[2], from[2]), _mm_mul_ps(from[3], from[3])))) };
+		for (int c = 0; c < 4; c++)
+			from[c] = _mm_div_ps(from[c], length);
+
+		_MM_TRANSPOSE4_PS(from[0], from[1], from[2], from[3]);
+		for (int lane = 0; lane < 4; lane++)
+			_mm_storeu_ps(&poses[lane * posesPerInstance].rotation.x, from[lane]);
+	}
+
+	// Runs sampleGroup(track, firstInstance) for every track and every group of four of the first count & ~3 instances,
+	// returning how many that was. Goes a block of instances at a time and through the block a track at a time, with the
+	// next block's poses and cursors fetched meanwhile, as track by track they are written a line here and a line there
+	// where an instance at a time writes them in order.
+	template<typename Clip, typename SampleGroup>
+	size_t SampleClipBlocks(const Clip& clip, AnimationCursor* cursors, size_t count, NodePose* poses, SampleGroup&& sampleGroup)
+	{
+		const size_t posesPerInstance{ clip.tracks.size() };
+		const size_t batched{ count & ~(size_t)3 };
+		for (size_t i = 0; i < batched; i++)
+		{
+			if (cursors[i].keys.size() != clip.tracks.size() * 3)
+				cursors[i].Reset(clip);
+		}
+
+		for (size_t block = 0; block < batched; block += kAnimationBlock)
+		{
+			const size_t blockEnd{ std::min(block + kAnimationBlock, batched) };
+			const size_t nextEnd{ std::min(blockEnd + kAnimationBlock, batched) };
+			const char* nextPoses{ (const char*)(poses + blockEnd * posesPerInstance) };
+			for (size_t offset = 0; offset < (nextEnd - blockEnd) * posesPerInstance * sizeof(NodePose); offset += 64)
+				_mm_prefetch(nextPoses + offset, _MM_HINT_T0);
+			for (size_t i = blockEnd; i < nextEnd; i++)
+			{
+				const char* keys{ (const char*)cursors[i].keys.data() };
+				for (size_t offset = 0; offset < cursors[i].keys.size() * sizeof(unsigned int); offset += 64)
+					_mm_prefetch(keys + offset, _MM_HINT_T0);
+			}
+
+			for (size_t t = 0; t < clip.tracks.size(); t++)
+			{
+				for (size_t group = block; group < blockEnd; group += 4)
+					sampleGroup(t, group);
+			}
+		}
+
+		return batched;
+	}
+}
+
+#endif
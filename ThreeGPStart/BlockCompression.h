@@ -0,0 +1,119 @@
+#pragma once
+// CPU encoders (and decoders, for measuring quality) for the GPU block compressed texture formats
+
+#include "ExternalLibraryHeaders.h"
+#include "MipGenerator.h"
+#include "ThreadPool.h"
+
+namespace Helpers
+{
+	// Every format stores 4x4 texel blocks
+	enum class BlockFormat
+	{
+		// RGB at 4 bits per texel, for opaque colour
+		BC1,
+
+		// BC1 colour plus BC4 alpha, 8 bits per texel
+		BC3,
+
+		// One channel at 4 bits per texel, for masks and heights
+		BC4,
+
+		// Two BC4 channels, for normal maps
+		BC5,
+
+		// RGBA at 8 bits per texel, mode 6 only. Far less banding than BC1 / BC3 on smooth gradients, though no better
+		// on noisy detail, and slower to encode.
+		BC7
+	};
+
+	// Bytes in one 4x4 block
+	inline size_t BlockBytes(BlockFormat format) { return format == BlockFormat::BC1 || format == BlockFormat::BC4 ? 8 : 16; }
+
+	// Internal format for glCompressedTexImage2D
+	GLenum BlockInternalFormat(BlockFormat format);
+
+	std::string ToString(BlockFormat format);
+
+	// BC1 for opaque images, BC3 when any alpha is below 255, BC7 instead of either when highQuality is set
+	BlockFormat ChooseBlockFormat(const unsigned char* rgba, int width, int height, bool highQuality);
+
+	// One level's blocks, rows of blocks one after the other
+	struct CompressedLevel
+	{
+		int width{ 0 };
+		int height{ 0 };
+		std::vector<unsigned char> data;
+	};
+
+	struct CompressedImage
+	{
+		BlockFormat format{ BlockFormat::BC1 };
+		std::vector<CompressedLevel> levels;
+
+		size_t MemoryBytes() const {
+			size_t bytes{ 0 };
+			for (const CompressedLevel& level : levels)
+				bytes += level.data.size();
+			return bytes;
+		}
+	};
+
+	// Encodes width x height RGBA texels, rows of blocks shared among the pool. Edge blocks repeat the last row / column.
+	std::vector<unsigned char> CompressBlocks(const unsigned char* rgba, int width, int height, BlockFormat format,
+		ThreadPool& pool = ThreadPool::Shared());
+
+	// Back to RGBA, channels a format does not store are 0 (alpha 255)
+	std::vector<unsigned char> DecompressBlocks(const unsigned char* blocks, int width, int height, BlockFormat format);
+
+	// Encodes every level of a chain
+	CompressedImage CompressMipChain(const MipChain& chain, BlockFormat format, ThreadPool& pool = ThreadPool::Shared());
+
+	// Peak signal to noise ratio in dB over the first numChannels channels of two RGBA images, higher is closer
+	double ComputePSNR(const unsigned char* a, const unsigned char* b, int width, int height, int numChannels = 3);
+
+	struct BlockCompressionBenchmarkResult
+	{
+		struct Entry
+		{
+			BlockFormat format{ BlockFormat::BC1 };
+			// On the noisy test image and on the same gradients without the noise, where banding shows
+			double psnr{ 0 };
+			double smoothPsnr{ 0 };
+			double megaTexelsPerSecond{ 0 };
+
+			// Floors for the test images, well under what each format manages so only a real regression fails
+			double minPsnr{ 0 };
+			double minSmoothPsnr{ 0 };
+			double minMegaTexelsPerSecond{ 0 };
+
+			bool Passed() const { return psnr >= minPsnr && smoothPsnr >= minSmoothPsnr && megaTexelsPerSecond >= minMegaTexelsPerSecond; }
+		};
+
+		int size{ 0 };
+		unsigned int numThreads{ 0 };
+		std::vector<Entry> entries;
+
+		// A BC7 block assembled from the specification decodes to the texels it should
+		bool bc7MatchesReference{ false };
+
+		bool Passed() const {
+			return !entries.empty() && bc7MatchesReference &&
+				std::all_of(entries.begin(), entries.end(), [](const Entry& entry) { return entry.Passed(); });
+		}
+
+		std::string ToString() const {
+			std::string result{ "Block compression " + std::to_string(size) + "x" + std::to_string(size) + " on " +
+				std::to_string(numThreads) + " threads" };
+			for (const Entry& entry : entries)
+				result += "\n" + Helpers::ToString(entry.format) + ": PSNR " + std::to_string(entry.psnr) + " dB (min " +
+					std::to_string(entry.minPsnr) + ") smooth " + std::to_string(entry.smoothPsnr) + " dB (min " +
+					std::to_string(entry.minSmoothPsnr) + ") " + std::to_string(entry.megaTexelsPerSecond) + " M texels/s (min " +
+					std::to_string(entry.minMegaTexelsPerSecond) + ")" + (entry.Passed() ? " PASS" : " FAIL");
+			return result + "\nBC7 reference block: " + (bc7MatchesReference ? "matches" : "WRONG") + (Passed() ? "\nPASS" : "\nFAIL");
+		}
+	};
+
+	// Encodes a size x size test image in every format, measuring quality against the original and speed
+	BlockCompressionBenchmarkResult BenchmarkBlockCompression(int size = 1024, ThreadPool& pool = ThreadPool::Shared());
+}
@@ -0,0 +1,147 @@
+#include "Bounds.h"
+#include "Simd.h"
+
+#include <cmath>
+
+namespace Helpers
+{
+	namespace
+	{
+#if HELPERS_SSE2
+		// Loads four packed vec3s (12 floats) and splits them into x, y and z lanes
+		inline void LoadTransposed(const float* p, __m128& x, __m128& y, __m128& z)
+		{
+			const __m128 a{ _mm_loadu_ps(p) };		// x0 y0 z0 x1
+			const __m128 b{ _mm_loadu_ps(p + 4) };	// y1 z1 x2 y2
+			const __m128 c{ _mm_loadu_ps(p + 8) };	// z2 x3 y3 z3
+
+			x = _mm_shuffle_ps(a, _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 3, 0));
+			y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+			z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+		}
+
+		inline float HorizontalMin(__m128 v)
+		{
+			v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+			v = _mm_min_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+			return _mm_cvtss_f32(v);
+		}
+
+		inline float HorizontalMax(__m128 v)
+		{
+			v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+			v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+			return _mm_cvtss_f32(v);
+		}
+#endif
+	}
+
+	// Grows these bounds to contain other as well
+	void Bounds::Merge(const Bounds& other)
+	{
+		if (!other.valid)
+			return;
+
+		if (!valid)
+		{
+			*this = other;
+			return;
+		}
+
+		minExtents = glm::min(minExtents, other.minExtents);
+		maxExtents = glm::max(maxExtents, other.maxExtents);
+
+		// Smallest sphere around both spheres
+		const glm::vec3 offset{ other.centre - centre };
+		const float distance{ glm::length(offset) };
+		if (distance + other.radius <= radius)
+			return;
+
+		if (distance + radius <= other.radius)
+		{
+			centre = other.centre;
+			radius = other.radius;
+			return;
+		}
+
+		const float newRadius{ (distance + radius + other.radius) * 0.5f };
+		centre += offset * ((newRadius - radius) / distance);
+		radius = newRadius;
+	}
+
+	// Two passes, min / max for the box then the furthest point from its centre for the sphere
+	Bounds Bounds::FromPoints(const glm::vec3* points, size_t count)
+	{
+		Bounds result;
+		if (count == 0)
+			return result;
+
+		glm::vec3 minimum{ points[0] };
+		glm::vec3 maximum{ points[0] };
+		size_t i{ 0 };
+
+#if HELPERS_SSE2
+		const float* floats{ &points[0].x };
+		__m128 minX{ _mm_set1_ps(minimum.x) }, minY{ _mm_set1_ps(minimum.y) }, minZ{ _mm_set1_ps(minimum.z) };
+		__m128 maxX{ minX }, maxY{ minY }, maxZ{ minZ };
+
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 x, y, z;
+			LoadTransposed(floats + i * 3, x, y, z);
+			minX = _mm_min_ps(minX, x);
+			minY = _mm_min_ps(minY, y);
+			minZ = _mm_min_ps(minZ, z);
+			maxX = _mm_max_ps(maxX, x);
+			maxY = _mm_max_ps(maxY, y);
+			maxZ = _mm_max_ps(maxZ, z);
+		}
+
+		minimum = glm::vec3(HorizontalMin(minX), HorizontalMin(minY), HorizontalMin(minZ));
+		maximum = glm::vec3(HorizontalMax(maxX), HorizontalMax(maxY), HorizontalMax(maxZ));
+#endif
+
+		for (; i < count; i++)
+		{
+			minimum = glm::min(minimum, points[i]);
+			maximum = glm::max(maximum, points[i]);
+		}
+
+		result.minExtents = minimum;
+		result.maxExtents = maximum;
+		result.centre = (minimum + maximum) * 0.5f;
+
+		float maxDistanceSquared{ 0 };
+		i = 0;
+
+#if HELPERS_SSE2
+		const __m128 centreX{ _mm_set1_ps(result.centre.x) };
+		const __m128 centreY{ _mm_set1_ps(result.centre.y) };
+		const __m128 centreZ{ _mm_set1_ps(result.centre.z) };
+		__m128 maxDistances{ _mm_setzero_ps() };
+
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 x, y, z;
+			LoadTransposed(floats + i * 3, x, y, z);
+			x = _mm_sub_ps(x, centreX);
+			y = _mm_sub_ps(y, centreY);
+			z = _mm_sub_ps(z, centreZ);
+			const __m128 distances{ _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)) };
+			maxDistances = _mm_max_ps(maxDistances, distances);
+		}
+
+		maxDistanceSquared = HorizontalMax(maxDistances);
+#endif
+
+		for (; i < count; i++)
+		{
+			const glm::vec3 offset{ points[i] - result.centre };
+			maxDistanceSquared = std::max(maxDistanceSquared, glm::dot(offset, offset));
+		}
+
+		result.radius = std::sqrt(maxDistanceSquared);
+		result.valid = true;
+		return result;
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+// Axis aligned box and bounding sphere of a set of points
+
+#include "ExternalLibraryHeaders.h"
+#include "Helper.h"
+
+namespace Helpers
+{
+	struct Bounds
+	{
+		glm::vec3 minExtents{ 0 };
+		glm::vec3 maxExtents{ 0 };
+
+		// Sphere centred on the box, radius reaching the furthest point rather than the box corner
+		glm::vec3 centre{ 0 };
+		float radius{ 0 };
+
+		// False until bounds have been found for at least one point
+		bool valid{ false };
+
+		// Grows these bounds to contain other as well. The sphere is refit around both spheres.
+		void Merge(const Bounds& other);
+
+		// Bounds of count points packed one after the other, found with SSE where available
+		static Bounds FromPoints(const glm::vec3* points, size_t count);
+
+		std::string ToString() const {
+			return "Min: " + Helpers::ToString(minExtents) + " Max: " + Helpers::ToString(maxExtents) +
+				" Radius: " + std::to_string(radius);
+		}
+	};
+}
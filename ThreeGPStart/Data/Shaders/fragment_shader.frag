@@ -1,6 +1,19 @@
 #version 330
 
 uniform sampler2D sampler_tex;
+uniform sampler2DArray sampler_atlas;
+
+// One record of the renderer's material buffer, bound per material
+layout(std140) uniform Material
+{
+	vec4 diffuse_colour;
+	vec4 ambient_colour;
+	vec4 emissive_colour;
+	vec4 specular_colour;
+	vec4 atlas_rect;
+	float specular_factor;
+	float atlas_layer;
+};
 
 uniform vec3 light_intensity;
 
@@ -11,9 +24,20 @@ in vec3 varying_positions;
 
 out vec4 fragment_colour;
 
+// The diffuse texture, from the atlas when the material's texture was packed into it
+vec3 DiffuseTexture(vec2 uv)
+{
+	if (atlas_layer < 0.0)
+		return texture(sampler_tex, uv).rgb;
+
+	// Repeats within the packed rect, with gradients from the unwrapped coordinates so the mip stays put across the wrap
+	vec2 atlas_uv = atlas_rect.xy + fract(uv) * atlas_rect.zw;
+	return textureGrad(sampler_atlas, vec3(atlas_uv, atlas_layer), dFdx(uv) * atlas_rect.zw, dFdy(uv) * atlas_rect.zw).rgb;
+}
+
 void main(void)
 {
-	vec3 tex_colour = texture(sampler_tex, varying_txtrcoord).rgb;
+	vec3 tex_colour = DiffuseTexture(varying_txtrcoord) * diffuse_colour.rgb;
 
 	vec3 Norm = normalize(varying_normal);
 
@@ -36,6 +60,6 @@ void main(void)
 	vec3 pointLight_Colour = vec3(0.1, 0, 0.6);
 
 	//Calculates all the lighting
-	vec3 result = ambient_Intensity * ambient_Colour + tex_colour * (intensity * light_Colour + pointLight_intensity * pointLight_Colour);
+	vec3 result = emissive_colour.rgb + ambient_Intensity * ambient_Colour + tex_colour * (intensity * light_Colour + pointLight_intensity * pointLight_Colour);
 	fragment_colour = vec4(result, 1);
 }
\ No newline at end of file
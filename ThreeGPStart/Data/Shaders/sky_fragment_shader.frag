@@ -1,17 +1,14 @@
 #version 330
 
-uniform sampler2D sampler_tex;
-uniform vec4 diffuse_colour;
+uniform samplerCube sampler_tex;
 
-in vec3 varying_position;
-in vec3 varying_normal;
-in vec2 varying_txtrcoord;
+in vec3 varying_direction;
 
 out vec4 fragment_colour;
 
 void main(void)
 {
-	vec3 N = normalize(varying_normal);
-	vec3 tex_colour = texture(sampler_tex, varying_txtrcoord).rgb;
+	// The faces were made for a left handed space, z is flipped to look them up from ours
+	vec3 tex_colour = texture(sampler_tex, vec3(varying_direction.xy, -varying_direction.z)).rgb;
 	fragment_colour = vec4(tex_colour,1.0);
 }
\ No newline at end of file
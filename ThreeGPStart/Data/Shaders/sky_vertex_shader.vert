@@ -1,21 +1,16 @@
 #version 330
 
 uniform mat4 combined_xform;
-uniform mat4 model_xform;
 
 layout (location=0) in vec3 vertex_position;
-layout (location=1) in vec3 vertex_normal;
-layout (location=2) in vec2 vertex_texcoord;
 
-out vec3 varying_position;
-out vec3 varying_normal;
-out vec2 varying_txtrcoord;
+out vec3 varying_direction;
 
 void main(void)
 {	
-	varying_position = mat4x3(model_xform) * vec4(vertex_position, 1.0);
-	varying_txtrcoord = vertex_texcoord;
-	varying_normal = mat3(model_xform) * vertex_normal;
+	varying_direction = vertex_position;
 
-	gl_Position = combined_xform * model_xform * vec4(vertex_position, 1.0);
+	// w for z puts every vertex at the far plane after the divide
+	vec4 position = combined_xform * vec4(vertex_position, 1.0);
+	gl_Position = position.xyww;
 }
\ No newline at end of file
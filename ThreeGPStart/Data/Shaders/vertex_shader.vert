@@ -7,15 +7,20 @@ layout (location=0) in vec3 vertex_position;
 layout (location=1) in vec3 vertex_normal;
 layout (location=2) in vec2 vertex_texture;
 
+// Per instance transform, identity for mesh that are not instanced
+layout (location=3) in mat4 instance_xform;
+
 out vec3 varying_normal;
 out vec3 varying_positions;
 out vec2 varying_txtrcoord;
 
 void main(void)
 {	
+	mat4 world_xform = model_xform * instance_xform;
+
 	varying_txtrcoord = vertex_texture;
-	varying_positions = (model_xform * vec4(vertex_position, 1.0)).xyz;
-	varying_normal = (model_xform * vec4(vertex_normal, 0.0)).xyz;
+	varying_positions = (world_xform * vec4(vertex_position, 1.0)).xyz;
+	varying_normal = (world_xform * vec4(vertex_normal, 0.0)).xyz;
 
-	gl_Position = combined_xform * model_xform * vec4(vertex_position, 1.0);
+	gl_Position = combined_xform * world_xform * vec4(vertex_position, 1.0);
 }
\ No newline at end of file
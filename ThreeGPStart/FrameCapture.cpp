@@ -0,0 +1,220 @@
+#include "FrameCapture.h"
+#include "ImageLoader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+namespace fs = std::filesystem;
+
+namespace Helpers
+{
+	// Makes the folder a capture is saved in
+	static void CreateParentFolder(const std::string& path)
+	{
+		const fs::path parent{ fs::path(path).parent_path() };
+		std::error_code error;
+		if (!parent.empty())
+			fs::create_directories(parent, error);
+	}
+
+	FrameCapture::~FrameCapture()
+	{
+		// Reads still on the GPU are waited for and saved like any other, then every encode is let finish
+		CollectFinished(true);
+		for (std::future<bool>& save : m_saves)
+			save.wait();
+		CollectSaves();
+
+		for (Slot& slot : m_slots)
+		{
+			if (slot.fence)
+				glDeleteSync(slot.fence);
+			glDeleteBuffers(1, &slot.buffer);
+		}
+	}
+
+	// Captures the next frame to path
+	void FrameCapture::RequestScreenshot(const std::string& path)
+	{
+		CreateParentFolder(path);
+		m_screenshotPath = path;
+	}
+
+	// Captures every interval-th frame from the next
+	void FrameCapture::StartSequence(const std::string& prefix, unsigned int interval)
+	{
+		CreateParentFolder(prefix);
+		m_sequencePrefix = prefix;
+		m_sequenceInterval = std::max(interval, 1u);
+		m_sequenceStart = m_frame;
+	}
+
+	void FrameCapture::StopSequence()
+	{
+		m_sequenceInterval = 0;
+	}
+
+	// Once a frame, after drawing and before swapping
+	void FrameCapture::EndFrame()
+	{
+		CollectFinished(false);
+
+		// A screenshot waits for a free buffer
+		const uint64_t frame{ m_frame++ };
+		if (!m_screenshotPath.empty() && m_captured - m_collected < kNumBuffers)
+		{
+			Capture(m_slots[m_captured % kNumBuffers], m_screenshotPath, true);
+			m_screenshotPath.clear();
+		}
+
+		// Sequence frames are dropped so the sequence keeps its spacing, including when a screenshot has the last buffer
+		if (m_sequenceInterval && (frame - m_sequenceStart) % m_sequenceInterval == 0)
+		{
+			if (m_captured - m_collected >= kNumBuffers)
+			{
+				m_dropped++;
+				return;
+			}
+
+			// Numbered by frame so a dropped capture shows as a gap
+			std::string number{ std::to_string(frame - m_sequenceStart) };
+			number.insert(0, number.size() < 6 ? 6 - number.size() : 0, '0');
+			Capture(m_slots[m_captured % kNumBuffers], m_sequencePrefix + "_" + number, false);
+		}
+	}
+
+	// Reads the framebuffer into the slot's buffer. glReadPixels into a bound pack buffer returns at once,
+	// the copy happens on the GPU after the frame's draws.
+	void FrameCapture::Capture(Slot& slot, const std::string& path, bool screenshot)
+	{
+		GLint viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		slot.width = viewport[2];
+		slot.height = viewport[3];
+		slot.path = path;
+		slot.screenshot = screenshot;
+
+		const size_t bytes{ (size_t)slot.width * slot.height * 4 };
+		if (!slot.buffer)
+			glGenBuffers(1, &slot.buffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+		if (bytes > slot.capacity)
+		{
+			glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+			slot.capacity = bytes;
+		}
+
+		// 4 byte texels so rows are never padded, in the order FreeImage keeps colour as SaveImage passes them straight on
+		const GLenum format{ FREEIMAGE_COLORORDER == FREEIMAGE_COLORORDER_BGR ? (GLenum)GL_BGRA : (GLenum)GL_RGBA };
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		glReadPixels(viewport[0], viewport[1], slot.width, slot.height, format, GL_UNSIGNED_BYTE, nullptr);
+		slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		m_captured++;
+	}
+
+	// Maps the finished slots, oldest first, and saves their pixels on the pool
+	void FrameCapture::CollectFinished(bool wait)
+	{
+		CollectSaves();
+
+		const GLuint64 kWaitNanoseconds{ 1000000000 };
+		while (m_collected < m_captured)
+		{
+			// Polled each frame, only waited on when finishing. Later slots were read after this one so cannot be ready
+			// if it is not.
+			Slot& slot{ m_slots[m_collected % kNumBuffers] };
+			GLenum status{ GL_TIMEOUT_EXPIRED };
+			do
+				status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? kWaitNanoseconds : 0);
+			while (wait && status == GL_TIMEOUT_EXPIRED);
+			if (status == GL_TIMEOUT_EXPIRED)
+				break;
+
+			// Each encode holds a frame of pixels, so only so many run at once. A sequence frame over the limit is
+			// dropped, a screenshot stays in its buffer until an encode finishes.
+			if (m_saves.size() >= kMaxEncodes)
+			{
+				if (wait)
+				{
+					m_saves.front().wait();
+					CollectSaves();
+				}
+				else if (slot.screenshot)
+					break;
+				else
+				{
+					glDeleteSync(slot.fence);
+					slot.fence = nullptr;
+					m_collected++;
+					m_droppedEncoding++;
+					continue;
+				}
+			}
+
+			glDeleteSync(slot.fence);
+			slot.fence = nullptr;
+			m_collected++;
+
+			// Copied out so the buffer is free for the next capture, into a pooled buffer the encode releases
+			const size_t bytes{ (size_t)slot.width * slot.height * 4 };
+			std::shared_ptr<ImageLoader> image{ std::make_shared<ImageLoader>() };
+			image->Create(slot.width, slot.height);
+
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+			const void* pixels{ glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT) };
+			if (pixels)
+			{
+				memcpy(image->GetData(), pixels, bytes);
+				glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			}
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+			if (!pixels)
+			{
+				m_failed++;
+				continue;
+			}
+
+			const std::string path{ slot.path };
+			m_saves.push_back(m_pool.Submit([image, path]()
+			{
+				// The framebuffer's alpha is whatever blending left, a PNG of it would be partly see through
+				BYTE* texels{ image->GetData() };
+				for (size_t alpha = 3; alpha < (size_t)image->Width() * image->Height() * 4; alpha += 4)
+					texels[alpha] = 255;
+				return SaveImage(texels, image->Width(), image->Height(), path);
+			}));
+		}
+	}
+
+	// Checks off the encodes that have finished
+	void FrameCapture::CollectSaves()
+	{
+		for (auto save{ m_saves.begin() }; save != m_saves.end();)
+		{
+			if (save->wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			{
+				++save;
+				continue;
+			}
+
+			if (save->get())
+				m_saved++;
+			else
+				m_failed++;
+			save = m_saves.erase(save);
+		}
+	}
+
+	std::string FrameCapture::ToString() const
+	{
+		return "Captures: Saved: " + std::to_string(m_saved) +
+			" Reading: " + std::to_string(m_captured - m_collected) +
+			" Encoding: " + std::to_string(m_saves.size()) +
+			" Dropped: " + std::to_string(m_dropped) +
+			" Dropped while encoding: " + std::to_string(m_droppedEncoding) +
+			" Failed: " + std::to_string(m_failed);
+	}
+}
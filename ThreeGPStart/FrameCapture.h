@@ -0,0 +1,84 @@
+#pragma once
+// Saves rendered frames as PNGs without the render thread waiting on the GPU or the encoder
+
+#include "ExternalLibraryHeaders.h"
+#include "ThreadPool.h"
+
+namespace Helpers
+{
+	// Each capture is a glReadPixels into the next of a ring of pixel pack buffers with a fence after it. The read runs
+	// on the GPU behind the frame, a later EndFrame maps the buffer once its fence has passed and the copy is
+	// encoded on the pool through SaveImage. A sequence frame due while every buffer is still in flight is dropped, not
+	// waited for, as is one read back while kMaxEncodes frames are already encoding, each holding a copy of its pixels.
+	// Screenshots wait for both. Destroying the capture finishes everything in flight, so needs the GL context current.
+	class FrameCapture
+	{
+	public:
+		static const unsigned int kNumBuffers{ 3 };
+		static const unsigned int kMaxEncodes{ 4 };
+
+		explicit FrameCapture(ThreadPool& pool = ThreadPool::Shared()) : m_pool(pool) {}
+		~FrameCapture();
+
+		FrameCapture(const FrameCapture&) = delete;
+		FrameCapture& operator=(const FrameCapture&) = delete;
+
+		// Captures the next frame to path, without extension as SaveImage adds ".png". Folders are made if need be.
+		void RequestScreenshot(const std::string& path);
+
+		// Captures every interval-th frame from the next to prefix followed by the frame number, until StopSequence
+		void StartSequence(const std::string& prefix, unsigned int interval);
+		void StopSequence();
+		bool IsCapturingSequence() const { return m_sequenceInterval != 0; }
+
+		// Once a frame, after drawing what is to be captured and before swapping buffers. GL thread only.
+		void EndFrame();
+
+		// Frames counted by EndFrame
+		uint64_t GetFrame() const { return m_frame; }
+
+		std::string ToString() const;
+
+	private:
+		struct Slot
+		{
+			GLuint buffer{ 0 };
+			size_t capacity{ 0 };
+			GLsync fence{ nullptr };
+			int width{ 0 };
+			int height{ 0 };
+			std::string path;
+			bool screenshot{ false };
+		};
+
+		// Reads the framebuffer into the slot, to be collected once its fence passes
+		void Capture(Slot& slot, const std::string& path, bool screenshot);
+
+		// Maps the slots whose reads have finished, oldest first, and hands their pixels to the pool to save.
+		// With wait it waits for every read, and for encodes to make room, rather than leaving them for a later frame.
+		void CollectFinished(bool wait);
+
+		// Checks off the encodes that have finished
+		void CollectSaves();
+
+		ThreadPool& m_pool;
+
+		// Captures go round the ring in order, m_captured counts those started and m_collected those mapped since
+		Slot m_slots[kNumBuffers];
+		uint64_t m_captured{ 0 };
+		uint64_t m_collected{ 0 };
+
+		uint64_t m_frame{ 0 };
+		std::string m_screenshotPath;
+		std::string m_sequencePrefix;
+		unsigned int m_sequenceInterval{ 0 };
+		uint64_t m_sequenceStart{ 0 };
+
+		// PNGs being encoded, checked off as they finish
+		std::vector<std::future<bool>> m_saves;
+		size_t m_saved{ 0 };
+		size_t m_failed{ 0 };
+		size_t m_dropped{ 0 };
+		size_t m_droppedEncoding{ 0 };
+	};
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "ExternalLibraryHeaders.h"
+
+namespace Helpers
+{
+	// View frustum as six planes facing inwards, xyz is the normal and w the distance
+	// Built from a combined matrix so from projection * view * model it is in model space
+	struct Frustum
+	{
+		glm::vec4 planes[6];
+
+		// Extracts the planes from a clip space transform (Gribb / Hartmann)
+		static Frustum FromMatrix(const glm::mat4& m)
+		{
+			const glm::vec4 row0{ m[0][0], m[1][0], m[2][0], m[3][0] };
+			const glm::vec4 row1{ m[0][1], m[1][1], m[2][1], m[3][1] };
+			const glm::vec4 row2{ m[0][2], m[1][2], m[2][2], m[3][2] };
+			const glm::vec4 row3{ m[0][3], m[1][3], m[2][3], m[3][3] };
+
+			Frustum frustum;
+			frustum.planes[0] = row3 + row0;	// Left
+			frustum.planes[1] = row3 - row0;	// Right
+			frustum.planes[2] = row3 + row1;	// Bottom
+			frustum.planes[3] = row3 - row1;	// Top
+			frustum.planes[4] = row3 + row2;	// Near
+			frustum.planes[5] = row3 - row2;	// Far
+
+			// Normalise so plane distances are real distances and can be compared with a radius
+			for (glm::vec4& plane : frustum.planes)
+				plane /= glm::length(glm::vec3(plane));
+
+			return frustum;
+		}
+
+		// True if any of the sphere is inside
+		bool IntersectsSphere(const glm::vec3& centre, float radius) const
+		{
+			for (const glm::vec4& plane : planes)
+			{
+				if (glm::dot(glm::vec3(plane), centre) + plane.w < -radius)
+					return false;
+			}
+			return true;
+		}
+	};
+}
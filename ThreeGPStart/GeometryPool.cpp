@@ -0,0 +1,338 @@
+#include "GeometryPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+namespace Helpers
+{
+	RangeAllocator::RangeAllocator(size_t capacity)
+	{
+		Grow(capacity);
+	}
+
+	// First fit, taking the front of the free range so what is left keeps its place in the map
+	size_t RangeAllocator::Allocate(size_t size)
+	{
+		if (size == 0)
+			return kInvalid;
+
+		for (auto range{ m_free.begin() }; range != m_free.end(); ++range)
+		{
+			if (range->second < size)
+				continue;
+
+			const size_t offset{ range->first };
+			const size_t remaining{ range->second - size };
+			m_free.erase(range);
+			if (remaining)
+				m_free.emplace(offset + size, remaining);
+			m_used += size;
+			return offset;
+		}
+		return kInvalid;
+	}
+
+	// Puts the range back, merged with the free ranges either side of it
+	void RangeAllocator::Free(size_t offset, size_t size)
+	{
+		if (size == 0)
+			return;
+		m_used -= size;
+
+		auto next{ m_free.lower_bound(offset) };
+		if (next != m_free.end() && offset + size == next->first)
+		{
+			size += next->second;
+			next = m_free.erase(next);
+		}
+
+		if (next != m_free.begin())
+		{
+			auto previous{ std::prev(next) };
+			if (previous->first + previous->second == offset)
+			{
+				previous->second += size;
+				return;
+			}
+		}
+		m_free.emplace_hint(next, offset, size);
+	}
+
+	void RangeAllocator::Grow(size_t newCapacity)
+	{
+		if (newCapacity <= m_capacity)
+			return;
+
+		const size_t added{ newCapacity - m_capacity };
+		const size_t oldCapacity{ m_capacity };
+		m_capacity = newCapacity;
+
+		// Free adds the space back to used, so count it as used first
+		m_used += added;
+		Free(oldCapacity, added);
+	}
+
+	size_t RangeAllocator::GetLargestFree() const
+	{
+		size_t largest{ 0 };
+		for (const auto& range : m_free)
+			largest = std::max(largest, range.second);
+		return largest;
+	}
+
+	// Random allocates and frees, each checked against which units are taken. Timed separately from the checking.
+	RangeAllocatorBenchmarkResult BenchmarkRangeAllocator(size_t operations, size_t capacity)
+	{
+		RangeAllocatorBenchmarkResult result;
+		result.operations = operations;
+
+		// Fixed seed so runs are comparable
+		std::mt19937 random(1234);
+		std::uniform_int_distribution<size_t> sizes(1, 64);
+		RangeAllocator allocator(capacity);
+		std::vector<bool> taken(capacity, false);
+		std::vector<std::pair<size_t, size_t>> live;
+		size_t used{ 0 };
+		std::chrono::duration<double, std::milli> elapsed{ 0 };
+
+		for (size_t operation = 0; operation < operations; operation++)
+		{
+			// Half way through the span doubles, as a full pool buffer does
+			if (operation == operations / 2)
+			{
+				capacity *= 2;
+				allocator.Grow(capacity);
+				taken.resize(capacity, false);
+			}
+
+			if (live.empty() || random() % 2)
+			{
+				const size_t size{ sizes(random) };
+				const auto start{ std::chrono::high_resolution_clock::now() };
+				const size_t offset{ allocator.Allocate(size) };
+				elapsed += std::chrono::high_resolution_clock::now() - start;
+				if (offset == RangeAllocator::kInvalid)
+				{
+					result.failedAllocations++;
+					continue;
+				}
+
+				if (offset + size > capacity || std::any_of(taken.begin() + offset, taken.begin() + offset + size, [](bool unit) { return unit; }))
+					result.overlaps++;
+				else
+					std::fill(taken.begin() + offset, taken.begin() + offset + size, true);
+				live.emplace_back(offset, size);
+				used += size;
+			}
+			else
+			{
+				const size_t index{ random() % live.size() };
+				const auto start{ std::chrono::high_resolution_clock::now() };
+				allocator.Free(live[index].first, live[index].second);
+				elapsed += std::chrono::high_resolution_clock::now() - start;
+				std::fill(taken.begin() + live[index].first, taken.begin() + std::min(live[index].first + live[index].second, capacity), false);
+				used -= live[index].second;
+				live[index] = live.back();
+				live.pop_back();
+			}
+
+			if (allocator.GetUsed() != used)
+				result.usedMismatches++;
+		}
+
+		for (const auto& range : live)
+			allocator.Free(range.first, range.second);
+		result.capacity = capacity;
+		result.milliseconds = elapsed.count();
+		result.coalesced = allocator.GetUsed() == 0 && allocator.NumFreeRanges() == 1 && allocator.GetLargestFree() == capacity;
+		return result;
+	}
+
+	GeometryPool::GeometryPool(const GeometryPoolSettings& settings) : m_settings(settings)
+	{
+		m_positions.stride = sizeof(glm::vec3);
+		m_normals.stride = sizeof(glm::vec3);
+		m_uvCoords.stride = sizeof(glm::vec2);
+		m_elements.stride = sizeof(GLuint);
+		m_instances.stride = sizeof(glm::mat4);
+	}
+
+	GeometryPool::~GeometryPool()
+	{
+		glDeleteVertexArrays(1, &m_vao);
+		for (Stream* stream : { &m_positions, &m_normals, &m_uvCoords, &m_elements, &m_instances })
+			glDeleteBuffers(1, &stream->buffer);
+	}
+
+	// Buffers are made on first use rather than in the constructor, which may run before there is a GL context
+	void GeometryPool::Create()
+	{
+		m_vertexRanges.Grow(std::max<size_t>(m_settings.initialVertices, 1));
+		m_elementRanges.Grow(std::max<size_t>(m_settings.initialElements, 1));
+		m_instanceRanges.Grow(std::max<size_t>(m_settings.initialInstances, 1));
+
+		for (Stream* stream : { &m_positions, &m_normals, &m_uvCoords })
+			Resize(*stream, 0, m_vertexRanges.GetCapacity());
+		Resize(m_elements, 0, m_elementRanges.GetCapacity());
+		Resize(m_instances, 0, m_instanceRanges.GetCapacity());
+
+		m_vao = CreateVertexArray();
+		BindBuffers(m_vao);
+
+		// Instance 0 is the identity, for mesh drawn once without a transform of their own
+		const glm::mat4 identity{ 1 };
+		m_instanceRanges.Allocate(1);
+		glNamedBufferSubData(m_instances.buffer, 0, sizeof(glm::mat4), &identity);
+	}
+
+	// Copies the old contents across on the GPU, the old buffer is deleted once the copy is queued
+	void GeometryPool::Resize(Stream& stream, size_t oldCapacity, size_t newCapacity)
+	{
+		GLuint buffer{ 0 };
+		glCreateBuffers(1, &buffer);
+		glNamedBufferData(buffer, stream.stride * newCapacity, nullptr, GL_STATIC_DRAW);
+		if (stream.buffer)
+		{
+			glCopyNamedBufferSubData(stream.buffer, buffer, 0, 0, stream.stride * oldCapacity);
+			glDeleteBuffers(1, &stream.buffer);
+			m_growCount++;
+		}
+		stream.buffer = buffer;
+
+		if (m_vao)
+			BindBuffers(m_vao);
+	}
+
+	// Attributes 0 to 2 on bindings 0 to 2, the instance transform's columns on binding 3
+	GLuint GeometryPool::CreateVertexArray() const
+	{
+		GLuint vao{ 0 };
+		glCreateVertexArrays(1, &vao);
+
+		glVertexArrayAttribFormat(vao, 0, 3, GL_FLOAT, GL_FALSE, 0);
+		glVertexArrayAttribFormat(vao, 1, 3, GL_FLOAT, GL_FALSE, 0);
+		glVertexArrayAttribFormat(vao, 2, 2, GL_FLOAT, GL_FALSE, 0);
+		for (GLuint attribute = 0; attribute < 3; attribute++)
+		{
+			glVertexArrayAttribBinding(vao, attribute, attribute);
+			glEnableVertexArrayAttrib(vao, attribute);
+		}
+
+		for (GLuint column = 0; column < 4; column++)
+		{
+			glVertexArrayAttribFormat(vao, 3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4) * column);
+			glVertexArrayAttribBinding(vao, 3 + column, 3);
+			glEnableVertexArrayAttrib(vao, 3 + column);
+		}
+		glVertexArrayBindingDivisor(vao, 3, 1);
+
+		return vao;
+	}
+
+	void GeometryPool::BindBuffers(GLuint vao) const
+	{
+		glVertexArrayVertexBuffer(vao, 0, m_positions.buffer, 0, (GLsizei)m_positions.stride);
+		glVertexArrayVertexBuffer(vao, 1, m_normals.buffer, 0, (GLsizei)m_normals.stride);
+		glVertexArrayVertexBuffer(vao, 2, m_uvCoords.buffer, 0, (GLsizei)m_uvCoords.stride);
+		glVertexArrayVertexBuffer(vao, 3, m_instances.buffer, 0, (GLsizei)m_instances.stride);
+		glVertexArrayElementBuffer(vao, m_elements.buffer);
+	}
+
+	void GeometryPool::AttachTo(GLuint vao, const GeometryRange& range) const
+	{
+		glVertexArrayVertexBuffer(vao, 2, m_uvCoords.buffer, m_uvCoords.stride * range.baseVertex, (GLsizei)m_uvCoords.stride);
+		glVertexArrayVertexBuffer(vao, 3, m_instances.buffer, 0, (GLsizei)m_instances.stride);
+		glVertexArrayElementBuffer(vao, m_elements.buffer);
+	}
+
+	GeometryRange GeometryPool::Add(const glm::vec3* positions, const glm::vec3* normals, const glm::vec2* uvCoords, size_t numVertices,
+		const GLuint* elements, size_t numElements)
+	{
+		if (numVertices == 0 || numElements == 0)
+			return GeometryRange();
+		if (!m_vao)
+			Create();
+
+		size_t vertex{ m_vertexRanges.Allocate(numVertices) };
+		while (vertex == RangeAllocator::kInvalid)
+		{
+			const size_t oldCapacity{ m_vertexRanges.GetCapacity() };
+			m_vertexRanges.Grow(oldCapacity * 2);
+			for (Stream* stream : { &m_positions, &m_normals, &m_uvCoords })
+				Resize(*stream, oldCapacity, m_vertexRanges.GetCapacity());
+			vertex = m_vertexRanges.Allocate(numVertices);
+		}
+
+		size_t element{ m_elementRanges.Allocate(numElements) };
+		while (element == RangeAllocator::kInvalid)
+		{
+			const size_t oldCapacity{ m_elementRanges.GetCapacity() };
+			m_elementRanges.Grow(oldCapacity * 2);
+			Resize(m_elements, oldCapacity, m_elementRanges.GetCapacity());
+			element = m_elementRanges.Allocate(numElements);
+		}
+
+		const std::pair<Stream*, const void*> attributes[]{ { &m_positions, positions }, { &m_normals, normals }, { &m_uvCoords, uvCoords } };
+		for (const auto& attribute : attributes)
+		{
+			if (attribute.second)
+				glNamedBufferSubData(attribute.first->buffer, attribute.first->stride * vertex, attribute.first->stride * numVertices, attribute.second);
+		}
+		glNamedBufferSubData(m_elements.buffer, m_elements.stride * element, m_elements.stride * numElements, elements);
+
+		GeometryRange range;
+		range.baseVertex = (GLint)vertex;
+		range.numVertices = (GLuint)numVertices;
+		range.firstElement = (GLuint)element;
+		range.numElements = (GLuint)numElements;
+		return range;
+	}
+
+	void GeometryPool::Remove(const GeometryRange& range)
+	{
+		if (!range.IsValid())
+			return;
+		m_vertexRanges.Free(range.baseVertex, range.numVertices);
+		m_elementRanges.Free(range.firstElement, range.numElements);
+	}
+
+	InstanceRange GeometryPool::AddInstances(const glm::mat4* transforms, size_t count)
+	{
+		if (count == 0)
+			return InstanceRange();
+		if (!m_vao)
+			Create();
+
+		size_t instance{ m_instanceRanges.Allocate(count) };
+		while (instance == RangeAllocator::kInvalid)
+		{
+			const size_t oldCapacity{ m_instanceRanges.GetCapacity() };
+			m_instanceRanges.Grow(oldCapacity * 2);
+			Resize(m_instances, oldCapacity, m_instanceRanges.GetCapacity());
+			instance = m_instanceRanges.Allocate(count);
+		}
+		glNamedBufferSubData(m_instances.buffer, m_instances.stride * instance, m_instances.stride * count, transforms);
+
+		return InstanceRange{ (GLuint)instance, (GLsizei)count };
+	}
+
+	// The shared identity at instance 0 is never freed
+	void GeometryPool::RemoveInstances(const InstanceRange& range)
+	{
+		if (range.baseInstance != 0)
+			m_instanceRanges.Free(range.baseInstance, range.count);
+	}
+
+	std::string GeometryPool::ToString() const
+	{
+		const auto megabytes = [](size_t bytes) { return std::to_string(bytes / (1024 * 1024)) + " MB"; };
+		const size_t vertexBytes{ (size_t)(m_positions.stride + m_normals.stride + m_uvCoords.stride) * m_vertexRanges.GetCapacity() };
+		return "Geometry pool: Vertices: " + std::to_string(m_vertexRanges.GetUsed()) + " / " + std::to_string(m_vertexRanges.GetCapacity()) +
+			" Elements: " + std::to_string(m_elementRanges.GetUsed()) + " / " + std::to_string(m_elementRanges.GetCapacity()) +
+			" Instances: " + std::to_string(m_instanceRanges.GetUsed()) + " / " + std::to_string(m_instanceRanges.GetCapacity()) +
+			" Size: " + megabytes(vertexBytes + m_elements.stride * m_elementRanges.GetCapacity() + m_instances.stride * m_instanceRanges.GetCapacity()) +
+			" Free ranges: " + std::to_string(m_vertexRanges.NumFreeRanges() + m_elementRanges.NumFreeRanges()) +
+			" Grown: " + std::to_string(m_growCount);
+	}
+}
@@ -0,0 +1,171 @@
+#pragma once
+// Vertex, element and instance buffers shared by every mesh of one vertex format, drawn with a base vertex
+
+#include "ExternalLibraryHeaders.h"
+
+#include <map>
+
+namespace Helpers
+{
+	// Hands out ranges of a span counted in whatever units the caller likes. First fit from a free list kept in
+	// offset order, so a freed range merges with free neighbours and the span does not fragment for good.
+	class RangeAllocator
+	{
+	public:
+		static const size_t kInvalid{ SIZE_MAX };
+
+		explicit RangeAllocator(size_t capacity = 0);
+
+		// Start of a free range of size units, kInvalid when no free range is big enough
+		size_t Allocate(size_t size);
+
+		// Returns a range from Allocate
+		void Free(size_t offset, size_t size);
+
+		// Adds free space to the end, joining any free range already there
+		void Grow(size_t newCapacity);
+
+		size_t GetCapacity() const { return m_capacity; }
+		size_t GetUsed() const { return m_used; }
+		size_t NumFreeRanges() const { return m_free.size(); }
+
+		// Largest request that would succeed without growing
+		size_t GetLargestFree() const;
+
+	private:
+		// Size of each free range by its offset
+		std::map<size_t, size_t> m_free;
+		size_t m_capacity{ 0 };
+		size_t m_used{ 0 };
+	};
+
+	struct RangeAllocatorBenchmarkResult
+	{
+		size_t capacity{ 0 };
+		size_t operations{ 0 };
+		size_t failedAllocations{ 0 };
+		double milliseconds{ 0 };
+
+		// Ranges handed out over ones still live or outside the span, and the count and used total going wrong
+		size_t overlaps{ 0 };
+		size_t usedMismatches{ 0 };
+
+		// Once everything is freed the whole span is one free range again
+		bool coalesced{ false };
+
+		bool Passed() const { return overlaps == 0 && usedMismatches == 0 && coalesced; }
+
+		std::string ToString() const {
+			return "Range allocator " + std::to_string(operations) + " random allocates and frees in " + std::to_string(capacity) +
+				" units: " + std::to_string(milliseconds) + " ms Failed allocations: " + std::to_string(failedAllocations) +
+				" Overlaps: " + std::to_string(overlaps) + " Used mismatches: " + std::to_string(usedMismatches) +
+				" Coalesced: " + (coalesced ? "yes" : "NO") + (Passed() ? " PASS" : " FAIL");
+		}
+	};
+
+	// Runs random allocates and frees, growing the span halfway, checking each against a map of which units are taken
+	RangeAllocatorBenchmarkResult BenchmarkRangeAllocator(size_t operations = 100000, size_t capacity = 10000);
+
+	struct GeometryPoolSettings
+	{
+		// Starting sizes, each doubles as often as needed when full
+		size_t initialVertices{ 256 * 1024 };
+		size_t initialElements{ 1024 * 1024 };
+		size_t initialInstances{ 256 };
+	};
+
+	// Where a mesh's vertices and elements sit in the pool. Elements index from the mesh's own first vertex,
+	// baseVertex is added by the draw.
+	struct GeometryRange
+	{
+		GLint baseVertex{ 0 };
+		GLuint numVertices{ 0 };
+		GLuint firstElement{ 0 };
+		GLuint numElements{ 0 };
+
+		bool IsValid() const { return numElements != 0; }
+	};
+
+	// Where a mesh's per instance transforms sit in the pool, drawn with baseInstance
+	struct InstanceRange
+	{
+		GLuint baseInstance{ 0 };
+		GLsizei count{ 1 };
+	};
+
+	// Positions (attribute 0), normals (1) and texture coordinates (2) each in a buffer of their own, 32 bit elements,
+	// and a mat4 per instance in attributes 3 to 6. One vertex array reads them all, so every mesh in the pool draws
+	// with no vertex array or buffer bind between them, through glDrawElementsInstancedBaseVertexBaseInstance or
+	// glMultiDrawElementsBaseVertex. Instance 0 is always the identity, for mesh drawn once where they are.
+	// A full buffer is replaced by one twice the size with the contents copied across, so ranges stay where they are.
+	// GL thread only.
+	class GeometryPool
+	{
+	public:
+		explicit GeometryPool(const GeometryPoolSettings& settings = GeometryPoolSettings());
+		~GeometryPool();
+
+		GeometryPool(const GeometryPool&) = delete;
+		GeometryPool& operator=(const GeometryPool&) = delete;
+
+		// Copies in a mesh's vertices, any attribute may be null to leave it unset, and its elements
+		GeometryRange Add(const glm::vec3* positions, const glm::vec3* normals, const glm::vec2* uvCoords, size_t numVertices,
+			const GLuint* elements, size_t numElements);
+
+		// Frees a range from Add, the space is reused by later mesh
+		void Remove(const GeometryRange& range);
+
+		// Copies in the transforms of a mesh drawn count times
+		InstanceRange AddInstances(const glm::mat4* transforms, size_t count);
+		void RemoveInstances(const InstanceRange& range);
+
+		// The vertex array every mesh in the pool draws with, 0 until the first Add
+		GLuint GetVertexArray() const { return m_vao; }
+
+		// Creates a vertex array in the pool's format, for mesh whose positions and normals live elsewhere (skinned mesh,
+		// say). AttachTo points it at the pool.
+		GLuint CreateVertexArray() const;
+
+		// Points vao's texture coordinates, elements and instances at the pool's buffers, with the range's first vertex
+		// as its vertex 0 so it draws with a base vertex of 0. Repeat after the pool may have grown.
+		// Bindings 0 and 1 are left to the caller.
+		void AttachTo(GLuint vao, const GeometryRange& range) const;
+
+		// Times a buffer was replaced to grow, arrays from CreateVertexArray need AttachTo again after each
+		size_t GetGrowCount() const { return m_growCount; }
+
+		std::string ToString() const;
+
+	private:
+		// One buffer, stride bytes per unit of its allocator
+		struct Stream
+		{
+			GLuint buffer{ 0 };
+			GLsizeiptr stride{ 0 };
+		};
+
+		// Creates the buffers and vertex array at their starting sizes
+		void Create();
+
+		// Replaces the stream's buffer with one of newCapacity units, copying the old contents to the start
+		void Resize(Stream& stream, size_t oldCapacity, size_t newCapacity);
+
+		// Binds every buffer to the vertex array's bindings
+		void BindBuffers(GLuint vao) const;
+
+		GeometryPoolSettings m_settings;
+
+		GLuint m_vao{ 0 };
+		Stream m_positions;
+		Stream m_normals;
+		Stream m_uvCoords;
+		Stream m_elements;
+		Stream m_instances;
+
+		RangeAllocator m_vertexRanges;
+		RangeAllocator m_elementRanges;
+		RangeAllocator m_instanceRanges;
+
+		size_t m_growCount{ 0 };
+	};
+}
@@ -0,0 +1,51 @@
+#pragma once
+// Fast non-cryptographic hashing of raw data, used to spot duplicate content
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace Helpers
+{
+	// 64 bit hash of size bytes, eight at a time. Chain calls by passing the previous result as the seed.
+	inline uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0x9E3779B97F4A7C15ull)
+	{
+		const uint64_t kMultiplier{ 0x9FB21C651E98DF25ull };
+		const unsigned char* bytes{ (const unsigned char*)data };
+		uint64_t hash{ seed ^ (size * kMultiplier) };
+
+		const auto mix{ [&](uint64_t word)
+		{
+			word *= kMultiplier;
+			word ^= word >> 47;
+			hash = (hash ^ word) * kMultiplier;
+		} };
+
+		for (; size >= 8; size -= 8, bytes += 8)
+		{
+			uint64_t word;
+			std::memcpy(&word, bytes, 8);
+			mix(word);
+		}
+
+		if (size)
+		{
+			uint64_t word{ 0 };
+			std::memcpy(&word, bytes, size);
+			mix(word);
+		}
+
+		// Final avalanche so nearby inputs land far apart
+		hash ^= hash >> 33;
+		hash *= 0xFF51AFD7ED558CCDull;
+		hash ^= hash >> 33;
+		return hash;
+	}
+
+	// Hash of a vector's contents, including its length
+	template<typename T>
+	uint64_t HashVector(const std::vector<T>& values, uint64_t seed = 0x9E3779B97F4A7C15ull)
+	{
+		return HashBytes(values.data(), values.size() * sizeof(T), seed);
+	}
+}
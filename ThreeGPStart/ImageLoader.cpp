@@ -1,5 +1,8 @@
 #include "ImageLoader.h"
+#include "PixelConvert.h"
+#include <cstring>
 #include <filesystem>
+#include <utility>
 namespace fs = std::filesystem;
 
 namespace Helpers
@@ -26,15 +29,73 @@ namespace Helpers
 		return calc;
 	}
 
-	// Attempt to load an image from the file and path provided. Returns false on error.
-	bool ImageLoader::Load(const std::string& filepath)
+	// Buffers under 64 KB are all given 64 KB, above that each power of two is a class
+	static constexpr size_t kSmallestBufferClass{ 64 * 1024 };
+
+	ImageBufferPool& ImageBufferPool::Shared()
+	{
+		static ImageBufferPool pool;
+		return pool;
+	}
+
+	// A buffer of at least bytes, capacity is set to its size class
+	std::unique_ptr<BYTE[]> ImageBufferPool::Acquire(size_t bytes, size_t& capacity)
+	{
+		capacity = kSmallestBufferClass;
+		while (capacity < bytes)
+			capacity *= 2;
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			std::vector<std::unique_ptr<BYTE[]>>& free{ m_free[capacity] };
+			if (!free.empty())
+			{
+				std::unique_ptr<BYTE[]> buffer{ std::move(free.back()) };
+				free.pop_back();
+				m_retainedBytes -= capacity;
+				m_reuses++;
+				return buffer;
+			}
+			m_allocations++;
+		}
+
+		// Allocated outside the lock, left uninitialised as the decode overwrites it all
+		return std::unique_ptr<BYTE[]>(new BYTE[capacity]);
+	}
+
+	// Keeps the buffer for the next Acquire of its size class
+	void ImageBufferPool::Release(std::unique_ptr<BYTE[]> buffer, size_t capacity)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!buffer || m_retainedBytes + capacity > m_maxRetainedBytes)
+			return;
+
+		m_free[capacity].push_back(std::move(buffer));
+		m_retainedBytes += capacity;
+	}
+
+	size_t ImageBufferPool::GetRetainedBytes() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_retainedBytes;
+	}
+
+	std::string ImageBufferPool::ToString() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return "Image buffers: Allocations: " + std::to_string(m_allocations) +
+			" Reuses: " + std::to_string(m_reuses) +
+			" Retained: " + std::to_string(m_retainedBytes / 1024) + " KB";
+	}
+
+	// Finds the file's format and opens it, null on error. Flags are passed to FreeImage_Load.
+	static FIBITMAP* OpenBitmap(const std::string& filepath, int flags)
 	{
-		
 		// First check file exists
 		if (!exists(fs::path(filepath)))
 		{
 			std::cout << "File does not exist: " << filepath << std::endl;
-			return false;
+			return nullptr;
 		}
 
 		// Determine the format of the image.
@@ -51,88 +112,257 @@ namespace Helpers
 			if (!FreeImage_FIFSupportsReading(format))
 			{
 				std::cout << "Detected image format cannot be read!" << std::endl;
-				return false;
+				return nullptr;
 			}
 		}
 
 		// If we're here we have a known image format, so load the image into a bitmap
-		FIBITMAP* bitmap{ FreeImage_Load(format, filepath.c_str()) };
+		FIBITMAP* bitmap{ FreeImage_Load(format, filepath.c_str(), flags) };
+		if (!bitmap)
+			std::cout << "FreeImage could not load " << filepath << std::endl;
+		return bitmap;
+	}
+
+	// Byte order of a 24 or 32 bit bitmap's colour, from the masks the library was built with
+	static ChannelOrder GetChannelOrder(FIBITMAP* bitmap)
+	{
+		const unsigned int redMask{ FreeImage_GetRedMask(bitmap) };
+		if (redMask == 0x000000FF)
+			return ChannelOrder::RGB;
+		if (redMask == 0x00FF0000)
+			return ChannelOrder::BGR;
+		return FREEIMAGE_COLORORDER == FREEIMAGE_COLORORDER_BGR ? ChannelOrder::BGR : ChannelOrder::RGB;
+	}
+
+	// Writes the bitmap into destination as 32 bit RGBA, rows bottom first as FreeImage keeps them. Returns false on error.
+	static bool ConvertBitmap(FIBITMAP* bitmap, BYTE* destination)
+	{
+		const int width{ (int)FreeImage_GetWidth(bitmap) };
+		const int height{ (int)FreeImage_GetHeight(bitmap) };
+		const size_t rowBytes{ (size_t)width * 4 };
+		const FREE_IMAGE_TYPE imageType{ FreeImage_GetImageType(bitmap) };
+		const unsigned int bitsPerPixel{ FreeImage_GetBPP(bitmap) };
+
+		// 32 and 24 bit images, nearly everything we load, go a row at a time straight into destination.
+		// 15/04/20: our FreeImage was rebuilt to store RGBA, stock builds store BGRA, so the order is asked for each image.
+		if (imageType == FIT_BITMAP && (bitsPerPixel == 32 || bitsPerPixel == 24))
+		{
+			const ChannelOrder order{ GetChannelOrder(bitmap) };
+			for (int y = 0; y < height; y++)
+			{
+				const BYTE* source{ FreeImage_GetScanLine(bitmap, y) };
+				if (bitsPerPixel == 32)
+					ConvertRGBA32(source, destination + y * rowBytes, width, order);
+				else
+					ConvertRGB24(source, destination + y * rowBytes, width, order);
+			}
+			return true;
+		}
+
+		// FreeImage seems to have an issue converting 16 bit grey scale images to 32 so handling this manually
+		if (imageType == FIT_UINT16)
+		{
+			for (int y = 0; y < height; y++)
+				ConvertGrey16((const uint16_t*)FreeImage_GetScanLine(bitmap, y), destination + y * rowBytes, width);
+			return true;
+		}
+
+		// Anything else (palettes, 16 bit colour, transparency tables) through FreeImage's own conversion first
+		FIBITMAP* bitmap32{ FreeImage_ConvertTo32Bits(bitmap) };
+		if (!bitmap32)
+		{
+			std::cout << "ImageLoader::Load failed to convert image to 32 bits" << std::endl;
+			return false;
+		}
+		const ChannelOrder order{ GetChannelOrder(bitmap32) };
+		for (int y = 0; y < height; y++)
+			ConvertRGBA32(FreeImage_GetScanLine(bitmap32, y), destination + y * rowBytes, width, order);
+		FreeImage_Unload(bitmap32);
+		return true;
+	}
+
+	ImageLoader::ImageLoader(ImageLoader&& other) noexcept
+	{
+		*this = std::move(other);
+	}
+
+	ImageLoader& ImageLoader::operator=(ImageLoader&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Reset();
+			m_width = std::exchange(other.m_width, 0);
+			m_height = std::exchange(other.m_height, 0);
+			m_data = std::exchange(other.m_data, nullptr);
+			m_pool = other.m_pool;
+			m_buffer = std::move(other.m_buffer);
+			m_capacity = std::exchange(other.m_capacity, 0);
+		}
+		return *this;
+	}
+
+	// Empties the loader, its buffer going back to the pool
+	void ImageLoader::Reset()
+	{
+		if (m_buffer)
+			m_pool->Release(std::move(m_buffer), m_capacity);
+		m_capacity = 0;
+		m_data = nullptr;
+		m_width = 0;
+		m_height = 0;
+	}
+
+	// Scales each texel's colour by its alpha, for blending with premultiplied alpha
+	void ImageLoader::PremultiplyAlpha()
+	{
+		Helpers::PremultiplyAlpha(m_data, (size_t)m_width * m_height);
+	}
+
+	// An uninitialised width x height image in a buffer from the pool
+	void ImageLoader::Create(int width, int height)
+	{
+		const size_t bytes{ (size_t)width * height * 4 };
+		if (bytes > m_capacity)
+		{
+			Reset();
+			m_buffer = m_pool->Acquire(bytes, m_capacity);
+		}
+		m_width = width;
+		m_height = height;
+		m_data = m_buffer.get();
+	}
+
+	// Attempt to load an image from the file and path provided. Returns false on error.
+	bool ImageLoader::Load(const std::string& filepath)
+	{
+		m_data = nullptr;
+		m_width = 0;
+		m_height = 0;
+
+		FIBITMAP* bitmap{ OpenBitmap(filepath, 0) };
+		if (!bitmap)
+			return false;
+
+		// The buffer from the last load is kept if the image fits, otherwise swapped for one that does
+		const size_t bytes{ (size_t)FreeImage_GetWidth(bitmap) * FreeImage_GetHeight(bitmap) * 4 };
+		if (bytes > m_capacity)
+		{
+			Reset();
+			m_buffer = m_pool->Acquire(bytes, m_capacity);
+		}
+
+		const bool converted{ ConvertBitmap(bitmap, m_buffer.get()) };
+		if (converted)
+		{
+			m_width = FreeImage_GetWidth(bitmap);
+			m_height = FreeImage_GetHeight(bitmap);
+			m_data = m_buffer.get();
+		}
+		FreeImage_Unload(bitmap);
+		return converted;
+	}
+
+	// As Load but decodes into caller memory
+	bool ImageLoader::Load(const std::string& filepath, BYTE* destination, size_t capacity)
+	{
+		Reset();
+
+		FIBITMAP* bitmap{ OpenBitmap(filepath, 0) };
+		if (!bitmap)
+			return false;
+
+		const size_t bytes{ (size_t)FreeImage_GetWidth(bitmap) * FreeImage_GetHeight(bitmap) * 4 };
+		const bool converted{ bytes <= capacity && ConvertBitmap(bitmap, destination) };
+		if (bytes > capacity)
+			std::cout << filepath << " needs " << bytes << " bytes, only given " << capacity << std::endl;
+		else if (converted)
+		{
+			m_width = FreeImage_GetWidth(bitmap);
+			m_height = FreeImage_GetHeight(bitmap);
+			m_data = destination;
+		}
+		FreeImage_Unload(bitmap);
+		return converted;
+	}
 
-		// How many bits-per-pixel is the source image?
-		unsigned int bitsPerPixel{ FreeImage_GetBPP(bitmap) };
-				
-		// Grab size
-		m_width = FreeImage_GetWidth(bitmap);
-		m_height = FreeImage_GetHeight(bitmap);
+	// Size of the image in the file, reading only its header where the format allows
+	bool ImageLoader::ReadSize(const std::string& filepath, int& width, int& height)
+	{
+		FIBITMAP* bitmap{ OpenBitmap(filepath, FIF_LOAD_NOPIXELS) };
+		if (!bitmap)
+			return false;
+
+		width = FreeImage_GetWidth(bitmap);
+		height = FreeImage_GetHeight(bitmap);
+		FreeImage_Unload(bitmap);
+		return true;
+	}
 
-		// Convert our image to 32 bits (8 bits per channel, Red/Green/Blue/Alpha) if not already
-		FIBITMAP* bitmap32{ nullptr };
-		if (bitsPerPixel == 32)
+	// The image as one 16 bit channel, 16 bit grey copied as it is and anything else through RGBA
+	bool LoadGrey16(const std::string& filepath, std::vector<uint16_t>& texels, int& width, int& height)
+	{
+		FIBITMAP* bitmap{ OpenBitmap(filepath, 0) };
+		if (!bitmap)
+			return false;
+
+		width = FreeImage_GetWidth(bitmap);
+		height = FreeImage_GetHeight(bitmap);
+		texels.resize((size_t)width * height);
+
+		bool converted{ true };
+		if (FreeImage_GetImageType(bitmap) == FIT_UINT16)
 		{
-			bitmap32 = bitmap;
+			for (int y = 0; y < height; y++)
+				memcpy(texels.data() + (size_t)y * width, FreeImage_GetScanLine(bitmap, y), (size_t)width * sizeof(uint16_t));
 		}
 		else
 		{
-			bitmap32 = FreeImage_ConvertTo32Bits(bitmap);
-			if (!bitmap32)
+			size_t capacity{ 0 };
+			std::unique_ptr<BYTE[]> rgba{ ImageBufferPool::Shared().Acquire(texels.size() * 4, capacity) };
+			converted = ConvertBitmap(bitmap, rgba.get());
+			if (converted)
+				ConvertRedTo16(rgba.get(), texels.data(), texels.size());
+			ImageBufferPool::Shared().Release(std::move(rgba), capacity);
+		}
+		FreeImage_Unload(bitmap);
+
+		if (!converted)
+		{
+			texels.clear();
+			width = 0;
+			height = 0;
+		}
+		return converted;
+	}
+
+	// Decodes every request at once across the pool. FreeImage keeps no shared state while loading different files,
+	// so each request just loads on whichever thread picks it up. Loaders already in images are reused, keeping their buffers.
+	bool LoadImages(const std::vector<ImageRequest>& requests, std::vector<ImageLoader>& images,
+		std::vector<std::string>& loadedPaths, ThreadPool& pool)
+	{
+		images.resize(requests.size());
+		loadedPaths.assign(requests.size(), std::string());
+
+		pool.ParallelFor(requests.size(), 1, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
 			{
-				const FREE_IMAGE_TYPE image_type{ FreeImage_GetImageType(bitmap) };
-				if (image_type == FIT_UINT16)
+				for (const std::string& path : { requests[i].path, requests[i].fallbackPath })
 				{
-					// FreeImage seems to have an issue converting 16 bit grey scale images to 32 so handling this manually
-					UINT16* textureData{ (UINT16*)FreeImage_GetBits(bitmap) };
-
-					m_data = new GLubyte[(size_t)m_width * (size_t)m_height * 4];
-					size_t count{ 0 };
-					for (size_t i = 0; i < (size_t)m_width * (size_t)m_height * 4; i += 4)
+					if (!path.empty() && images[i].Load(path))
 					{
-						BYTE asByte = (BYTE)(textureData[count++] / 256.0f);
-						m_data[i] = m_data[i + 1] = m_data[i + 2] = asByte;
-						m_data[i + 3] = 255;
+						loadedPaths[i] = path;
+						break;
 					}
-
-					return true;
 				}
-
-				std::cout << "ImageLoader::Load failed to convert image to 32 bits" << std::endl;
-
-				return false;
 			}
-		}		
-
-		// Get a pointer to the texture data as an array of unsigned bytes.
-		// Note: At this point bitmap32 ALWAYS holds a 32-bit colour version of our image - so we get our data from that.
-		// Also, we don't need to delete or delete[] this textureData because it's not on the heap (so attempting to do
-		// so will cause a crash) - just let it go out of scope and the memory will be returned to the stack.
-		BYTE* textureData{ FreeImage_GetBits(bitmap32) };
-
-		m_data = new GLubyte[(size_t)m_width * (size_t)m_height * 1 * 4];
-
-		// Copy to mine, Note: Freeimage data format is GL_BGRA while I need GL_RGBA
-		// Iterate through the pixels, copying the data
-		// from 'pixels' to 'bits' except in RGBA format.		
-
-		//for (int pix = 0; pix < m_width * m_height; pix++)
-		//{
-		//	m_data[pix * 4 + 0] = textureData[pix * 4 + 2];	//r = 3
-		//	m_data[pix * 4 + 1] = textureData[pix * 4 + 1];	//g = 0
-		//	m_data[pix * 4 + 2] = textureData[pix * 4 + 0];	//b = 1
-		//	m_data[pix * 4 + 3] = textureData[pix * 4 + 3];	//a = 2
-		//}
-		
-		// 15/04/20: Rebuilt FreeImage with correct order so now RGBA so no need to convert = quicker :)
-		memcpy(m_data, textureData, (size_t)m_width * (size_t)m_height * 1 * 4);
-		
-		// Unload the 32-bit colour bitmap
-		FreeImage_Unload(bitmap32);
-
-		// If we had to do a conversion to 32-bit colour, then unload the original
-		// non-32-bit-colour version of the image data too. Otherwise, bitmap32 and
-		// bitmap point at the same data, and that data's already been free'd, so
-		// don't attempt to free it again! (or we'll crash).
-		if (bitsPerPixel != 32)
-			FreeImage_Unload(bitmap);
+		});
 
+		for (const std::string& path : loadedPaths)
+		{
+			if (path.empty())
+				return false;
+		}
 		return true;
 	}
 
@@ -1,19 +1,70 @@
 #pragma once
 
 #include "ExternalLibraryHeaders.h"
+#include "ImageSampler.h"
+#include "ThreadPool.h"
+
+#include <memory>
+#include <mutex>
 
 namespace Helpers
 {
+	// Buffers for decoded images in power of two size classes. Loaders give theirs back when done, so bulk loading
+	// reuses a few allocations rather than making one per image. Safe from any thread.
+	class ImageBufferPool
+	{
+	public:
+		// Buffers given back beyond maxRetainedBytes are freed
+		explicit ImageBufferPool(size_t maxRetainedBytes = 256 * 1024 * 1024) : m_maxRetainedBytes(maxRetainedBytes) {}
+
+		ImageBufferPool(const ImageBufferPool&) = delete;
+		ImageBufferPool& operator=(const ImageBufferPool&) = delete;
+
+		// A buffer of at least bytes, capacity is set to its size class
+		std::unique_ptr<BYTE[]> Acquire(size_t bytes, size_t& capacity);
+
+		// Keeps the buffer for the next Acquire of its size class
+		void Release(std::unique_ptr<BYTE[]> buffer, size_t capacity);
+
+		size_t GetRetainedBytes() const;
+
+		std::string ToString() const;
+
+		// Pool every loader uses unless given another
+		static ImageBufferPool& Shared();
+
+	private:
+		mutable std::mutex m_mutex;
+		std::map<size_t, std::vector<std::unique_ptr<BYTE[]>>> m_free;
+		size_t m_maxRetainedBytes{ 0 };
+		size_t m_retainedBytes{ 0 };
+		size_t m_allocations{ 0 };
+		size_t m_reuses{ 0 };
+	};
+
 	// Helper utilising FreeImage to load images / textures
 	// Loaded format is guaranteed to be 32 bit RGBA layout
+	// Pixels are decoded straight into a buffer from the pool, or into memory the caller provides. Move only.
 	class ImageLoader
 	{
 	private:
 		int m_width{ 0 };
 		int m_height{ 0 };
 		BYTE* m_data{ nullptr };
+
+		// Owned buffer from the pool, m_data points into it unless the last load was into caller memory
+		ImageBufferPool* m_pool{ &ImageBufferPool::Shared() };
+		std::unique_ptr<BYTE[]> m_buffer;
+		size_t m_capacity{ 0 };
 	public:
-		~ImageLoader() { delete []m_data; }
+		ImageLoader() = default;
+		explicit ImageLoader(ImageBufferPool& pool) : m_pool(&pool) {}
+		~ImageLoader() { Reset(); }
+
+		ImageLoader(const ImageLoader&) = delete;
+		ImageLoader& operator=(const ImageLoader&) = delete;
+		ImageLoader(ImageLoader&& other) noexcept;
+		ImageLoader& operator=(ImageLoader&& other) noexcept;
 
 		// Width in texels of the image
 		int Width() const { return m_width; }
@@ -21,16 +72,55 @@ namespace Helpers
 		// Height in texels of the image
 		int Height() const { return m_height; }
 
-		// Attempt to load an image from the file and path provided. Returns false on error.
+		// Attempt to load an image from the file and path provided. Returns false on error, leaving the loader empty.
+		// Loading again reuses the buffer if the new image fits.
 		bool Load(const std::string& filepath);
 
+		// As Load but decodes into destination, capacity bytes long, which must outlive the loader's use of it.
+		// Returns false if the image needs more than capacity, ReadSize gives the size needed.
+		bool Load(const std::string& filepath, BYTE* destination, size_t capacity);
+
+		// Size of the image in the file, reading only its header where the format allows. Returns false on error.
+		static bool ReadSize(const std::string& filepath, int& width, int& height);
+
+		// An uninitialised width x height image in a buffer from the pool, for images made rather than loaded
+		void Create(int width, int height);
+
+		// Empties the loader, its buffer going back to the pool
+		void Reset();
+
+		// Scales each texel's colour by its alpha, for blending with premultiplied alpha
+		void PremultiplyAlpha();
+
 		// Allows access to the raw bytes that make up the image laid out in RGBA format (8 bits per channel)
 		BYTE* GetData() const { return m_data; }
 
 		// Returns a grey scale value at provided uv, useful for RMA textures
 		BYTE GetGreyValue(float u, float v) const;
+
+		// Grey values at count uvs, filtered, many at once. See Helpers::SampleGrey.
+		void SampleGrey(const glm::vec2* uvs, size_t count, float* results, const SamplerSettings& settings = SamplerSettings()) const {
+			Helpers::SampleGrey(m_data, m_width, m_height, uvs, count, results, settings);
+		}
+	};
+
+	// Loads the image as one 16 bit channel, rows bottom first, for height maps and the like uploaded as GL_R16.
+	// 16 bit grey images keep every bit, where ImageLoader keeps the top 8. Others give their red, x 257 so 255 is 65535.
+	// Returns false on error, leaving texels empty.
+	bool LoadGrey16(const std::string& filepath, std::vector<uint16_t>& texels, int& width, int& height);
+
+	// One image for LoadImages, fallbackPath (if any) is tried when path fails to load
+	struct ImageRequest
+	{
+		std::string path;
+		std::string fallbackPath;
 	};
 
+	// Decodes every request at once across the pool, the calling thread helping, so it is safe to call from a worker.
+	// images[i] holds request i and loadedPaths[i] the path it came from, empty if neither loaded. False if any failed.
+	bool LoadImages(const std::vector<ImageRequest>& requests, std::vector<ImageLoader>& images,
+		std::vector<std::string>& loadedPaths, ThreadPool& pool = ThreadPool::Shared());
+
 	// Saves an image to the file and path provided. Returns false on error.
 	// Assumes RGBA 32 bit format. Therefore data size must be width * height * 4
 	// Creates a .png file so you don't add an extension to the passed in filepath
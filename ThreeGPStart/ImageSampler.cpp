@@ -0,0 +1,289 @@
+#include "ImageSampler.h"
+#include "ImageLoader.h"
+#include "Simd.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+namespace Helpers
+{
+	// Red times alpha of one texel, 255 x the grey value
+	static inline int TexelRedAlpha(const unsigned char* rgba, size_t index)
+	{
+		const unsigned char* texel{ rgba + index * 4 };
+		return texel[0] * texel[3];
+	}
+
+	// Texel along one axis for a nearest sample
+	static inline int NearestAxis(float uv, int size, float invSize, SampleWrap wrap)
+	{
+		float x{ uv * size };
+		if (wrap == SampleWrap::Clamp)
+			return (int)std::min(std::max(x, 0.0f), (float)(size - 1));
+
+		x -= std::floor(x * invSize) * size;
+		const int i{ (int)x };
+		return i >= size ? i - size : i;
+	}
+
+	// The two texels along one axis a bilinear sample blends, and the weight of the second
+	static inline void BilinearAxis(float uv, int size, float invSize, SampleWrap wrap, int& i0, int& i1, float& weight)
+	{
+		float x{ uv * size - 0.5f };
+		if (wrap == SampleWrap::Clamp)
+		{
+			x = std::min(std::max(x, 0.0f), (float)(size - 1));
+			const float whole{ std::floor(x) };
+			i0 = (int)whole;
+			i1 = std::min(i0 + 1, size - 1);
+			weight = x - whole;
+			return;
+		}
+
+		// Into 0 - size first, rounding can still land on size itself
+		x -= std::floor(x * invSize) * size;
+		const float whole{ std::floor(x) };
+		i0 = (int)whole;
+		weight = x - whole;
+		if (i0 >= size)
+			i0 -= size;
+		i1 = i0 + 1 == size ? 0 : i0 + 1;
+	}
+
+	// One sample at a time, for targets without SSE2 and the ends of batches
+	static void SampleGreyScalar(const unsigned char* rgba, int width, int height, const glm::vec2* uvs, size_t count,
+		float* results, const SamplerSettings& settings)
+	{
+		const float invWidth{ 1.0f / width };
+		const float invHeight{ 1.0f / height };
+
+		for (size_t i = 0; i < count; i++)
+		{
+			if (settings.filter == SampleFilter::Nearest)
+			{
+				const int x{ NearestAxis(uvs[i].x, width, invWidth, settings.wrap) };
+				const int y{ NearestAxis(uvs[i].y, height, invHeight, settings.wrap) };
+				results[i] = TexelRedAlpha(rgba, (size_t)y * width + x) * (1.0f / 255.0f);
+				continue;
+			}
+
+			int x0, x1, y0, y1;
+			float fx, fy;
+			BilinearAxis(uvs[i].x, width, invWidth, settings.wrap, x0, x1, fx);
+			BilinearAxis(uvs[i].y, height, invHeight, settings.wrap, y0, y1, fy);
+
+			const float g00{ TexelRedAlpha(rgba, (size_t)y0 * width + x0) * (1.0f / 255.0f) };
+			const float g10{ TexelRedAlpha(rgba, (size_t)y0 * width + x1) * (1.0f / 255.0f) };
+			const float g01{ TexelRedAlpha(rgba, (size_t)y1 * width + x0) * (1.0f / 255.0f) };
+			const float g11{ TexelRedAlpha(rgba, (size_t)y1 * width + x1) * (1.0f / 255.0f) };
+			const float bottom{ g00 + (g10 - g00) * fx };
+			const float top{ g01 + (g11 - g01) * fx };
+			results[i] = bottom + (top - bottom) * fy;
+		}
+	}
+
+#if HELPERS_SSE2
+	// SSE2 has no floor, truncate and step down where that went up
+	static inline __m128 Floor4(__m128 x)
+	{
+		const __m128 truncated{ _mm_cvtepi32_ps(_mm_cvttps_epi32(x)) };
+		return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, x), _mm_set1_ps(1.0f)));
+	}
+
+	// Texels along one axis for four nearest samples
+	static inline __m128i NearestAxis4(__m128 uv, int size, float invSize, SampleWrap wrap)
+	{
+		const __m128 sizes{ _mm_set1_ps((float)size) };
+		__m128 x{ _mm_mul_ps(uv, sizes) };
+		if (wrap == SampleWrap::Clamp)
+			return _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(x, _mm_setzero_ps()), _mm_set1_ps((float)(size - 1))));
+
+		x = _mm_sub_ps(x, _mm_mul_ps(Floor4(_mm_mul_ps(x, _mm_set1_ps(invSize))), sizes));
+		const __m128i i{ _mm_cvttps_epi32(x) };
+		const __m128i over{ _mm_cmpgt_epi32(i, _mm_set1_epi32(size - 1)) };
+		return _mm_sub_epi32(i, _mm_and_si128(over, _mm_set1_epi32(size)));
+	}
+
+	// The two texels along one axis four bilinear samples blend, and the weights of the second
+	static inline void BilinearAxis4(__m128 uv, int size, float invSize, SampleWrap wrap, __m128i& i0, __m128i& i1, __m128& weight)
+	{
+		const __m128 sizes{ _mm_set1_ps((float)size) };
+		const __m128i last{ _mm_set1_epi32(size - 1) };
+		__m128 x{ _mm_sub_ps(_mm_mul_ps(uv, sizes), _mm_set1_ps(0.5f)) };
+		if (wrap == SampleWrap::Clamp)
+		{
+			x = _mm_min_ps(_mm_max_ps(x, _mm_setzero_ps()), _mm_set1_ps((float)(size - 1)));
+			const __m128 whole{ Floor4(x) };
+			i0 = _mm_cvttps_epi32(whole);
+			i1 = _mm_add_epi32(i0, _mm_set1_epi32(1));
+			i1 = _mm_add_epi32(i1, _mm_cmpgt_epi32(i1, last));
+			weight = _mm_sub_ps(x, whole);
+			return;
+		}
+
+		x = _mm_sub_ps(x, _mm_mul_ps(Floor4(_mm_mul_ps(x, _mm_set1_ps(invSize))), sizes));
+		const __m128 whole{ Floor4(x) };
+		i0 = _mm_cvttps_epi32(whole);
+		weight = _mm_sub_ps(x, whole);
+		i0 = _mm_sub_epi32(i0, _mm_and_si128(_mm_cmpgt_epi32(i0, last), _mm_set1_epi32(size)));
+		i1 = _mm_add_epi32(i0, _mm_set1_epi32(1));
+		i1 = _mm_andnot_si128(_mm_cmpeq_epi32(i1, _mm_set1_epi32(size)), i1);
+	}
+
+	// Grey values of four RGBA texels, the red of each times its alpha
+	static inline __m128 Grey4(__m128i texels)
+	{
+		// Both are under 256 so the product fits the low 16 bits of each lane, the high 16 bits are 0 x 0
+		const __m128i red{ _mm_and_si128(texels, _mm_set1_epi32(0xFF)) };
+		const __m128i alpha{ _mm_srli_epi32(texels, 24) };
+		return _mm_mul_ps(_mm_cvtepi32_ps(_mm_mullo_epi16(red, alpha)), _mm_set1_ps(1.0f / 255.0f));
+	}
+
+	static inline uint32_t LoadTexel(const unsigned char* texel)
+	{
+		uint32_t value;
+		memcpy(&value, texel, sizeof(value));
+		return value;
+	}
+#endif
+
+	// Grey values at count uvs, four at a time with SSE2
+	void SampleGrey(const unsigned char* rgba, int width, int height, const glm::vec2* uvs, size_t count, float* results,
+		const SamplerSettings& settings)
+	{
+		if (!rgba || width <= 0 || height <= 0)
+		{
+			std::fill(results, results + count, 0.0f);
+			return;
+		}
+
+		size_t i{ 0 };
+#if HELPERS_SSE2
+		const float invWidth{ 1.0f / width };
+		const float invHeight{ 1.0f / height };
+
+		for (; i + 4 <= count; i += 4)
+		{
+			// u0 v0 u1 v1 and u2 v2 u3 v3 into u0 u1 u2 u3 and v0 v1 v2 v3
+			const __m128 first{ _mm_loadu_ps(&uvs[i].x) };
+			const __m128 second{ _mm_loadu_ps(&uvs[i + 2].x) };
+			const __m128 u{ _mm_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0)) };
+			const __m128 v{ _mm_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1)) };
+
+			// There is no gather in SSE2, the texels are read one at a time and the rest is four wide
+			const size_t rowBytes{ (size_t)width * 4 };
+			if (settings.filter == SampleFilter::Nearest)
+			{
+				alignas(16) int x[4], y[4];
+				alignas(16) uint32_t texels[4];
+				_mm_store_si128((__m128i*)x, NearestAxis4(u, width, invWidth, settings.wrap));
+				_mm_store_si128((__m128i*)y, NearestAxis4(v, height, invHeight, settings.wrap));
+				for (int lane = 0; lane < 4; lane++)
+					texels[lane] = LoadTexel(rgba + y[lane] * rowBytes + x[lane] * 4);
+				_mm_storeu_ps(results + i, Grey4(_mm_load_si128((const __m128i*)texels)));
+				continue;
+			}
+
+			__m128i x0, x1, y0, y1;
+			__m128 fx, fy;
+			BilinearAxis4(u, width, invWidth, settings.wrap, x0, x1, fx);
+			BilinearAxis4(v, height, invHeight, settings.wrap, y0, y1, fy);
+
+			alignas(16) int left[4], right[4], lower[4], upper[4];
+			_mm_store_si128((__m128i*)left, x0);
+			_mm_store_si128((__m128i*)right, x1);
+			_mm_store_si128((__m128i*)lower, y0);
+			_mm_store_si128((__m128i*)upper, y1);
+
+			alignas(16) uint32_t texels[4][4];
+			for (int lane = 0; lane < 4; lane++)
+			{
+				const unsigned char* lowerRow{ rgba + lower[lane] * rowBytes };
+				const unsigned char* upperRow{ rgba + upper[lane] * rowBytes };
+				texels[0][lane] = LoadTexel(lowerRow + left[lane] * 4);
+				texels[1][lane] = LoadTexel(lowerRow + right[lane] * 4);
+				texels[2][lane] = LoadTexel(upperRow + left[lane] * 4);
+				texels[3][lane] = LoadTexel(upperRow + right[lane] * 4);
+			}
+
+			const __m128 g00{ Grey4(_mm_load_si128((const __m128i*)texels[0])) };
+			const __m128 g10{ Grey4(_mm_load_si128((const __m128i*)texels[1])) };
+			const __m128 g01{ Grey4(_mm_load_si128((const __m128i*)texels[2])) };
+			const __m128 g11{ Grey4(_mm_load_si128((const __m128i*)texels[3])) };
+			const __m128 bottom{ _mm_add_ps(g00, _mm_mul_ps(_mm_sub_ps(g10, g00), fx)) };
+			const __m128 top{ _mm_add_ps(g01, _mm_mul_ps(_mm_sub_ps(g11, g01), fx)) };
+			_mm_storeu_ps(results + i, _mm_add_ps(bottom, _mm_mul_ps(_mm_sub_ps(top, bottom), fy)));
+		}
+#endif
+		SampleGreyScalar(rgba, width, height, uvs + i, count - i, results + i, settings);
+	}
+
+	// Times sampling a test image at random uvs a call at a time and in batches
+	SamplerBenchmarkResult BenchmarkSampler(int size, size_t numSamples, int iterations)
+	{
+		SamplerBenchmarkResult result;
+		result.size = size;
+		result.numSamples = numSamples;
+		if (size <= 0 || numSamples == 0 || iterations <= 0)
+			return result;
+
+		// Fixed seed so runs are comparable, with partly transparent texels so alpha counts
+		std::mt19937 random(1234);
+		std::uniform_int_distribution<int> noise(0, 255);
+		ImageLoader image;
+		image.Create(size, size);
+		for (size_t texel = 0; texel < (size_t)size * size * 4; texel++)
+			image.GetData()[texel] = (BYTE)noise(random);
+
+		// Positive for GetGreyValue, which cannot take negative uvs, but several repeats across
+		std::uniform_real_distribution<float> coordinate(0.0f, 4.0f);
+		std::vector<glm::vec2> uvs(numSamples);
+		for (glm::vec2& uv : uvs)
+			uv = glm::vec2(coordinate(random), coordinate(random));
+
+		std::vector<float> results(numSamples);
+		const auto nanoseconds{ [&](auto&& sample)
+		{
+			const auto start{ std::chrono::high_resolution_clock::now() };
+			for (int i = 0; i < iterations; i++)
+				sample();
+			return std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - start).count() / iterations / numSamples;
+		} };
+
+		SamplerSettings nearest;
+		nearest.filter = SampleFilter::Nearest;
+		const SamplerSettings bilinear;
+
+		result.getGreyValueNanoseconds = nanoseconds([&]() {
+			for (size_t i = 0; i < numSamples; i++)
+				results[i] = image.GetGreyValue(uvs[i].x, uvs[i].y);
+		});
+		result.nearestNanoseconds = nanoseconds([&]() { image.SampleGrey(uvs.data(), numSamples, results.data(), nearest); });
+		result.bilinearScalarNanoseconds = nanoseconds([&]() {
+			SampleGreyScalar(image.GetData(), size, size, uvs.data(), numSamples, results.data(), bilinear); });
+		result.bilinearNanoseconds = nanoseconds([&]() { image.SampleGrey(uvs.data(), numSamples, results.data(), bilinear); });
+
+		// Both paths over every mode, with uvs either side of 0 - 1 to exercise the wrapping and clamping
+		std::uniform_real_distribution<float> outside(-3.0f, 3.0f);
+		for (glm::vec2& uv : uvs)
+			uv = glm::vec2(outside(random), outside(random));
+
+		std::vector<float> scalar(numSamples);
+		for (SampleFilter filter : { SampleFilter::Nearest, SampleFilter::Bilinear })
+		{
+			for (SampleWrap wrap : { SampleWrap::Repeat, SampleWrap::Clamp })
+			{
+				const SamplerSettings settings{ filter, wrap };
+				SampleGrey(image.GetData(), size, size, uvs.data(), numSamples, results.data(), settings);
+				SampleGreyScalar(image.GetData(), size, size, uvs.data(), numSamples, scalar.data(), settings);
+				for (size_t i = 0; i < numSamples; i++)
+					result.maxDifference = std::max(result.maxDifference, std::abs(results[i] - scalar[i]));
+			}
+		}
+
+		return result;
+	}
+}
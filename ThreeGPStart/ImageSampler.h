@@ -0,0 +1,65 @@
+#pragma once
+// Filtered lookups into RGBA images on the CPU many at a time, for heights, densities and material masks
+
+#include "ExternalLibraryHeaders.h"
+
+namespace Helpers
+{
+	enum class SampleFilter
+	{
+		// The texel the uv falls in
+		Nearest,
+
+		// The four texels around the uv weighted by distance, as GL_LINEAR does
+		Bilinear
+	};
+
+	enum class SampleWrap
+	{
+		// uvs outside 0 - 1 wrap round, for tiling images
+		Repeat,
+
+		// uvs outside 0 - 1 take the edge texel
+		Clamp
+	};
+
+	struct SamplerSettings
+	{
+		SampleFilter filter{ SampleFilter::Bilinear };
+		SampleWrap wrap{ SampleWrap::Repeat };
+	};
+
+	// Grey values at count uvs written to results, 0 - 255. Grey is red scaled by alpha, as ImageLoader::GetGreyValue.
+	// rgba is width x height texels with rows bottom first, so v runs up the image as it does for a GL texture.
+	// Texel centres are at half texels, matching GL. SSE2 works out four samples at a time where available.
+	void SampleGrey(const unsigned char* rgba, int width, int height, const glm::vec2* uvs, size_t count, float* results,
+		const SamplerSettings& settings = SamplerSettings());
+
+	struct SamplerBenchmarkResult
+	{
+		int size{ 0 };
+		size_t numSamples{ 0 };
+
+		// Per sample. GetGreyValue is the nearest texel a call at a time, the rest are batches.
+		double getGreyValueNanoseconds{ 0 };
+		double nearestNanoseconds{ 0 };
+		double bilinearScalarNanoseconds{ 0 };
+		double bilinearNanoseconds{ 0 };
+
+		// Largest difference between the SSE2 and plain C++ paths over every filter and wrap
+		float maxDifference{ 0 };
+
+		// The two paths agree to well under a grey level, rounding aside they do the same sums
+		bool Passed() const { return maxDifference <= 0.001f; }
+
+		std::string ToString() const {
+			return "Sampling " + std::to_string(numSamples) + " uvs from " + std::to_string(size) + "x" + std::to_string(size) +
+				". GetGreyValue: " + std::to_string(getGreyValueNanoseconds) + " ns Nearest: " + std::to_string(nearestNanoseconds) +
+				" ns Bilinear scalar: " + std::to_string(bilinearScalarNanoseconds) + " ns Bilinear: " + std::to_string(bilinearNanoseconds) +
+				" ns Max difference: " + std::to_string(maxDifference) + (Passed() ? " PASS" : " FAIL");
+		}
+	};
+
+	// Times sampling a size x size test image at random uvs one call at a time with GetGreyValue and in batches
+	SamplerBenchmarkResult BenchmarkSampler(int size = 1024, size_t numSamples = 1 << 20, int iterations = 10);
+}
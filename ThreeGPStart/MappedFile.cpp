@@ -0,0 +1,92 @@
+#include "MappedFile.h"
+#include "ExternalLibraryHeaders.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Helpers
+{
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+	{
+		if (this != &other)
+		{
+			Close();
+			m_data = other.m_data;
+			m_size = other.m_size;
+			other.m_data = nullptr;
+			other.m_size = 0;
+		}
+		return *this;
+	}
+
+	// The view keeps the file open, so the handles used to make it are closed straight away
+	bool MappedFile::Open(const std::string& filepath)
+	{
+		Close();
+
+#if defined(_WIN32)
+		HANDLE file{ CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr) };
+		if (file == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+		{
+			CloseHandle(file);
+			return false;
+		}
+
+		HANDLE mapping{ CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) };
+		CloseHandle(file);
+		if (!mapping)
+			return false;
+
+		void* view{ MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) };
+		CloseHandle(mapping);
+		if (!view)
+			return false;
+
+		m_data = static_cast<const unsigned char*>(view);
+		m_size = (size_t)size.QuadPart;
+#else
+		const int file{ open(filepath.c_str(), O_RDONLY) };
+		if (file < 0)
+			return false;
+
+		struct stat status;
+		if (fstat(file, &status) != 0 || status.st_size == 0)
+		{
+			close(file);
+			return false;
+		}
+
+		void* view{ mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, file, 0) };
+		close(file);
+		if (view == MAP_FAILED)
+			return false;
+
+		m_data = static_cast<const unsigned char*>(view);
+		m_size = (size_t)status.st_size;
+#endif
+		return true;
+	}
+
+	void MappedFile::Close()
+	{
+		if (!m_data)
+			return;
+
+#if defined(_WIN32)
+		UnmapViewOfFile(m_data);
+#else
+		munmap(const_cast<unsigned char*>(m_data), m_size);
+#endif
+		m_data = nullptr;
+		m_size = 0;
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+// Read only view of a whole file through the OS's memory mapping, pages are read in as they are touched
+
+#include <cstddef>
+#include <string>
+
+namespace Helpers
+{
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+		~MappedFile() { Close(); }
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		MappedFile(MappedFile&& other) noexcept : m_data(other.m_data), m_size(other.m_size) { other.m_data = nullptr; other.m_size = 0; }
+		MappedFile& operator=(MappedFile&& other) noexcept;
+
+		// Maps the file, closing any already mapped. Returns false on error, or if the file is empty.
+		bool Open(const std::string& filepath);
+
+		void Close();
+
+		// Null until a file is open
+		const unsigned char* Data() const { return m_data; }
+		size_t Size() const { return m_size; }
+
+	private:
+		const unsigned char* m_data{ nullptr };
+		size_t m_size{ 0 };
+	};
+}
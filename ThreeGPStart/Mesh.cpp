@@ -1,8 +1,18 @@
 #include "Mesh.h"
+#include "MeshOptimiser.h"
+#include "MeshSimplifier.h"
+#include "Hash.h"
+#include "Profiler.h"
+
+#include <assimp/DefaultLogger.hpp>
+#include <assimp/Logger.hpp>
+
+#include <cstdlib>
+#include <mutex>
+
 //#include <math.h>
 //#define VERBOSE
 
-#define M_PI 3.14159265358979323846264338327950288
 #define EsAssert assert
 
 namespace Helpers
@@ -11,95 +21,123 @@ namespace Helpers
 	inline glm::vec4 aiColor4DToGlmVec4(aiColor4D col) { return glm::vec4(col.r, col.g, col.b, col.a); }
 	inline std::string aiStringToString(const aiString& str) { return std::string(str.C_Str()); }
 	inline glm::vec3 aiVector3DToGlmVec3(aiVector3D vec) { return glm::vec3(vec.x, vec.y, vec.z); }
+	inline glm::quat aiQuaternionToGlmQuat(const aiQuaternion& q) { return glm::quat(q.w, q.x, q.y, q.z); }
 
-	// OpenGL uses column major matrices while ASSIMP uses row major - this converts
-	inline glm::mat4 aiMatrix4x4ToGlm(const aiMatrix4x4* from)
+	namespace
 	{
-		glm::mat4 to;
+		// Asset being imported on this thread, so timings from concurrent imports are kept apart
+		thread_local std::string t_importName;
 
-		to[0][0] = (GLfloat)from->a1; to[0][1] = (GLfloat)from->b1;  to[0][2] = (GLfloat)from->c1; to[0][3] = (GLfloat)from->d1;
-		to[1][0] = (GLfloat)from->a2; to[1][1] = (GLfloat)from->b2;  to[1][2] = (GLfloat)from->c2; to[1][3] = (GLfloat)from->d2;
-		to[2][0] = (GLfloat)from->a3; to[2][1] = (GLfloat)from->b3;  to[2][2] = (GLfloat)from->c3; to[2][3] = (GLfloat)from->d3;
-		to[3][0] = (GLfloat)from->a4; to[3][1] = (GLfloat)from->b4;  to[3][2] = (GLfloat)from->c4; to[3][3] = (GLfloat)from->d4;
+		// Last post process step to announce itself on this thread
+		thread_local std::string t_importStep;
 
-		return to;
-	}
+		// Receives assimp's log. With AI_CONFIG_GLOB_MEASURE_TIME set assimp's profiler logs "END   `region`, dt= x s"
+		// after each region. Post process steps all share the region "postprocess" but log "<Name> begin" when
+		// they start, so each time is credited to the last step that began.
+		class ImportProfilerLogger : public Assimp::Logger
+		{
+		public:
+			ImportProfilerLogger() : Assimp::Logger(Assimp::Logger::VERBOSE) {}
 
-	// x is roll, y is pitch, z is yaw
-	glm::vec3 aiQuaternionToEulerAngles(aiQuaternion q) {
-		glm::vec3 angles;
+			bool attachStream(Assimp::LogStream*, unsigned int) override { return false; }
+			bool detatchStream(Assimp::LogStream*, unsigned int) override { return false; }
 
-		// roll (x-axis rotation)
-		double sinr_cosp = 2 * (double)(q.w * (double)q.x + q.y * (double)q.z);
-		double cosr_cosp = 1 - 2 * (double)((double)q.x * q.x + (double)q.y * q.y);
-		angles.x = (float)std::atan2(sinr_cosp, cosr_cosp);
+			void OnDebug(const char* message) override
+			{
+				const std::string text{ message };
 
-		// pitch (y-axis rotation)
-		double sinp = 2 * (double)((double)q.w * q.y - (double)q.z * q.x);
-		if (std::abs(sinp) >= 1)
-			angles.y = (float)std::copysign(M_PI / 2, sinp); // use 90 degrees if out of range
-		else
-			angles.y = (float)std::asin(sinp);
+				const size_t begin{ text.rfind(" begin") };
+				if (begin != std::string::npos && begin + 6 == text.size())
+				{
+					t_importStep = text.substr(0, begin);
+					return;
+				}
 
-		// yaw (z-axis rotation)
-		double siny_cosp = 2 * (double)((double)q.w * q.z + (double)q.x * q.y);
-		double cosy_cosp = 1 - 2 * (double)((double)q.y * q.y + (double)q.z * q.z);
-		angles.z = (float)std::atan2(siny_cosp, cosy_cosp);
+				const std::string kEnd{ "END   `" };
+				if (text.compare(0, kEnd.size(), kEnd) != 0)
+					return;
 
-		return angles;
-	}
+				const size_t regionEnd{ text.find('`', kEnd.size()) };
+				const size_t dt{ text.find("dt= ", kEnd.size()) };
+				if (regionEnd == std::string::npos || dt == std::string::npos)
+					return;
 
-	// Retrieve the dimensions of this mesh in local coordinates
-	void Mesh::GetLocalExtents(glm::vec3& minExtents, glm::vec3& maxExtents) const
-	{
-		if (vertices.empty())
-			return;
+				std::string region{ text.substr(kEnd.size(), regionEnd - kEnd.size()) };
+				if (region == "postprocess" && !t_importStep.empty())
+					region = t_importStep;
 
-		minExtents.x = maxExtents.x = vertices[0].x;
-		minExtents.y = maxExtents.y = vertices[0].y;
-		minExtents.z = maxExtents.z = vertices[0].z;
+				Profiler::Get().Record("Import " + t_importName + ": " + region, std::atof(text.c_str() + dt + 4));
+			}
 
-		for (size_t i = 1; i < vertices.size(); i++)
-		{
-			minExtents.x = std::min(minExtents.x, vertices[i].x);
-			minExtents.y = std::min(minExtents.y, vertices[i].y);
-			minExtents.z = std::min(minExtents.z, vertices[i].z);
+			void OnInfo(const char*) override {}
+			void OnWarn(const char*) override {}
+			void OnError(const char* message) override { std::cout << "Assimp: " << message << std::endl; }
+		};
 
-			maxExtents.x = std::max(maxExtents.x, vertices[i].x);
-			maxExtents.y = std::max(maxExtents.y, vertices[i].y);
-			maxExtents.z = std::max(maxExtents.z, vertices[i].z);
+		// Installs the logger the first time it is needed, assimp only has the one
+		void InstallImportProfilerLogger()
+		{
+			static std::once_flag installed;
+			std::call_once(installed, []() { Assimp::DefaultLogger::set(new ImportProfilerLogger()); });
 		}
 	}
 
+	// Sets contentHash from the vertex streams and elements. Levels of detail are generated from these so need no hashing.
+	void Mesh::ComputeContentHash()
+	{
+		uint64_t hash{ HashVector(vertices) };
+		hash = HashVector(normals, hash);
+		hash = HashVector(uvCoords, hash);
+		hash = HashVector(elements, hash);
+		hash = HashVector(boneIndices, hash);
+		hash = HashVector(boneWeights, hash);
+		contentHash = hash;
+	}
+
 	// Load a 3D model form a provided file and path, return false on error
-	bool ModelLoader::LoadFromFile(const std::string& objFilename)
+	bool ModelLoader::LoadFromFile(const std::string& objFilename, ImportProfile profile)
 	{
 		m_filename = objFilename;
 
 #if defined(VERBOSE)
 		std::cout << "\nUsing assimp to load: " << objFilename << std::endl;
 #endif
-		// Commom post processing steps - may slow load but make mesh better optimised
-		unsigned int ppsteps = aiProcess_CalcTangentSpace | // calculate tangents and bitangents if possible
-			aiProcess_JoinIdenticalVertices |				// join identical vertices/ optimize indexing
-			aiProcess_ValidateDataStructure |				// perform a full validation of the loader's output
-			aiProcess_ImproveCacheLocality |				// improve the cache locality of the output vertices
-			aiProcess_RemoveRedundantMaterials |			// remove redundant materials
-			aiProcess_FindDegenerates |						// remove degenerated polygons from the import
-			aiProcess_FindInvalidData |						// detect invalid model data, such as invalid normal vectors
-			aiProcess_GenUVCoords |							// convert spherical, cylindrical, box and planar mapping to proper UVs
-			aiProcess_TransformUVCoords |					// preprocess UV transformations (scaling, translation ...)
-			aiProcess_FindInstances |						// search for instanced meshes and remove them by references to one master
+		InstallImportProfilerLogger();
+		t_importName = objFilename;
+		t_importStep.clear();
+		ScopedTimer loadTimer("Import " + objFilename + ": LoadFromFile");
+
+		// Steps every profile needs, our conversion relies on triangles only and at most four bone weights
+		unsigned int ppsteps = aiProcess_JoinIdenticalVertices |	// join identical vertices/ optimize indexing
 			aiProcess_LimitBoneWeights |					// limit bone weights to 4 per vertex
-			aiProcess_OptimizeMeshes |						// join small meshes, if possible;
 			aiProcess_SplitByBoneCount |					// split meshes with too many bones.
-			aiProcess_GenSmoothNormals |					// generate smooth normal vectors if not existing
-			aiProcess_SplitLargeMeshes |					// split large, unrenderable meshes into submeshes
 			aiProcess_Triangulate |							// triangulate polygons with more than 3 edges
 			aiProcess_SortByPType |							// make 'clean' meshes which consist of a single typ of primitives
-			aiProcess_GenSmoothNormals |					// if no normals then create them
-			aiProcess_GlobalScale |							// KD: Needed for FBX which uses cm rather than metres
-			0;
+			aiProcess_GlobalScale;							// KD: Needed for FBX which uses cm rather than metres
+
+		// Tangents are not used so aiProcess_CalcTangentSpace is never asked for
+		switch (profile)
+		{
+		case ImportProfile::Fast:
+			ppsteps |= aiProcess_GenNormals;				// if no normals then create flat ones, much quicker than smooth
+			break;
+		case ImportProfile::Full:
+			ppsteps |= aiProcess_ValidateDataStructure;	// perform a full validation of the loader's output
+			// Full also does everything Default does
+			[[fallthrough]];
+		case ImportProfile::Default:
+			// Degenerate triangles and bad normals would otherwise reach the optimiser, simplifier and meshlet builder
+			ppsteps |= aiProcess_FindDegenerates |			// remove degenerated polygons from the import
+				aiProcess_FindInvalidData |					// detect invalid model data, such as invalid normal vectors
+				aiProcess_GenSmoothNormals |				// if no normals then create smooth ones
+				aiProcess_RemoveRedundantMaterials |		// remove redundant materials
+				aiProcess_GenUVCoords |						// convert spherical, cylindrical, box and planar mapping to proper UVs
+				aiProcess_TransformUVCoords |				// preprocess UV transformations (scaling, translation ...)
+				aiProcess_FindInstances |					// search for instanced meshes and remove them by references to one master
+				aiProcess_OptimizeMeshes |					// join small meshes, if possible;
+				aiProcess_SplitLargeMeshes;					// split large, unrenderable meshes into submeshes
+			break;
+		}
 
 		// Create an instance of the Importer class
 		Assimp::Importer importer;
@@ -124,11 +162,36 @@ namespace Helpers
 			return false;
 		}
 
-		return PopulateFromAssimpScene(scene);
+		bool result;
+		{
+			ScopedTimer convertTimer("Import " + objFilename + ": PopulateFromAssimpScene");
+			result = PopulateFromAssimpScene(scene, profile);
+		}
+
+#if defined(VERBOSE)
+		std::cout << Profiler::Get().ToString("Import " + objFilename);
+#endif
+		return result;
+	}
+
+	// Loads on a pool thread, each load has its own importer so several can run at once
+	std::future<std::shared_ptr<ModelLoader>> ModelLoader::LoadFromFileAsync(const std::string& objFilename,
+		std::function<void(std::shared_ptr<ModelLoader>)> onLoaded, ImportProfile profile, ThreadPool& pool)
+	{
+		return pool.Submit([objFilename, onLoaded, profile]()
+		{
+			std::shared_ptr<ModelLoader> model{ std::make_shared<ModelLoader>() };
+			if (!model->LoadFromFile(objFilename, profile))
+				model.reset();
+
+			if (onLoaded)
+				onLoaded(model);
+			return model;
+		});
 	}
 
 	// Parse the ASSIMP data into our format
-	bool ModelLoader::PopulateFromAssimpScene(const aiScene* scene)
+	bool ModelLoader::PopulateFromAssimpScene(const aiScene* scene, ImportProfile profile)
 	{
 		// An assimp scene can contain many things I do not need like cameras and lights
 		// Some I may want to support in the future so output that these exist but are being ignored:
@@ -196,6 +259,9 @@ namespace Helpers
 #endif
 		}
 
+		// Cache, overdraw and fetch ordering is done by our own optimiser after conversion
+		MeshOptimiseReport optimiseReport;
+
 		int hasBones{ 0 };
 		int hasTangents{ 0 };
 		int hasColourChannels{ 0 };
@@ -255,6 +321,58 @@ namespace Helpers
 				}
 			}
 
+			// Bone influences, aiProcess_LimitBoneWeights leaves at most four per vertex
+			if (aimesh->HasBones())
+			{
+				newMesh.boneIndices.assign(aimesh->mNumVertices, glm::uvec4(0));
+				newMesh.boneWeights.assign(aimesh->mNumVertices, glm::vec4(0));
+
+				// Slots filled so far per vertex. A weight can legitimately be 0, so it cannot mark a free slot.
+				std::vector<unsigned char> numInfluences(aimesh->mNumVertices, 0);
+
+				for (unsigned int b = 0; b < aimesh->mNumBones; b++)
+				{
+					const aiBone* aibone = aimesh->mBones[b];
+					newMesh.bones.push_back(Bone());
+					newMesh.bones.back().name = aiStringToString(aibone->mName);
+					newMesh.bones.back().offset = aiMatrix4x4ToGlm(aibone->mOffsetMatrix);
+
+					for (unsigned int w = 0; w < aibone->mNumWeights; w++)
+					{
+						const aiVertexWeight& weight = aibone->mWeights[w];
+						glm::vec4& weights = newMesh.boneWeights[weight.mVertexId];
+
+						// Fill the next free slot. Should there be more than four the lightest gives way.
+						unsigned char& count = numInfluences[weight.mVertexId];
+						int slot = count;
+						if (count < 4)
+							count++;
+						else
+						{
+							slot = 0;
+							for (int other = 1; other < 4; other++)
+								if (weights[other] < weights[slot])
+									slot = other;
+							if (weights[slot] >= weight.mWeight)
+								continue;
+						}
+
+						weights[slot] = weight.mWeight;
+						newMesh.boneIndices[weight.mVertexId][slot] = b;
+					}
+				}
+
+				// A vertex no bone influences would skin to the origin, it follows bone 0 instead
+				for (glm::vec4& weights : newMesh.boneWeights)
+				{
+					const float total = weights.x + weights.y + weights.z + weights.w;
+					if (total > 0)
+						weights /= total;
+					else
+						weights = glm::vec4(1, 0, 0, 0);
+				}
+			}
+
 			// Faces contain the vertex indices and due to the flags I set before are always triangles
 			for (unsigned int face = 0; face < aimesh->mNumFaces; face++)
 			{
@@ -265,10 +383,38 @@ namespace Helpers
 
 			// Material index
 			newMesh.materialIndex = aimesh->mMaterialIndex;
+
+			// Reorder triangles and vertices for the GPU
+			if (profile != ImportProfile::Fast)
+			{
+				ScopedTimer optimiseTimer("Import " + m_filename + ": OptimiseMesh");
+				const MeshOptimiseReport meshReport{ OptimiseMesh(newMesh) };
+				optimiseReport.Add(meshReport);
+#if defined(VERBOSE)
+				std::cout << "Optimised mesh " << i << " " << meshReport.ToString() << std::endl;
+#endif
+			}
+
+			// Bounds once the optimiser has dropped any unused vertices
+			newMesh.UpdateBounds();
+			m_bounds.Merge(newMesh.bounds);
+
+			// Reduced detail index buffers sharing this mesh's vertices
+			if (profile != ImportProfile::Fast)
+			{
+				ScopedTimer lodTimer("Import " + m_filename + ": GenerateLods");
+				GenerateLods(newMesh);
+			}
+
+			// After optimising, which is deterministic, so the same mesh in any file hashes the same
+			newMesh.ComputeContentHash();
 		}
+
 #if defined(VERBOSE)
+		if (profile != ImportProfile::Fast)
+			std::cout << "Mesh optimise " << optimiseReport.ToString() << std::endl;
 		if (hasBones)
-			std::cout << "Ignoring: One or more mesh have bones" << std::endl;
+			std::cout << "Skinned mesh: " + std::to_string(hasBones) << std::endl;
 		if (hasColourChannels)
 			std::cout << "Ignoring: One or more mesh has colour channels" << std::endl;
 		if (hasMMoreThanOneUVChannel)
@@ -277,30 +423,54 @@ namespace Helpers
 			std::cout << "Ignoring: One or more mesh has tangents" << std::endl;
 #endif
 		// Hierarchy, ASSIMP calls these nodes
-		m_rootNode = RecurseCreateNode(scene->mRootNode, nullptr);
+		m_hierarchy.Build(scene->mRootNode);
 
+		// Bones are nodes too, look them up now the hierarchy exists
+		for (Mesh& mesh : m_meshVector)
+		{
+			for (Bone& bone : mesh.bones)
+			{
+				bone.nodeIndex = m_hierarchy.FindNode(bone.name);
+				if (bone.nodeIndex == NodeHierarchy::kInvalidNode)
+					std::cout << "Failed to find node for bone " << bone.name << std::endl;
+			}
+		}
+
+		ScopedTimer animationTimer("Import " + m_filename + ": Animations");
+		m_animations.clear();
+		ClipCompressionReport compressionReport;
 		for (size_t i = 0; i < scene->mNumAnimations; i++)
 		{
+			const aiAnimation* aianim = scene->mAnimations[i];
+
+			AnimationClip clip;
+			clip.name = aianim->mName.C_Str();
+			clip.duration = (float)aianim->mDuration;
+
+			// Zero means the file did not say
+			if (aianim->mTicksPerSecond > 0)
+				clip.ticksPerSecond = (float)aianim->mTicksPerSecond;
+
 #if defined(VERBOSE)
 			// Only supporting node animation			
-			if (scene->mAnimations[i]->mNumMeshChannels)
+			if (aianim->mNumMeshChannels)
 				std::cout << "Ignoring: mesh animations" << std::endl;
 
-			if (scene->mAnimations[i]->mNumChannels)
-				std::cout << "Animation has " + std::to_string(scene->mAnimations[i]->mNumChannels) + " Channels" << std::endl;
+			if (aianim->mNumChannels)
+				std::cout << "Animation has " + std::to_string(aianim->mNumChannels) + " Channels" << std::endl;
 #endif
 
 			// Load the channel data
-			for (unsigned int k = 0; k < scene->mAnimations[i]->mNumChannels; k++)
+			for (unsigned int k = 0; k < aianim->mNumChannels; k++)
 			{
-				aiNodeAnim* node = scene->mAnimations[i]->mChannels[k];
+				aiNodeAnim* node = aianim->mChannels[k];
 
 #if defined(VERBOSE)
 				std::cout << "Node: " + aiStringToString(node->mNodeName) << std::endl;
 #endif
 
-				Node* internalNode{ RecurseFindNode(m_rootNode,aiStringToString(node->mNodeName)) };
-				if (!internalNode)
+				const int nodeIndex{ m_hierarchy.FindNode(aiStringToString(node->mNodeName)) };
+				if (nodeIndex == NodeHierarchy::kInvalidNode)
 				{
 					std::cout << "Failed to find internal node for channel animation" << std::endl;
 					continue;
@@ -312,36 +482,45 @@ namespace Helpers
 				std::cout << "Node has " + std::to_string(node->mNumScalingKeys) + " scaling keys" << std::endl;
 #endif
 
+				clip.tracks.push_back(NodeTrack());
+				NodeTrack& track = clip.tracks.back();
+				track.nodeIndex = nodeIndex;
+
 				for (unsigned int j = 0; j < node->mNumPositionKeys; j++)
 				{
-					double time = node->mPositionKeys[j].mTime;
-					aiVector3D val=node->mPositionKeys[j].mValue;
-
-					internalNode->translationAnimationKeys.push_back(AnimationData{ (float)time, aiVector3DToGlmVec3(val) });
+					track.translationTimes.push_back((float)node->mPositionKeys[j].mTime);
+					track.translations.push_back(aiVector3DToGlmVec3(node->mPositionKeys[j].mValue));
 				}
 
 				for (unsigned int j = 0; j < node->mNumRotationKeys; j++)
 				{
-					double time = node->mRotationKeys[j].mTime;
-					aiQuaternion val = node->mRotationKeys[j].mValue;
-
-					internalNode->translationAnimationKeys.push_back(AnimationData{ (float)time, aiQuaternionToEulerAngles(val) });					
+					track.rotationTimes.push_back((float)node->mRotationKeys[j].mTime);
+					track.rotations.push_back(aiQuaternionToGlmQuat(node->mRotationKeys[j].mValue));
 				}
 
 				for (unsigned int j = 0; j < node->mNumScalingKeys; j++)
 				{
-					double time = node->mScalingKeys[j].mTime;
-					aiVector3D val = node->mScalingKeys[j].mValue;
-
-					internalNode->translationAnimationKeys.push_back(AnimationData{ (float)time, aiVector3DToGlmVec3(val) });
-				}				
+					track.scaleTimes.push_back((float)node->mScalingKeys[j].mTime);
+					track.scales.push_back(aiVector3DToGlmVec3(node->mScalingKeys[j].mValue));
+				}
 			}
+
+			// Only the compressed clip is kept
+			ClipCompressionReport clipReport;
+			m_animations.push_back(CompressClip(clip, ClipCompressionSettings(), &clipReport));
+			compressionReport.Add(clipReport);
+#if defined(VERBOSE)
+			std::cout << "Compressed animation " << clip.name << " " << clipReport.ToString() << std::endl;
+#endif
 		}
 
+		if (!m_animations.empty())
+			std::cout << "Animation compression " << compressionReport.ToString() << std::endl;
+
 		std::cout << "Loaded OK" << std::endl;
 
 #if defined(VERBOSE)
-		RecurseOutputHierarchy(m_rootNode, 0);
+		std::cout << m_hierarchy.ToString();
 #endif
 
 #if defined(VERBOSE)
@@ -389,94 +568,4 @@ namespace Helpers
 #endif
 		return true;
 	}
-
-	void ModelLoader::RecurseOutputHierarchy(Node* node, int depth)
-	{
-		for (int i=0;i<depth;i++)
-			std::cout << " ";
-
-		glm::vec3 tran = glm::vec3(node->transform[3]);
-
-		std::cout << "Node name: " << node->name << " Trans: " << tran.x << "," << tran.y << "," << tran.z << " Mesh: ";
-		for (unsigned int m : node->meshIndices)
-			std::cout << m << " ";
-		std::cout << std::endl;
-
-		for (auto n : node->childNodes)
-			RecurseOutputHierarchy(n, depth + 1);
-	}
-
-	Node* ModelLoader::RecurseFindNode(Node* node, const std::string& nodeName)
-	{
-		if (!node)
-			return nullptr;
-
-		if (node->name == nodeName)
-			return node;
-
-		Node* retVal{ nullptr };
-		for (auto child : node->childNodes)
-		{
-			retVal=RecurseFindNode(child, nodeName);
-			if (retVal)
-				break;
-		}
-
-		return retVal;
-	}
-
-	// Recursive node creation
-	Node* ModelLoader::RecurseCreateNode(aiNode* node, Node* parent)
-	{
-		Node* newNode = new Node;
-
-		newNode->name = node->mName.C_Str();
-		newNode->parentNode = parent;
-
-		for (size_t i = 0; i < node->mNumMeshes; i++)
-			newNode->meshIndices.push_back(node->mMeshes[i]);
-
-		newNode->transform = aiMatrix4x4ToGlm(&node->mTransformation);
-		
-		for (size_t i = 0; i < node->mNumChildren; i++)
-			newNode->childNodes.emplace_back(RecurseCreateNode(node->mChildren[i], newNode));
-
-		return newNode;
-	}
-
-	// Recursive deletion of nodes
-	void ModelLoader::RecurseDeleteNode(Node* node)
-	{
-		if (!node)
-			return;
-
-		for (Node* n : node->childNodes)
-			RecurseDeleteNode(n);
-
-		delete node;
-	}
-
-	// Retrieve the dimensions of this model in local coordinates
-	void ModelLoader::GetLocalExtents(glm::vec3& minExtents, glm::vec3& maxExtents) const
-	{
-		if (m_meshVector.empty())
-			return;
-
-		m_meshVector[0].GetLocalExtents(minExtents, maxExtents);
-
-		for (size_t i = 1; i < m_meshVector.size(); i++)
-		{
-			glm::vec3 newMin;
-			glm::vec3 newMax;
-			m_meshVector[0].GetLocalExtents(newMin, newMax);
-
-			minExtents.x = std::min(minExtents.x, newMin.x);
-			minExtents.y = std::min(minExtents.y, newMin.y);
-			minExtents.z = std::min(minExtents.z, newMin.z);
-
-			maxExtents.x = std::max(maxExtents.x, newMax.x);
-			maxExtents.y = std::max(maxExtents.y, newMax.y);
-			maxExtents.z = std::max(maxExtents.z, newMax.z);
-		}
-	}
 }
\ No newline at end of file
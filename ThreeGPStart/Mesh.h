@@ -3,16 +3,13 @@
 
 #include "ExternalLibraryHeaders.h"
 #include "Helper.h"
+#include "NodeHierarchy.h"
+#include "AnimationCompression.h"
+#include "ThreadPool.h"
+#include "Bounds.h"
 
 namespace Helpers
 {
-	// Per node animation data
-	struct AnimationData
-	{
-		float time;
-		glm::vec3 value;
-	};
-
 	// Materials work with lights and shaders to produce the final render
 	struct Material
 	{
@@ -49,6 +46,27 @@ namespace Helpers
 		}
 	};
 
+	// A reduced detail index buffer that shares its mesh's vertices
+	struct MeshLod
+	{
+		std::vector<unsigned int> elements;
+
+		// Largest geometric error introduced, relative to the mesh's bounding radius
+		float error{ 0 };
+	};
+
+	// A bone deforming a skinned mesh
+	struct Bone
+	{
+		std::string name;
+
+		// Node in the model's hierarchy that the bone follows
+		int nodeIndex{ NodeHierarchy::kInvalidNode };
+
+		// Mesh space to bone space in the bind pose, the inverse bind matrix
+		glm::mat4 offset{ 1 };
+	};
+
 	// Data container for a mesh
 	// A model can be made up of a number of mesh
 	struct Mesh
@@ -64,11 +82,35 @@ namespace Helpers
 		// Elements
 		std::vector<unsigned int> elements;
 
+		// Lower detail versions of elements, each coarser than the last. Index the same vertices.
+		std::vector<MeshLod> lods;
+
 		// Index into the material vector held by the ModelLoader
 		size_t materialIndex{ 0 };
 
+		// Skinning data, empty unless the mesh has bones. Up to four influences per vertex,
+		// boneIndices index bones and unused influences have a weight of 0. Weights sum to 1.
+		std::vector<Bone> bones;
+		std::vector<glm::uvec4> boneIndices;
+		std::vector<glm::vec4> boneWeights;
+
+		// Hash of the vertex and element data, equal hashes mean the GPU buffers can be shared
+		uint64_t contentHash{ 0 };
+
+		// Sets contentHash from the current data
+		void ComputeContentHash();
+
+		// Box and sphere around the vertices in local model coordinates, set at load. Call UpdateBounds after changing vertices.
+		Bounds bounds;
+
+		// Recalculates bounds from the vertices
+		void UpdateBounds() { bounds = Bounds::FromPoints(vertices.data(), vertices.size()); }
+
 		// Retrieve the dimensions of this mesh in local model coordinates
-		void GetLocalExtents(glm::vec3& minExtents, glm::vec3& maxExtents) const;
+		void GetLocalExtents(glm::vec3& minExtents, glm::vec3& maxExtents) const {
+			minExtents = bounds.minExtents;
+			maxExtents = bounds.maxExtents;
+		}
 
 		// Helper
 		std::string ToString() const {
@@ -78,25 +120,24 @@ namespace Helpers
 				" Num verts: " + std::to_string(vertices.size()) + "\n" +
 				" Num normals: " + std::to_string(normals.size()) + "\n" +
 				" Num uv coords: " + std::to_string(uvCoords.size()) + "\n" +
-				" Num indices: " + std::to_string(elements.size());
+				" Num indices: " + std::to_string(elements.size()) + "\n" +
+				" Num LODs: " + std::to_string(lods.size()) + "\n" +
+				" Num bones: " + std::to_string(bones.size());
 		}
 	};	
 
-	// A mesh can contain a hierarchy in a tree structure
-	// Each entry is a Node
-	struct Node
+	// How much work an import does, trading load time for how well the mesh are prepared
+	enum class ImportProfile
 	{
-		std::string name;
-		glm::mat4 transform{ 1 };
-		std::vector<unsigned int> meshIndices;
+		// Editor iteration: minimum assimp steps, flat normals and none of our own optimisation or LODs
+		Fast,
 
-		Node* parentNode{ nullptr };
-		std::vector<Node*> childNodes;
+		// Normal use: clean up of degenerate triangles and bad data, smooth normals, instancing and mesh merging,
+		// our optimiser and LODs
+		Default,
 
-		// Animations
-		std::vector<AnimationData> translationAnimationKeys;
-		std::vector<AnimationData> rotationAnimationKeys;
-		std::vector<AnimationData> scaleAnimationKeys;
+		// Building a cache: Default plus assimp's full validation of the scene
+		Full
 	};
 
 	// Helper to load model data into mesh and material structures
@@ -107,21 +148,26 @@ namespace Helpers
 		std::vector<Mesh> m_meshVector;
 		std::vector<Material> m_materials;
 
-		Node* m_rootNode{ nullptr };
+		// Node hierarchy and the animations that drive it
+		NodeHierarchy m_hierarchy;
+		std::vector<CompressedClip> m_animations;
 
-		bool PopulateFromAssimpScene(const aiScene* scene);
+		// Union of every mesh's bounds
+		Bounds m_bounds;
 
-		// Recursive
-		Node* RecurseCreateNode(aiNode* node, Node* parent);
-		void RecurseDeleteNode(Node* node);
-		Node* RecurseFindNode(Node* node, const std::string& nodeName);
-		void RecurseOutputHierarchy(Node* node, int depth);
+		bool PopulateFromAssimpScene(const aiScene* scene, ImportProfile profile);
 	public:
 		ModelLoader() = default;
-		~ModelLoader() { RecurseDeleteNode(m_rootNode); }
 
 		// Load a 3D model form a provided file and path, return false on error
-		bool LoadFromFile(const std::string& objFilename);
+		// Time spent in each import step is recorded with the Profiler under "Import <filename>"
+		bool LoadFromFile(const std::string& objFilename, ImportProfile profile = ImportProfile::Default);
+
+		// Loads on a pool thread instead of blocking. The future holds the model, or null if it failed to load.
+		// onLoaded (if given) is called with the same on the loading thread, so must not make GL calls.
+		static std::future<std::shared_ptr<ModelLoader>> LoadFromFileAsync(const std::string& objFilename,
+			std::function<void(std::shared_ptr<ModelLoader>)> onLoaded = nullptr, ImportProfile profile = ImportProfile::Default,
+			ThreadPool& pool = ThreadPool::Shared());
 
 		// Retrieves the collection of mesh loaded from the 3D model
 		std::vector<Mesh>& GetMeshVector() { return m_meshVector; }
@@ -129,16 +175,26 @@ namespace Helpers
 		// Retrieves the collection of materials loaded from the 3D model
 		const std::vector<Material>& GetMaterialVector() const { return m_materials; }
 
-		// For a mesh heirarchy this is the root.
-		Node* GetRootNode() { return m_rootNode; }
+		// The mesh hierarchy, node 0 is the root
+		NodeHierarchy& GetHierarchy() { return m_hierarchy; }
+		const NodeHierarchy& GetHierarchy() const { return m_hierarchy; }
 
-		// Retrieve a specific node by name
-		Node* FindNode(const std::string& nodeName) {
-			return RecurseFindNode(m_rootNode, nodeName);
+		// Node animations loaded with the model, compressed at load. Sample with SampleClip.
+		const std::vector<CompressedClip>& GetAnimations() const { return m_animations; }
+
+		// Retrieve a specific node index by name, NodeHierarchy::kInvalidNode if not found
+		int FindNode(const std::string& nodeName) const {
+			return m_hierarchy.FindNode(nodeName);
 		}
 
+		// Box and sphere around every mesh, in local model coordinates
+		const Bounds& GetBounds() const { return m_bounds; }
+
 		// Retrieve the dimensions of this model in local model coordinates
-		void GetLocalExtents(glm::vec3& minExtents, glm::vec3& maxExtents) const;
+		void GetLocalExtents(glm::vec3& minExtents, glm::vec3& maxExtents) const {
+			minExtents = m_bounds.minExtents;
+			maxExtents = m_bounds.maxExtents;
+		}
 
 		// Helper to output the main info. of this loaded model
 		std::string ToString(bool describeEachMesh = true) const {
@@ -0,0 +1,326 @@
+#include "MeshOptimiser.h"
+
+#include <cmath>
+#include <numeric>
+
+namespace Helpers
+{
+	namespace
+	{
+		// Size of the cache modelled when scoring, larger than real hardware to give the scores a gradient
+		const int kScoreCacheSize{ 32 };
+
+		// Forsyth's tuned constants
+		const float kLastTriScore{ 0.75f };
+		const float kCacheDecayPower{ 1.5f };
+		const float kValenceBoostScale{ 2.0f };
+		const float kValenceBoostPower{ 0.5f };
+
+		// Score for a vertex at cachePosition (-1 when not in the cache) with liveTriangles still to draw
+		float VertexScore(int cachePosition, unsigned int liveTriangles)
+		{
+			// No triangles left to use it so it is of no further interest
+			if (liveTriangles == 0)
+				return -1.0f;
+
+			float score{ 0 };
+			if (cachePosition >= 0)
+			{
+				// The last triangle's vertices get a fixed score so the next triangle does not simply reuse them all
+				if (cachePosition < 3)
+					score = kLastTriScore;
+				else
+				{
+					const float scaler{ 1.0f / (kScoreCacheSize - 3) };
+					score = std::pow(1.0f - (cachePosition - 3) * scaler, kCacheDecayPower);
+				}
+			}
+
+			// Boost vertices with few triangles left so they are finished off rather than left stranded
+			score += kValenceBoostScale * std::pow((float)liveTriangles, -kValenceBoostPower);
+
+			return score;
+		}
+	}
+
+	// Simulates a FIFO post-transform cache of cacheSize entries over the elements
+	VertexCacheStats AnalyseVertexCache(const std::vector<unsigned int>& elements, size_t numVertices, unsigned int cacheSize)
+	{
+		VertexCacheStats stats;
+		if (elements.empty() || numVertices == 0)
+			return stats;
+
+		// Timestamp of when each vertex entered the cache, a vertex is cached if it entered less than cacheSize misses ago
+		std::vector<size_t> cacheTimestamps(numVertices, 0);
+		std::vector<bool> used(numVertices, false);
+		size_t misses{ 0 };
+		size_t uniqueVertices{ 0 };
+
+		for (unsigned int index : elements)
+		{
+			if (!used[index])
+			{
+				used[index] = true;
+				uniqueVertices++;
+			}
+
+			if (cacheTimestamps[index] == 0 || misses + 1 - cacheTimestamps[index] > cacheSize)
+			{
+				misses++;
+				cacheTimestamps[index] = misses;
+			}
+		}
+
+		stats.acmr = (float)misses / (elements.size() / 3);
+		stats.atvr = (float)misses / uniqueVertices;
+
+		return stats;
+	}
+
+	// Reorders triangles to maximise post-transform cache hits (Forsyth, linear speed)
+	void OptimiseVertexCache(std::vector<unsigned int>& elements, size_t numVertices)
+	{
+		const size_t numTriangles{ elements.size() / 3 };
+		if (numTriangles == 0)
+			return;
+
+		// Build the vertex to triangle adjacency as one flat array with per vertex offsets
+		std::vector<unsigned int> liveTriangles(numVertices, 0);
+		for (unsigned int index : elements)
+			liveTriangles[index]++;
+
+		std::vector<unsigned int> adjacencyOffsets(numVertices + 1, 0);
+		for (size_t v = 0; v < numVertices; v++)
+			adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+
+		std::vector<unsigned int> adjacency(elements.size());
+		std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t t = 0; t < numTriangles; t++)
+			for (int c = 0; c < 3; c++)
+				adjacency[fill[elements[t * 3 + c]]++] = (unsigned int)t;
+
+		// Initial scores
+		std::vector<float> vertexScores(numVertices);
+		for (size_t v = 0; v < numVertices; v++)
+			vertexScores[v] = VertexScore(-1, liveTriangles[v]);
+
+		std::vector<bool> emitted(numTriangles, false);
+		std::vector<unsigned int> output;
+		output.reserve(elements.size());
+
+		// Room for the cache plus the 3 new vertices pushed in before the tail is dropped
+		std::vector<int> cache;
+		cache.reserve(kScoreCacheSize + 3);
+		std::vector<int> newCache;
+		newCache.reserve(kScoreCacheSize + 3);
+
+		size_t scanPosition{ 0 };
+		int bestTriangle{ -1 };
+
+		for (size_t drawn = 0; drawn < numTriangles; drawn++)
+		{
+			// Nothing good in the cache so fall back to the next triangle not yet drawn
+			if (bestTriangle < 0)
+			{
+				while (emitted[scanPosition])
+					scanPosition++;
+				bestTriangle = (int)scanPosition;
+			}
+
+			const unsigned int* tri{ &elements[(size_t)bestTriangle * 3] };
+			emitted[bestTriangle] = true;
+
+			// Emit and move its vertices to the front of the cache
+			newCache.clear();
+			for (int c = 0; c < 3; c++)
+			{
+				const unsigned int v{ tri[c] };
+				output.push_back(v);
+				newCache.push_back((int)v);
+
+				// Remove the triangle from the vertex's live list
+				unsigned int* begin{ &adjacency[adjacencyOffsets[v]] };
+				unsigned int* end{ begin + liveTriangles[v] };
+				std::iter_swap(std::find(begin, end, (unsigned int)bestTriangle), end - 1);
+				liveTriangles[v]--;
+			}
+
+			for (int v : cache)
+				if (v != (int)tri[0] && v != (int)tri[1] && v != (int)tri[2])
+					newCache.push_back(v);
+
+			// Vertices falling out of the cache lose their position score
+			for (size_t i = kScoreCacheSize; i < newCache.size(); i++)
+				vertexScores[newCache[i]] = VertexScore(-1, liveTriangles[newCache[i]]);
+			if (newCache.size() > (size_t)kScoreCacheSize)
+				newCache.resize(kScoreCacheSize);
+
+			cache.swap(newCache);
+
+			// Rescore the cached vertices and their triangles, picking the best for next time
+			for (size_t i = 0; i < cache.size(); i++)
+				vertexScores[cache[i]] = VertexScore((int)i, liveTriangles[cache[i]]);
+
+			bestTriangle = -1;
+			float bestScore{ -1.0f };
+			for (int v : cache)
+			{
+				for (unsigned int a = 0; a < liveTriangles[v]; a++)
+				{
+					const unsigned int t{ adjacency[adjacencyOffsets[v] + a] };
+					const unsigned int* other{ &elements[(size_t)t * 3] };
+
+					const float score{ vertexScores[other[0]] + vertexScores[other[1]] + vertexScores[other[2]] };
+					if (score > bestScore)
+					{
+						bestScore = score;
+						bestTriangle = (int)t;
+					}
+				}
+			}
+		}
+
+		elements.swap(output);
+	}
+
+	// Reorders clusters of an already cache optimised triangle list so outward facing clusters draw first
+	void OptimiseOverdraw(std::vector<unsigned int>& elements, const std::vector<glm::vec3>& vertices, float threshold)
+	{
+		const size_t numTriangles{ elements.size() / 3 };
+		if (numTriangles < 2)
+			return;
+
+		const VertexCacheStats original{ AnalyseVertexCache(elements, vertices.size()) };
+
+		// Split where the cache simulation shows a triangle needing all 3 vertices, cheap points to restart from
+		// Clusters must be a minimum size or the sort just destroys the cache order
+		const size_t kMinClusterTriangles{ 64 };
+		const unsigned int kCacheSize{ 16 };
+
+		std::vector<size_t> clusterStarts{ 0 };
+		{
+			std::vector<size_t> cacheTimestamps(vertices.size(), 0);
+			size_t misses{ 0 };
+			for (size_t t = 0; t < numTriangles; t++)
+			{
+				int triangleMisses{ 0 };
+				for (int c = 0; c < 3; c++)
+				{
+					const unsigned int v{ elements[t * 3 + c] };
+					if (cacheTimestamps[v] == 0 || misses + 1 - cacheTimestamps[v] > kCacheSize)
+					{
+						misses++;
+						cacheTimestamps[v] = misses;
+						triangleMisses++;
+					}
+				}
+
+				if (triangleMisses == 3 && t - clusterStarts.back() >= kMinClusterTriangles)
+					clusterStarts.push_back(t);
+			}
+		}
+
+		const size_t numClusters{ clusterStarts.size() };
+		if (numClusters < 2)
+			return;
+		clusterStarts.push_back(numTriangles);
+
+		// Area weighted centroid of the whole mesh
+		glm::vec3 meshCentroid{ 0 };
+		float meshArea{ 0 };
+
+		std::vector<glm::vec3> clusterCentroids(numClusters, glm::vec3(0));
+		std::vector<glm::vec3> clusterNormals(numClusters, glm::vec3(0));
+
+		for (size_t c = 0; c < numClusters; c++)
+		{
+			float clusterArea{ 0 };
+			for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++)
+			{
+				const glm::vec3& p0{ vertices[elements[t * 3]] };
+				const glm::vec3& p1{ vertices[elements[t * 3 + 1]] };
+				const glm::vec3& p2{ vertices[elements[t * 3 + 2]] };
+
+				// Length of the cross product is twice the area so it doubles as an area weighted normal
+				const glm::vec3 normal{ glm::cross(p1 - p0, p2 - p0) };
+				const float area{ glm::length(normal) };
+				const glm::vec3 centre{ (p0 + p1 + p2) / 3.0f };
+
+				clusterCentroids[c] += centre * area;
+				clusterNormals[c] += normal;
+				clusterArea += area;
+			}
+
+			meshCentroid += clusterCentroids[c];
+			meshArea += clusterArea;
+
+			if (clusterArea > 0)
+				clusterCentroids[c] /= clusterArea;
+		}
+
+		if (meshArea > 0)
+			meshCentroid /= meshArea;
+
+		// Clusters facing away from the centre are on the outside, these are likely to occlude the rest
+		std::vector<float> sortKeys(numClusters);
+		for (size_t c = 0; c < numClusters; c++)
+		{
+			const float normalLength{ glm::length(clusterNormals[c]) };
+			const glm::vec3 normal{ normalLength > 0 ? clusterNormals[c] / normalLength : glm::vec3(0) };
+			sortKeys[c] = glm::dot(clusterCentroids[c] - meshCentroid, normal);
+		}
+
+		std::vector<size_t> order(numClusters);
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&sortKeys](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+		std::vector<unsigned int> sorted;
+		sorted.reserve(elements.size());
+		for (size_t c : order)
+			sorted.insert(sorted.end(), elements.begin() + clusterStarts[c] * 3, elements.begin() + clusterStarts[c + 1] * 3);
+
+		// Only keep the new order if it did not cost too much of the cache efficiency
+		const VertexCacheStats sortedStats{ AnalyseVertexCache(sorted, vertices.size()) };
+		if (sortedStats.acmr <= original.acmr * threshold)
+			elements.swap(sorted);
+	}
+
+	// Renumbers vertices in first use order, returns the remap table (old index to new, ~0u if unused)
+	std::vector<unsigned int> OptimiseVertexFetch(std::vector<unsigned int>& elements, size_t numVertices)
+	{
+		std::vector<unsigned int> remap(numVertices, ~0u);
+		unsigned int next{ 0 };
+
+		for (unsigned int& index : elements)
+		{
+			if (remap[index] == ~0u)
+				remap[index] = next++;
+			index = remap[index];
+		}
+
+		return remap;
+	}
+
+	// Runs the full cache, overdraw and fetch pass over the mesh, returning before and after stats
+	MeshOptimiseReport OptimiseMesh(Mesh& mesh)
+	{
+		MeshOptimiseReport report;
+		report.numTriangles = mesh.elements.size() / 3;
+		report.before = AnalyseVertexCache(mesh.elements, mesh.vertices.size());
+
+		OptimiseVertexCache(mesh.elements, mesh.vertices.size());
+		OptimiseOverdraw(mesh.elements, mesh.vertices);
+
+		const std::vector<unsigned int> remap{ OptimiseVertexFetch(mesh.elements, mesh.vertices.size()) };
+		RemapVertexStream(mesh.vertices, remap);
+		RemapVertexStream(mesh.normals, remap);
+		RemapVertexStream(mesh.uvCoords, remap);
+		RemapVertexStream(mesh.boneIndices, remap);
+		RemapVertexStream(mesh.boneWeights, remap);
+
+		report.numVertices = mesh.vertices.size();
+		report.after = AnalyseVertexCache(mesh.elements, mesh.vertices.size());
+
+		return report;
+	}
+}
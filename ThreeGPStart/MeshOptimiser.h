@@ -0,0 +1,96 @@
+#pragma once
+// Post load mesh optimisation: triangle order for the post-transform vertex cache and overdraw,
+// then vertex order for fetch locality. Works on any Helpers::Mesh, imported or generated.
+
+#include "ExternalLibraryHeaders.h"
+#include "Mesh.h"
+
+#include <algorithm>
+
+namespace Helpers
+{
+	// How well an index buffer uses the post-transform vertex cache
+	struct VertexCacheStats
+	{
+		// Average cache miss ratio, transformed vertices per triangle. 0.5 is ideal, 3 is worst
+		float acmr{ 0 };
+
+		// Average transformed vertex ratio, transformed vertices per unique vertex. 1 is ideal
+		float atvr{ 0 };
+
+		std::string ToString() const {
+			return "ACMR: " + std::to_string(acmr) + " ATVR: " + std::to_string(atvr);
+		}
+	};
+
+	// Result of running the optimiser on one or more mesh
+	struct MeshOptimiseReport
+	{
+		VertexCacheStats before;
+		VertexCacheStats after;
+
+		size_t numTriangles{ 0 };
+		size_t numVertices{ 0 };
+
+		// Combines another mesh's report into this one, weighting ACMR by triangles and ATVR by vertices
+		void Add(const MeshOptimiseReport& other)
+		{
+			const size_t totalTriangles{ numTriangles + other.numTriangles };
+			const size_t totalVertices{ numVertices + other.numVertices };
+			if (totalTriangles == 0 || totalVertices == 0)
+				return;
+
+			before.acmr = (before.acmr * numTriangles + other.before.acmr * other.numTriangles) / totalTriangles;
+			after.acmr = (after.acmr * numTriangles + other.after.acmr * other.numTriangles) / totalTriangles;
+			before.atvr = (before.atvr * numVertices + other.before.atvr * other.numVertices) / totalVertices;
+			after.atvr = (after.atvr * numVertices + other.after.atvr * other.numVertices) / totalVertices;
+
+			numTriangles = totalTriangles;
+			numVertices = totalVertices;
+		}
+
+		std::string ToString() const {
+			return "Triangles: " + std::to_string(numTriangles) +
+				" Verts: " + std::to_string(numVertices) +
+				" Before " + before.ToString() +
+				" After " + after.ToString();
+		}
+	};
+
+	// Simulates a FIFO post-transform cache of cacheSize entries over the elements
+	VertexCacheStats AnalyseVertexCache(const std::vector<unsigned int>& elements, size_t numVertices, unsigned int cacheSize = 16);
+
+	// Reorders triangles to maximise post-transform cache hits (Forsyth, linear speed)
+	void OptimiseVertexCache(std::vector<unsigned int>& elements, size_t numVertices);
+
+	// Reorders clusters of an already cache optimised triangle list so outward facing clusters draw first.
+	// threshold limits how much ACMR may be given up, 1.05 allows a 5% worse ACMR
+	void OptimiseOverdraw(std::vector<unsigned int>& elements, const std::vector<glm::vec3>& vertices, float threshold = 1.05f);
+
+	// Renumbers vertices in first use order, returns the remap table (old index to new, ~0u if unused)
+	// Unreferenced vertices are dropped. Use RemapVertexStream to apply the table to each vertex stream.
+	std::vector<unsigned int> OptimiseVertexFetch(std::vector<unsigned int>& elements, size_t numVertices);
+
+	// Applies a remap table from OptimiseVertexFetch to a vertex stream
+	template<typename T>
+	void RemapVertexStream(std::vector<T>& stream, const std::vector<unsigned int>& remap)
+	{
+		if (stream.empty())
+			return;
+
+		size_t newCount{ 0 };
+		for (unsigned int r : remap)
+			if (r != ~0u)
+				newCount = std::max(newCount, (size_t)r + 1);
+
+		std::vector<T> remapped(newCount);
+		for (size_t i = 0; i < remap.size() && i < stream.size(); i++)
+			if (remap[i] != ~0u)
+				remapped[remap[i]] = stream[i];
+
+		stream.swap(remapped);
+	}
+
+	// Runs the full cache, overdraw and fetch pass over the mesh, returning before and after stats
+	MeshOptimiseReport OptimiseMesh(Mesh& mesh);
+}
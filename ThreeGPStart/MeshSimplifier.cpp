@@ -0,0 +1,324 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimiser.h"
+
+#include <algorithm>
+#include <queue>
+#include <unordered_map>
+
+namespace Helpers
+{
+	namespace
+	{
+		// Symmetric 4x4 error quadric, stored as the 10 unique coefficients
+		struct Quadric
+		{
+			double a2{ 0 }, ab{ 0 }, ac{ 0 }, ad{ 0 };
+			double b2{ 0 }, bc{ 0 }, bd{ 0 };
+			double c2{ 0 }, cd{ 0 };
+			double d2{ 0 };
+
+			// Quadric for the plane ax + by + cz + d = 0, scaled by weight
+			static Quadric FromPlane(double a, double b, double c, double d, double weight)
+			{
+				Quadric q;
+				q.a2 = a * a * weight; q.ab = a * b * weight; q.ac = a * c * weight; q.ad = a * d * weight;
+				q.b2 = b * b * weight; q.bc = b * c * weight; q.bd = b * d * weight;
+				q.c2 = c * c * weight; q.cd = c * d * weight;
+				q.d2 = d * d * weight;
+				return q;
+			}
+
+			Quadric& operator+=(const Quadric& o)
+			{
+				a2 += o.a2; ab += o.ab; ac += o.ac; ad += o.ad;
+				b2 += o.b2; bc += o.bc; bd += o.bd;
+				c2 += o.c2; cd += o.cd;
+				d2 += o.d2;
+				return *this;
+			}
+
+			// Sum of squared distances from p to the accumulated planes
+			double Error(const glm::vec3& p) const
+			{
+				const double x{ p.x }, y{ p.y }, z{ p.z };
+				const double e{ x * x * a2 + y * y * b2 + z * z * c2 +
+					2 * (x * y * ab + x * z * ac + y * z * bc) +
+					2 * (x * ad + y * bd + z * cd) + d2 };
+				return std::max(e, 0.0);
+			}
+		};
+
+		// Candidate collapse of vertex 'from' onto vertex 'to'
+		struct Collapse
+		{
+			double cost;
+			unsigned int from;
+			unsigned int to;
+			unsigned int fromStamp;
+			unsigned int toStamp;
+
+			bool operator>(const Collapse& o) const { return cost > o.cost; }
+		};
+
+		// Hash for grouping vertices by exact position
+		struct PositionHash
+		{
+			size_t operator()(const glm::vec3& p) const
+			{
+				const unsigned int* bits{ reinterpret_cast<const unsigned int*>(&p) };
+				return (size_t)bits[0] * 73856093u ^ (size_t)bits[1] * 19349663u ^ (size_t)bits[2] * 83492791u;
+			}
+		};
+	}
+
+	// Collapses edges in quadric error order until the index count reaches targetIndexCount or targetError is hit
+	std::vector<unsigned int> SimplifyMesh(const std::vector<unsigned int>& elements, const std::vector<glm::vec3>& vertices,
+		size_t targetIndexCount, float targetError, float* resultError)
+	{
+		const size_t numVertices{ vertices.size() };
+		const size_t numTriangles{ elements.size() / 3 };
+
+		std::vector<unsigned int> indices(elements);
+		if (resultError)
+			*resultError = 0;
+		if (numTriangles == 0 || indices.size() <= targetIndexCount)
+			return indices;
+
+		// Errors are measured against the size of the mesh so one tolerance works for any scale
+		glm::vec3 minExtents{ vertices[0] };
+		glm::vec3 maxExtents{ vertices[0] };
+		for (const glm::vec3& v : vertices)
+		{
+			minExtents = glm::min(minExtents, v);
+			maxExtents = glm::max(maxExtents, v);
+		}
+		const double radius{ std::max(glm::length(maxExtents - minExtents) * 0.5, 1e-6) };
+		const double maxCost{ (targetError * radius) * (targetError * radius) };
+
+		// Vertices sharing a position with another are on an attribute seam
+		std::vector<bool> locked(numVertices, false);
+		{
+			std::unordered_map<glm::vec3, unsigned int, PositionHash> firstAtPosition;
+			for (unsigned int v = 0; v < numVertices; v++)
+			{
+				auto inserted{ firstAtPosition.emplace(vertices[v], v) };
+				if (!inserted.second)
+				{
+					locked[v] = true;
+					locked[inserted.first->second] = true;
+				}
+			}
+		}
+
+		// Edges used by a single triangle are on the mesh border
+		{
+			std::unordered_map<unsigned long long, int> edgeCounts;
+			edgeCounts.reserve(indices.size());
+			for (size_t t = 0; t < numTriangles; t++)
+			{
+				for (int e = 0; e < 3; e++)
+				{
+					const unsigned long long a{ indices[t * 3 + e] };
+					const unsigned long long b{ indices[t * 3 + (e + 1) % 3] };
+					edgeCounts[std::min(a, b) << 32 | std::max(a, b)]++;
+				}
+			}
+
+			for (const auto& edge : edgeCounts)
+			{
+				if (edge.second == 1)
+				{
+					locked[(unsigned int)(edge.first >> 32)] = true;
+					locked[(unsigned int)(edge.first & 0xffffffffu)] = true;
+				}
+			}
+		}
+
+		// Area weighted plane quadrics and the triangles around each vertex
+		std::vector<Quadric> quadrics(numVertices);
+		std::vector<std::vector<unsigned int>> vertexTriangles(numVertices);
+		for (size_t t = 0; t < numTriangles; t++)
+		{
+			const glm::vec3& p0{ vertices[indices[t * 3]] };
+			const glm::vec3& p1{ vertices[indices[t * 3 + 1]] };
+			const glm::vec3& p2{ vertices[indices[t * 3 + 2]] };
+
+			glm::dvec3 normal{ glm::cross(glm::dvec3(p1 - p0), glm::dvec3(p2 - p0)) };
+			const double area{ glm::length(normal) };
+			if (area > 0)
+				normal /= area;
+
+			const double d{ -glm::dot(normal, glm::dvec3(p0)) };
+			const Quadric q{ Quadric::FromPlane(normal.x, normal.y, normal.z, d, area * 0.5) };
+
+			for (int c = 0; c < 3; c++)
+			{
+				quadrics[indices[t * 3 + c]] += q;
+				vertexTriangles[indices[t * 3 + c]].push_back((unsigned int)t);
+			}
+		}
+
+		// Stamps invalidate queued collapses when a vertex's quadric changes
+		std::vector<unsigned int> stamps(numVertices, 0);
+		std::vector<bool> removed(numVertices, false);
+		std::vector<bool> triangleAlive(numTriangles, true);
+
+		std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+
+		auto pushCollapse = [&](unsigned int from, unsigned int to)
+		{
+			if (locked[from])
+				return;
+
+			Quadric q{ quadrics[from] };
+			q += quadrics[to];
+			queue.push(Collapse{ q.Error(vertices[to]), from, to, stamps[from], stamps[to] });
+		};
+
+		for (size_t t = 0; t < numTriangles; t++)
+		{
+			for (int e = 0; e < 3; e++)
+			{
+				const unsigned int a{ indices[t * 3 + e] };
+				const unsigned int b{ indices[t * 3 + (e + 1) % 3] };
+				pushCollapse(a, b);
+				pushCollapse(b, a);
+			}
+		}
+
+		size_t liveTriangles{ numTriangles };
+		const size_t targetTriangles{ targetIndexCount / 3 };
+		double worstCost{ 0 };
+
+		while (liveTriangles > targetTriangles && !queue.empty())
+		{
+			const Collapse collapse{ queue.top() };
+			queue.pop();
+
+			if (removed[collapse.from] || removed[collapse.to] ||
+				stamps[collapse.from] != collapse.fromStamp || stamps[collapse.to] != collapse.toStamp)
+				continue;
+
+			// Queue is ordered so everything left is worse
+			if (collapse.cost > maxCost)
+				break;
+
+			// Reject collapses that would flip a surviving triangle
+			bool flips{ false };
+			for (unsigned int t : vertexTriangles[collapse.from])
+			{
+				if (!triangleAlive[t])
+					continue;
+
+				const unsigned int* tri{ &indices[(size_t)t * 3] };
+				if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to)
+					continue;
+
+				glm::vec3 before[3];
+				glm::vec3 after[3];
+				for (int c = 0; c < 3; c++)
+				{
+					before[c] = vertices[tri[c]];
+					after[c] = tri[c] == collapse.from ? vertices[collapse.to] : before[c];
+				}
+
+				const glm::vec3 normalBefore{ glm::cross(before[1] - before[0], before[2] - before[0]) };
+				const glm::vec3 normalAfter{ glm::cross(after[1] - after[0], after[2] - after[0]) };
+				if (glm::dot(normalBefore, normalAfter) <= 0)
+				{
+					flips = true;
+					break;
+				}
+			}
+			if (flips)
+				continue;
+
+			// Move the triangles across, those containing both vertices become degenerate and die
+			for (unsigned int t : vertexTriangles[collapse.from])
+			{
+				if (!triangleAlive[t])
+					continue;
+
+				unsigned int* tri{ &indices[(size_t)t * 3] };
+				if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to)
+				{
+					triangleAlive[t] = false;
+					liveTriangles--;
+					continue;
+				}
+
+				for (int c = 0; c < 3; c++)
+					if (tri[c] == collapse.from)
+						tri[c] = collapse.to;
+				vertexTriangles[collapse.to].push_back(t);
+			}
+
+			vertexTriangles[collapse.from].clear();
+			removed[collapse.from] = true;
+			quadrics[collapse.to] += quadrics[collapse.from];
+			stamps[collapse.to]++;
+			worstCost = std::max(worstCost, collapse.cost);
+
+			// Drop dead triangles from the survivor and requeue its edges with the new quadric
+			std::vector<unsigned int>& toTriangles{ vertexTriangles[collapse.to] };
+			toTriangles.erase(std::remove_if(toTriangles.begin(), toTriangles.end(),
+				[&triangleAlive](unsigned int t) { return !triangleAlive[t]; }), toTriangles.end());
+
+			for (unsigned int t : toTriangles)
+			{
+				for (int c = 0; c < 3; c++)
+				{
+					const unsigned int other{ indices[(size_t)t * 3 + c] };
+					if (other == collapse.to)
+						continue;
+					pushCollapse(other, collapse.to);
+					pushCollapse(collapse.to, other);
+				}
+			}
+		}
+
+		std::vector<unsigned int> result;
+		result.reserve(liveTriangles * 3);
+		for (size_t t = 0; t < numTriangles; t++)
+			if (triangleAlive[t])
+				result.insert(result.end(), indices.begin() + t * 3, indices.begin() + t * 3 + 3);
+
+		if (resultError)
+			*resultError = (float)(std::sqrt(worstCost) / radius);
+
+		return result;
+	}
+
+	// Fills mesh.lods with up to maxLods reduced index buffers
+	void GenerateLods(Mesh& mesh, int maxLods, float reduction)
+	{
+		mesh.lods.clear();
+		mesh.lods.reserve(maxLods);
+
+		// Each level may be twice as wrong as the one before
+		float targetError{ 0.01f };
+
+		const std::vector<unsigned int>* previous{ &mesh.elements };
+		for (int level = 0; level < maxLods; level++)
+		{
+			const size_t targetIndexCount{ (size_t)(previous->size() / 3 * reduction) * 3 };
+
+			MeshLod lod;
+			lod.elements = SimplifyMesh(*previous, mesh.vertices, targetIndexCount, targetError, &lod.error);
+
+			// Not worth a level if it barely removed anything
+			if (lod.elements.empty() || lod.elements.size() > previous->size() * 0.8f)
+				break;
+
+			OptimiseVertexCache(lod.elements, mesh.vertices.size());
+
+			// Errors are from the previous level so accumulate to get the error against full detail
+			if (!mesh.lods.empty())
+				lod.error += mesh.lods.back().error;
+
+			mesh.lods.push_back(std::move(lod));
+			previous = &mesh.lods.back().elements;
+			targetError *= 2.0f;
+		}
+	}
+}
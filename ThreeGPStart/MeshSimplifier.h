@@ -0,0 +1,20 @@
+#pragma once
+// Quadric error metric mesh simplification used to build LOD chains
+// LOD index buffers reference the original vertices so every level can share one vertex buffer
+
+#include "ExternalLibraryHeaders.h"
+#include "Mesh.h"
+
+namespace Helpers
+{
+	// Collapses edges in quadric error order until the index count reaches targetIndexCount or the
+	// next collapse would exceed targetError. Errors are relative to the mesh's bounding radius.
+	// Mesh borders and attribute seams are locked so UVs and outlines are preserved.
+	// resultError, if provided, receives the largest error introduced.
+	std::vector<unsigned int> SimplifyMesh(const std::vector<unsigned int>& elements, const std::vector<glm::vec3>& vertices,
+		size_t targetIndexCount, float targetError, float* resultError = nullptr);
+
+	// Fills mesh.lods with up to maxLods reduced index buffers, each aiming for reduction times the previous triangle count
+	// Stops early when a level would not remove a worthwhile number of triangles
+	void GenerateLods(Mesh& mesh, int maxLods = 4, float reduction = 0.5f);
+}
@@ -0,0 +1,282 @@
+#include "Meshlet.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+namespace Helpers
+{
+	namespace
+	{
+		// Works out the sphere and normal cone of the triangles in elements[first, first + count)
+		void CalculateMeshletBounds(Meshlet& meshlet, const std::vector<unsigned int>& elements, const std::vector<glm::vec3>& vertices)
+		{
+			glm::vec3 minExtents{ vertices[elements[meshlet.firstElement]] };
+			glm::vec3 maxExtents{ minExtents };
+			for (unsigned int e = meshlet.firstElement; e < meshlet.firstElement + meshlet.numElements; e++)
+			{
+				minExtents = glm::min(minExtents, vertices[elements[e]]);
+				maxExtents = glm::max(maxExtents, vertices[elements[e]]);
+			}
+
+			meshlet.centre = (minExtents + maxExtents) * 0.5f;
+			meshlet.radius = 0;
+			for (unsigned int e = meshlet.firstElement; e < meshlet.firstElement + meshlet.numElements; e++)
+				meshlet.radius = std::max(meshlet.radius, glm::length(vertices[elements[e]] - meshlet.centre));
+
+			// Average the face normals for the axis then find the widest angle from it
+			std::vector<glm::vec3> normals;
+			normals.reserve(meshlet.numElements / 3);
+			glm::vec3 axis{ 0 };
+			for (unsigned int e = meshlet.firstElement; e < meshlet.firstElement + meshlet.numElements; e += 3)
+			{
+				const glm::vec3& p0{ vertices[elements[e]] };
+				const glm::vec3& p1{ vertices[elements[e + 1]] };
+				const glm::vec3& p2{ vertices[elements[e + 2]] };
+
+				const glm::vec3 normal{ glm::cross(p1 - p0, p2 - p0) };
+				const float length{ glm::length(normal) };
+				if (length <= 0)
+					continue;
+
+				normals.push_back(normal / length);
+				axis += normals.back();
+			}
+
+			const float axisLength{ glm::length(axis) };
+			if (normals.empty() || axisLength <= 0)
+				return;
+			axis /= axisLength;
+
+			float minDot{ 1.0f };
+			for (const glm::vec3& normal : normals)
+				minDot = std::min(minDot, glm::dot(normal, axis));
+
+			// Over ~85 degrees of spread the cone can never cull anything
+			meshlet.coneAxis = axis;
+			if (minDot <= 0.1f)
+				meshlet.coneCutoff = 1.0f;
+			else
+				meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+		}
+	}
+
+	// Splits the mesh's triangles, in their current order, into meshlets of at most maxVertices and maxTriangles
+	MeshletMesh BuildMeshlets(const Mesh& mesh, size_t maxVertices, size_t maxTriangles)
+	{
+		MeshletMesh result;
+		result.elements.reserve(mesh.elements.size());
+
+		// Which meshlet last used each vertex, so unique counts need no clearing between meshlets
+		std::vector<unsigned int> lastUsedBy(mesh.vertices.size(), ~0u);
+
+		Meshlet current;
+		auto finishMeshlet = [&]()
+		{
+			if (current.numElements == 0)
+				return;
+
+			CalculateMeshletBounds(current, result.elements, mesh.vertices);
+			result.meshlets.push_back(current);
+
+			current = Meshlet();
+			current.firstElement = (unsigned int)result.elements.size();
+		};
+
+		for (size_t t = 0; t + 2 < mesh.elements.size(); t += 3)
+		{
+			const unsigned int* tri{ &mesh.elements[t] };
+			const unsigned int meshletIndex{ (unsigned int)result.meshlets.size() };
+
+			unsigned int newVertices{ 0 };
+			for (int c = 0; c < 3; c++)
+				if (lastUsedBy[tri[c]] != meshletIndex)
+					newVertices++;
+
+			// Start a new meshlet if this triangle will not fit
+			if (current.numVertices + newVertices > maxVertices || current.numElements / 3 + 1 > maxTriangles)
+			{
+				finishMeshlet();
+				newVertices = 3;
+			}
+
+			const unsigned int owner{ (unsigned int)result.meshlets.size() };
+			for (int c = 0; c < 3; c++)
+			{
+				if (lastUsedBy[tri[c]] != owner)
+				{
+					lastUsedBy[tri[c]] = owner;
+					current.numVertices++;
+				}
+				result.elements.push_back(tri[c]);
+			}
+			current.numElements += 3;
+		}
+
+		finishMeshlet();
+
+		return result;
+	}
+
+	// Rejects meshlets outside the frustum or facing away from the eye, both given in model space
+	void CullMeshlets(const MeshletMesh& meshletMesh, const Frustum& frustum, const glm::vec3& eye, MeshletDrawList& drawList,
+		unsigned int firstElement, GLint baseVertex)
+	{
+		drawList.counts.clear();
+		drawList.offsets.clear();
+		drawList.baseVertices.clear();
+		drawList.visibleMeshlets = 0;
+		drawList.visibleTriangles = 0;
+
+		// End of the last range added, a meshlet starting here extends it rather than adding a draw
+		unsigned int rangeEnd{ ~0u };
+
+		for (const Meshlet& meshlet : meshletMesh.meshlets)
+		{
+			if (!frustum.IntersectsSphere(meshlet.centre, meshlet.radius))
+				continue;
+
+			if (meshlet.coneCutoff < 1.0f)
+			{
+				const glm::vec3 toCentre{ meshlet.centre - eye };
+				if (glm::dot(toCentre, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCentre) + meshlet.radius)
+					continue;
+			}
+
+			drawList.visibleMeshlets++;
+			drawList.visibleTriangles += meshlet.numElements / 3;
+
+			if (meshlet.firstElement == rangeEnd)
+			{
+				drawList.counts.back() += meshlet.numElements;
+			}
+			else
+			{
+				drawList.counts.push_back(meshlet.numElements);
+				drawList.offsets.push_back((const void*)(sizeof(unsigned int) * ((size_t)firstElement + meshlet.firstElement)));
+				drawList.baseVertices.push_back(baseVertex);
+			}
+			rangeEnd = meshlet.firstElement + meshlet.numElements;
+		}
+	}
+
+	// Builds and checks meshlets for a bumpy sphere, then culls them from eyes all round it
+	MeshletBenchmarkResult BenchmarkMeshlets(size_t numTriangles, size_t numEyes, size_t maxVertices, size_t maxTriangles)
+	{
+		MeshletBenchmarkResult result;
+		result.vertexLimit = maxVertices;
+		result.triangleLimit = maxTriangles;
+
+		// Rings of latitude by segments of longitude, two triangles a quad, wound to face outwards.
+		// Bumps so neighbouring clusters face a little differently.
+		const int rings{ std::max(2, (int)std::sqrt(numTriangles / 4.0)) };
+		const int segments{ rings * 2 };
+		const float kPi{ 3.14159265f };
+		const float kRadius{ 100.0f };
+		Mesh mesh;
+		for (int ring = 0; ring <= rings; ring++)
+		{
+			for (int segment = 0; segment <= segments; segment++)
+			{
+				const float theta{ kPi * ring / rings };
+				const float phi{ 2.0f * kPi * segment / segments };
+				const glm::vec3 direction{ std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi) };
+				mesh.vertices.push_back(direction * (kRadius + 3.0f * std::sin(theta * 9.0f) * std::cos(phi * 7.0f)));
+			}
+		}
+		for (int ring = 0; ring < rings; ring++)
+		{
+			for (int segment = 0; segment < segments; segment++)
+			{
+				const unsigned int corner{ (unsigned int)(ring * (segments + 1) + segment) };
+				const unsigned int quad[6]{ corner, corner + 1, corner + segments + 2, corner, corner + segments + 2, corner + segments + 1 };
+				for (int t = 0; t < 6; t += 3)
+				{
+					unsigned int triangle[3]{ quad[t], quad[t + 1], quad[t + 2] };
+					const glm::vec3& p0{ mesh.vertices[triangle[0]] };
+					const glm::vec3 normal{ glm::cross(mesh.vertices[triangle[1]] - p0, mesh.vertices[triangle[2]] - p0) };
+					if (glm::dot(normal, p0) < 0)
+						std::swap(triangle[1], triangle[2]);
+					mesh.elements.insert(mesh.elements.end(), triangle, triangle + 3);
+				}
+			}
+		}
+		result.numTriangles = mesh.elements.size() / 3;
+
+		const auto buildStart{ std::chrono::high_resolution_clock::now() };
+		const MeshletMesh meshlets{ BuildMeshlets(mesh, maxVertices, maxTriangles) };
+		result.buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - buildStart).count();
+		result.numMeshlets = meshlets.meshlets.size();
+
+		// Ranges one after the other from the start to the end, whole triangles, and the builder keeps the mesh's order,
+		// so the elements matching the mesh's means each triangle is in exactly one meshlet
+		result.everyTriangleOnce = meshlets.elements == mesh.elements;
+		result.vertexCountsRight = true;
+		unsigned int nextElement{ 0 };
+		std::vector<unsigned int> used;
+		for (const Meshlet& meshlet : meshlets.meshlets)
+		{
+			result.everyTriangleOnce = result.everyTriangleOnce && meshlet.firstElement == nextElement && meshlet.numElements > 0 &&
+				meshlet.numElements % 3 == 0;
+			nextElement = meshlet.firstElement + meshlet.numElements;
+
+			used.assign(meshlets.elements.begin() + meshlet.firstElement, meshlets.elements.begin() + nextElement);
+			std::sort(used.begin(), used.end());
+			const size_t uniqueVertices{ (size_t)(std::unique(used.begin(), used.end()) - used.begin()) };
+			result.vertexCountsRight = result.vertexCountsRight && uniqueVertices == meshlet.numVertices;
+			result.maxVertices = std::max(result.maxVertices, uniqueVertices);
+			result.maxTriangles = std::max(result.maxTriangles, (size_t)meshlet.numElements / 3);
+		}
+		result.everyTriangleOnce = result.everyTriangleOnce && nextElement == meshlets.elements.size();
+
+		// A frustum far bigger than the sphere leaves only the cones to cull. Eyes both outside (where the far side
+		// faces away) and inside (where every triangle does).
+		const Frustum everything{ Frustum::FromMatrix(glm::ortho(-1e4f, 1e4f, -1e4f, 1e4f, -1e4f, 1e4f)) };
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		MeshletDrawList drawList;
+		double cullSeconds{ 0 };
+		std::vector<bool> drawn;
+		for (size_t e = 0; e < numEyes; e++)
+		{
+			const glm::vec3 direction{ glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(1e-3f)) };
+			const glm::vec3 eye{ direction * kRadius * (e % 4 == 0 ? 0.5f : 1.5f + 2.0f * std::abs(unit(random))) };
+
+			const auto cullStart{ std::chrono::high_resolution_clock::now() };
+			CullMeshlets(meshlets, everything, eye, drawList);
+			cullSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - cullStart).count();
+
+			// Which elements the draws cover, anything left out was culled by its cone
+			drawn.assign(meshlets.elements.size(), false);
+			for (size_t draw = 0; draw < drawList.counts.size(); draw++)
+			{
+				const size_t first{ (size_t)drawList.offsets[draw] / sizeof(unsigned int) };
+				std::fill(drawn.begin() + first, drawn.begin() + first + drawList.counts[draw], true);
+			}
+
+			for (const Meshlet& meshlet : meshlets.meshlets)
+			{
+				if (drawn[meshlet.firstElement])
+					continue;
+				result.coneCulled++;
+
+				// Facing the eye by more than rounding could account for
+				for (unsigned int t = meshlet.firstElement; t < meshlet.firstElement + meshlet.numElements; t += 3)
+				{
+					const glm::vec3& p0{ mesh.vertices[meshlets.elements[t]] };
+					const glm::vec3 normal{ glm::cross(mesh.vertices[meshlets.elements[t + 1]] - p0, mesh.vertices[meshlets.elements[t + 2]] - p0) };
+					const glm::vec3 toTriangle{ p0 - eye };
+					if (glm::dot(normal, toTriangle) < -1e-4f * glm::length(normal) * glm::length(toTriangle))
+					{
+						result.frontFacingCulled++;
+						break;
+					}
+				}
+			}
+		}
+		result.cullMicroseconds = numEyes ? cullSeconds * 1e6 / numEyes : 0.0;
+
+		return result;
+	}
+}
@@ -0,0 +1,100 @@
+#pragma once
+// Splits a mesh into small clusters (meshlets) with bounds so parts of a large mesh can be culled on the CPU
+
+#include "ExternalLibraryHeaders.h"
+#include "Frustum.h"
+#include "Mesh.h"
+
+namespace Helpers
+{
+	// A small run of a mesh's triangles with its own bounds
+	struct Meshlet
+	{
+		// Range of MeshletMesh::elements this meshlet draws, always whole triangles
+		unsigned int firstElement{ 0 };
+		unsigned int numElements{ 0 };
+
+		// Unique vertices referenced
+		unsigned int numVertices{ 0 };
+
+		// Bounding sphere in model space
+		glm::vec3 centre{ 0 };
+		float radius{ 0 };
+
+		// Normal cone, all triangles face away from an eye when
+		// dot(centre - eye, coneAxis) >= coneCutoff * length(centre - eye) + radius
+		// A cutoff of 1 or more means the triangles spread too widely for the cone to ever cull
+		glm::vec3 coneAxis{ 0, 0, 1 };
+		float coneCutoff{ 1 };
+	};
+
+	// A mesh's elements reordered so each meshlet is a contiguous range
+	struct MeshletMesh
+	{
+		std::vector<Meshlet> meshlets;
+		std::vector<unsigned int> elements;
+	};
+
+	// The surviving ranges of a cull, ready for glMultiDrawElements
+	struct MeshletDrawList
+	{
+		std::vector<GLsizei> counts;
+		std::vector<const void*> offsets;
+		std::vector<GLint> baseVertices;
+
+		size_t visibleMeshlets{ 0 };
+		size_t visibleTriangles{ 0 };
+	};
+
+	// Splits the mesh's triangles, in their current order, into meshlets of at most maxVertices and maxTriangles
+	MeshletMesh BuildMeshlets(const Mesh& mesh, size_t maxVertices = 64, size_t maxTriangles = 124);
+
+	// Rejects meshlets outside the frustum or facing away from the eye, both given in model space
+	// Neighbouring survivors are merged into one range. drawList is cleared first.
+	// firstElement and baseVertex place the mesh in a larger buffer, for glMultiDrawElementsBaseVertex.
+	void CullMeshlets(const MeshletMesh& meshletMesh, const Frustum& frustum, const glm::vec3& eye, MeshletDrawList& drawList,
+		unsigned int firstElement = 0, GLint baseVertex = 0);
+
+	// Speed of building and culling meshlets on a generated mesh, and whether the results hold up
+	struct MeshletBenchmarkResult
+	{
+		size_t numTriangles{ 0 };
+		size_t numMeshlets{ 0 };
+		double buildMilliseconds{ 0 };
+		double cullMicroseconds{ 0 };
+
+		// Most unique vertices and triangles in any meshlet, against the limits they were built with
+		size_t maxVertices{ 0 };
+		size_t maxTriangles{ 0 };
+		size_t vertexLimit{ 0 };
+		size_t triangleLimit{ 0 };
+
+		// Every meshlet's numVertices is the number of vertices it really uses
+		bool vertexCountsRight{ false };
+
+		// The meshlets' ranges cover the elements end to end, and hold the mesh's triangles, each exactly once
+		bool everyTriangleOnce{ false };
+
+		// Meshlets the normal cones culled over every eye position tried, and how many of those had a triangle facing the eye
+		size_t coneCulled{ 0 };
+		size_t frontFacingCulled{ 0 };
+
+		bool Passed() const {
+			return numMeshlets > 0 && maxVertices <= vertexLimit && maxTriangles <= triangleLimit && vertexCountsRight &&
+				everyTriangleOnce && coneCulled > 0 && frontFacingCulled == 0;
+		}
+
+		std::string ToString() const {
+			return "Meshlets from " + std::to_string(numTriangles) + " triangles: " + std::to_string(numMeshlets) + " built in " +
+				std::to_string(buildMilliseconds) + " ms, culled in " + std::to_string(cullMicroseconds) + " us. Most vertices " +
+				std::to_string(maxVertices) + " / " + std::to_string(vertexLimit) + " triangles " + std::to_string(maxTriangles) + " / " +
+				std::to_string(triangleLimit) + " Vertex counts: " + (vertexCountsRight ? "right" : "WRONG") + " Every triangle once: " +
+				(everyTriangleOnce ? "yes" : "NO") + " Cone culled: " + std::to_string(coneCulled) + " of them facing the eye: " +
+				std::to_string(frontFacingCulled) + (Passed() ? " PASS" : " FAIL");
+		}
+	};
+
+	// Builds meshlets for a generated bumpy sphere of about numTriangles triangles and checks them, then culls them from
+	// numEyes eye positions around and inside it with a frustum taking in everything, so only the normal cones cull
+	MeshletBenchmarkResult BenchmarkMeshlets(size_t numTriangles = 200000, size_t numEyes = 64, size_t maxVertices = 64, size_t maxTriangles = 124);
+}
@@ -0,0 +1,400 @@
+#include "MipGenerator.h"
+#include "Hash.h"
+#include "Simd.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+namespace Helpers
+{
+	namespace
+	{
+		const float kPi{ 3.14159265358979f };
+
+		// sRGB byte to linear light
+		const float* SrgbToLinearTable()
+		{
+			static const std::vector<float> table{ []()
+			{
+				std::vector<float> values(256);
+				for (int i = 0; i < 256; i++)
+				{
+					const float c{ i / 255.0f };
+					values[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+				}
+				return values;
+			}() };
+			return table.data();
+		}
+
+		// Linear light quantised to 16 bits back to an sRGB byte, fine enough that the darkest bytes survive the round trip
+		const unsigned char* LinearToSrgbTable()
+		{
+			static const std::vector<unsigned char> table{ []()
+			{
+				std::vector<unsigned char> values(65536);
+				for (int i = 0; i < 65536; i++)
+				{
+					const float c{ i / 65535.0f };
+					const float srgb{ c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f };
+					values[i] = (unsigned char)std::min(255.0f, srgb * 255.0f + 0.5f);
+				}
+				return values;
+			}() };
+			return table.data();
+		}
+
+		float Sinc(float x)
+		{
+			if (std::abs(x) < 1e-6f)
+				return 1.0f;
+			x *= kPi;
+			return std::sin(x) / x;
+		}
+
+		// For each texel of the smaller size, which texels of the larger size it reads and by how much.
+		// Every texel has the same number of taps so the passes need no branching, unused taps weigh 0.
+		struct FilterTable
+		{
+			int taps{ 0 };
+			std::vector<int> indices;
+			std::vector<float> weights;
+		};
+
+		FilterTable BuildFilterTable(int sourceSize, int size, const MipSettings& settings)
+		{
+			const float scale{ (float)sourceSize / size };
+			const float support{ settings.filter == MipFilter::Box ? scale * 0.5f : 3.0f * scale };
+
+			FilterTable table;
+			table.taps = (int)std::ceil(support * 2.0f) + 1;
+			table.indices.resize((size_t)size * table.taps);
+			table.weights.resize((size_t)size * table.taps);
+
+			for (int i = 0; i < size; i++)
+			{
+				// Texel j covers [j, j + 1]
+				const float centre{ (i + 0.5f) * scale };
+				const int first{ (int)std::floor(centre - support) };
+
+				float total{ 0 };
+				for (int t = 0; t < table.taps; t++)
+				{
+					const int j{ first + t };
+
+					float weight;
+					if (settings.filter == MipFilter::Box)
+						weight = std::max(0.0f, std::min(j + 1.0f, centre + support) - std::max((float)j, centre - support));
+					else
+					{
+						const float x{ (j + 0.5f - centre) / scale };
+						weight = std::abs(x) < 3.0f ? Sinc(x) * Sinc(x / 3.0f) : 0.0f;
+					}
+
+					int index{ j };
+					if (settings.wrap)
+						index = ((j % sourceSize) + sourceSize) % sourceSize;
+					else
+						index = std::min(std::max(j, 0), sourceSize - 1);
+
+					table.indices[(size_t)i * table.taps + t] = index;
+					table.weights[(size_t)i * table.taps + t] = weight;
+					total += weight;
+				}
+
+				for (int t = 0; t < table.taps; t++)
+					table.weights[(size_t)i * table.taps + t] /= total;
+			}
+
+			return table;
+		}
+
+		// dst += weight * src for count RGBA float texels
+		inline void AddWeighted(float* dst, const float* src, float weight, size_t count)
+		{
+#if HELPERS_SSE2
+			const __m128 w{ _mm_set1_ps(weight) };
+			for (size_t i = 0; i < count; i++)
+				_mm_storeu_ps(dst + i * 4, _mm_add_ps(_mm_loadu_ps(dst + i * 4), _mm_mul_ps(_mm_loadu_ps(src + i * 4), w)));
+#else
+			for (size_t i = 0; i < count * 4; i++)
+				dst[i] += src[i] * weight;
+#endif
+		}
+
+		// One texel from the taps of a row
+		inline void FilterTexel(float* dst, const float* row, const int* indices, const float* weights, int taps)
+		{
+#if HELPERS_SSE2
+			__m128 sum{ _mm_setzero_ps() };
+			for (int t = 0; t < taps; t++)
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(row + (size_t)indices[t] * 4), _mm_set1_ps(weights[t])));
+			_mm_storeu_ps(dst, sum);
+#else
+			dst[0] = dst[1] = dst[2] = dst[3] = 0;
+			for (int t = 0; t < taps; t++)
+				for (int c = 0; c < 4; c++)
+					dst[c] += row[(size_t)indices[t] * 4 + c] * weights[t];
+#endif
+		}
+
+		// Halves a float image, rows then columns
+		void Downsample(const std::vector<float>& source, int sourceWidth, int sourceHeight, std::vector<float>& result,
+			int width, int height, const MipSettings& settings, ThreadPool& pool)
+		{
+			const FilterTable columns{ BuildFilterTable(sourceWidth, width, settings) };
+			const FilterTable rows{ BuildFilterTable(sourceHeight, height, settings) };
+
+			// Narrowed but still full height
+			std::vector<float> narrowed((size_t)width * sourceHeight * 4);
+			pool.ParallelFor(sourceHeight, std::max(1, 16384 / sourceWidth), [&](size_t begin, size_t end)
+			{
+				for (size_t y = begin; y < end; y++)
+				{
+					const float* row{ source.data() + y * sourceWidth * 4 };
+					float* out{ narrowed.data() + y * width * 4 };
+					for (int x = 0; x < width; x++)
+					{
+						FilterTexel(out + (size_t)x * 4, row, columns.indices.data() + (size_t)x * columns.taps,
+							columns.weights.data() + (size_t)x * columns.taps, columns.taps);
+					}
+				}
+			});
+
+			result.assign((size_t)width * height * 4, 0.0f);
+			pool.ParallelFor(height, std::max(1, 16384 / width), [&](size_t begin, size_t end)
+			{
+				for (size_t y = begin; y < end; y++)
+				{
+					float* out{ result.data() + y * width * 4 };
+					for (int t = 0; t < rows.taps; t++)
+					{
+						const size_t tap{ y * rows.taps + t };
+						if (rows.weights[tap] != 0.0f)
+							AddWeighted(out, narrowed.data() + (size_t)rows.indices[tap] * width * 4, rows.weights[tap], width);
+					}
+				}
+			});
+		}
+
+		// Box chain of a fixed image in gamma space, made before any change to the filter. Box weights and gamma space take
+		// no sin or pow, so every compiler and CPU should give these bytes.
+		const uint64_t kGoldenBoxChainHash{ 0x4764B609FD301E6Aull };
+
+		// Stand in for the benchmark's own image: noise over gradients so the filters have detail to keep, and hard edged
+		// squares so Lanczos rings. Fixed seed so runs are comparable.
+		std::vector<unsigned char> NoisyImage(int width, int height)
+		{
+			std::mt19937 random(1234);
+			std::uniform_int_distribution<int> noise(0, 63);
+			std::vector<unsigned char> image((size_t)width * height * 4);
+			for (int y = 0; y < height; y++)
+			{
+				for (int x = 0; x < width; x++)
+				{
+					unsigned char* texel{ &image[((size_t)y * width + x) * 4] };
+					texel[0] = (unsigned char)(x * 192 / width + noise(random));
+					texel[1] = (unsigned char)(y * 192 / height + noise(random));
+					texel[2] = (unsigned char)(((x ^ y) & 8) ? 255 : 0);
+					texel[3] = 255;
+				}
+			}
+			return image;
+		}
+
+		// What the box filter should give for a power of two image, straight from the definition: each level averages the
+		// 2x2 texels (2x1 or 1x2 once a side is down to 1) of the one before, in floating point, at full precision
+		std::vector<std::vector<unsigned char>> BoxReference(const std::vector<unsigned char>& rgba, int width, int height, bool linearLight)
+		{
+			std::vector<float> texels(rgba.size());
+			for (size_t i = 0; i < texels.size(); i++)
+			{
+				const float c{ rgba[i] / 255.0f };
+				texels[i] = linearLight && (i & 3) != 3 ? (c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f)) : c;
+			}
+
+			std::vector<std::vector<unsigned char>> levels{ rgba };
+			while (width > 1 || height > 1)
+			{
+				const int nextWidth{ std::max(1, width / 2) };
+				const int nextHeight{ std::max(1, height / 2) };
+				const int stepX{ width / nextWidth };
+				const int stepY{ height / nextHeight };
+
+				std::vector<float> smaller((size_t)nextWidth * nextHeight * 4);
+				std::vector<unsigned char> bytes(smaller.size());
+				for (size_t i = 0; i < smaller.size(); i++)
+				{
+					const int x{ (int)(i / 4 % nextWidth) };
+					const int y{ (int)(i / 4 / nextWidth) };
+					const int c{ (int)(i & 3) };
+					float sum{ 0 };
+					for (int dy = 0; dy < stepY; dy++)
+						for (int dx = 0; dx < stepX; dx++)
+							sum += texels[(((size_t)y * stepY + dy) * width + x * stepX + dx) * 4 + c];
+					smaller[i] = sum / (stepX * stepY);
+
+					const float value{ std::min(std::max(smaller[i], 0.0f), 1.0f) };
+					const float encoded{ linearLight && c != 3 ?
+						(value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f) : value };
+					bytes[i] = (unsigned char)std::min(255.0f, encoded * 255.0f + 0.5f);
+				}
+
+				levels.push_back(bytes);
+				texels.swap(smaller);
+				width = nextWidth;
+				height = nextHeight;
+			}
+			return levels;
+		}
+
+		// Mean of each channel of a level
+		glm::dvec4 MeanTexel(const MipLevel& level)
+		{
+			glm::dvec4 sum{ 0 };
+			for (size_t i = 0; i < level.data.size(); i++)
+				sum[(int)(i & 3)] += level.data[i];
+			return sum / std::max((double)level.width * level.height, 1.0);
+		}
+
+		// Back to bytes, colour through sRGB if it was filtered in linear light
+		void ToBytes(const std::vector<float>& texels, bool linearLight, std::vector<unsigned char>& bytes)
+		{
+			const unsigned char* toSrgb{ LinearToSrgbTable() };
+			bytes.resize(texels.size());
+			for (size_t i = 0; i < texels.size(); i++)
+			{
+				const float value{ std::min(std::max(texels[i], 0.0f), 1.0f) };
+				if (linearLight && (i & 3) != 3)
+					bytes[i] = toSrgb[(int)(value * 65535.0f + 0.5f)];
+				else
+					bytes[i] = (unsigned char)(value * 255.0f + 0.5f);
+			}
+		}
+	}
+
+	// Builds the full chain, each level made from the one before kept in floating point
+	MipChain GenerateMipChain(const unsigned char* rgba, int width, int height, const MipSettings& settings, ThreadPool& pool)
+	{
+		MipChain chain;
+		if (!rgba || width <= 0 || height <= 0)
+			return chain;
+
+		chain.levels.push_back(MipLevel{ width, height, std::vector<unsigned char>(rgba, rgba + (size_t)width * height * 4) });
+
+		const float* toLinear{ SrgbToLinearTable() };
+		std::vector<float> texels((size_t)width * height * 4);
+		for (size_t i = 0; i < texels.size(); i++)
+			texels[i] = settings.linearLight && (i & 3) != 3 ? toLinear[rgba[i]] : rgba[i] / 255.0f;
+
+		std::vector<float> smaller;
+		while (width > 1 || height > 1)
+		{
+			const int nextWidth{ std::max(1, width / 2) };
+			const int nextHeight{ std::max(1, height / 2) };
+			Downsample(texels, width, height, smaller, nextWidth, nextHeight, settings, pool);
+
+			chain.levels.push_back(MipLevel{ nextWidth, nextHeight, std::vector<unsigned char>() });
+			ToBytes(smaller, settings.linearLight, chain.levels.back().data);
+
+			texels.swap(smaller);
+			width = nextWidth;
+			height = nextHeight;
+		}
+
+		return chain;
+	}
+
+	// Times building the chain of a size x size test image with each filter, then checks the filters on small images
+	MipBenchmarkResult BenchmarkMips(int size, int iterations, ThreadPool& pool)
+	{
+		MipBenchmarkResult result;
+		result.size = size;
+		result.numThreads = pool.NumThreads() + 1;
+		if (size <= 0 || iterations <= 0)
+			return result;
+
+		const std::vector<unsigned char> image{ NoisyImage(size, size) };
+		const auto milliseconds{ [&](const MipSettings& settings)
+		{
+			const auto start{ std::chrono::high_resolution_clock::now() };
+			for (int i = 0; i < iterations; i++)
+				GenerateMipChain(image.data(), size, size, settings, pool);
+			return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / iterations;
+		} };
+
+		MipSettings settings;
+		result.boxMilliseconds = milliseconds(settings);
+		settings.filter = MipFilter::Lanczos3;
+		result.lanczosMilliseconds = milliseconds(settings);
+
+		const MipChain first{ GenerateMipChain(image.data(), size, size, settings, pool) };
+		const MipChain second{ GenerateMipChain(image.data(), size, size, settings, pool) };
+		result.deterministic = first.levels.size() == second.levels.size();
+		for (size_t level = 0; result.deterministic && level < first.levels.size(); level++)
+			result.deterministic = first.levels[level].data == second.levels[level].data;
+
+		// One colour everywhere has nothing to average away, whatever the filter, space or edge handling.
+		// Odd sizes so the box covers fractions of texels and the levels are not all halves.
+		const unsigned char flatColour[4]{ 37, 128, 211, 90 };
+		std::vector<unsigned char> flat((size_t)37 * 21 * 4);
+		for (size_t i = 0; i < flat.size(); i++)
+			flat[i] = flatColour[i & 3];
+		result.flatStaysFlat = true;
+		for (const MipFilter filter : { MipFilter::Box, MipFilter::Lanczos3 })
+		{
+			for (const bool linearLight : { false, true })
+			{
+				for (const bool wrap : { false, true })
+				{
+					const MipChain chain{ GenerateMipChain(flat.data(), 37, 21, MipSettings{ filter, linearLight, wrap }, pool) };
+					for (const MipLevel& level : chain.levels)
+						for (size_t i = 0; i < level.data.size(); i++)
+							result.flatStaysFlat = result.flatStaysFlat && level.data[i] == flatColour[i & 3];
+				}
+			}
+		}
+
+		// Box against the 2x2 average, non square so the last levels are a texel across
+		const int kReferenceWidth{ 64 };
+		const int kReferenceHeight{ 16 };
+		const std::vector<unsigned char> small{ NoisyImage(kReferenceWidth, kReferenceHeight) };
+		for (const bool linearLight : { false, true })
+		{
+			const MipChain chain{ GenerateMipChain(small.data(), kReferenceWidth, kReferenceHeight, MipSettings{ MipFilter::Box, linearLight, true }, pool) };
+			const std::vector<std::vector<unsigned char>> reference{ BoxReference(small, kReferenceWidth, kReferenceHeight, linearLight) };
+			if (chain.levels.size() != reference.size())
+				result.maxBoxDifference = 255;
+			for (size_t level = 0; level < std::min(chain.levels.size(), reference.size()); level++)
+				for (size_t i = 0; i < reference[level].size(); i++)
+					result.maxBoxDifference = std::max(result.maxBoxDifference, std::abs(chain.levels[level].data[i] - reference[level][i]));
+		}
+
+		// Wrapping, each texel of a level gives the same total weight to the next, so apart from rounding and ringing
+		// clipped at black and white the average colour should not move
+		const int kMeanSize{ 256 };
+		const std::vector<unsigned char> meanImage{ NoisyImage(kMeanSize, kMeanSize) };
+		const MipChain lanczos{ GenerateMipChain(meanImage.data(), kMeanSize, kMeanSize, MipSettings{ MipFilter::Lanczos3, false, true }, pool) };
+		const glm::dvec4 mean{ MeanTexel(lanczos.levels[0]) };
+		for (const MipLevel& level : lanczos.levels)
+		{
+			const glm::dvec4 shift{ glm::abs(MeanTexel(level) - mean) };
+			result.maxLanczosMeanShift = std::max({ result.maxLanczosMeanShift, (float)shift.x, (float)shift.y, (float)shift.z, (float)shift.w });
+		}
+
+		// The whole box chain of a fixed pattern, against the hash it had before
+		const int kGoldenWidth{ 61 };
+		const int kGoldenHeight{ 35 };
+		std::vector<unsigned char> pattern((size_t)kGoldenWidth * kGoldenHeight * 4);
+		for (size_t i = 0; i < pattern.size(); i++)
+			pattern[i] = (unsigned char)((i * 2654435761u) >> 13);
+		const MipChain golden{ GenerateMipChain(pattern.data(), kGoldenWidth, kGoldenHeight, MipSettings{ MipFilter::Box, false, true }, pool) };
+		for (const MipLevel& level : golden.levels)
+			result.chainHash = HashVector(level.data, result.chainHash);
+		result.matchesGolden = result.chainHash == kGoldenBoxChainHash;
+
+		return result;
+	}
+}
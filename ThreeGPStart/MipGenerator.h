@@ -0,0 +1,96 @@
+#pragma once
+// Builds texture mip chains on the CPU, so every driver gets the same levels and they can be baked once
+
+#include "ExternalLibraryHeaders.h"
+#include "ThreadPool.h"
+
+namespace Helpers
+{
+	enum class MipFilter
+	{
+		// Average of the texels each new texel covers, quickest
+		Box,
+
+		// Three lobe windowed sinc, keeps smaller levels sharp where a box blurs them
+		Lanczos3
+	};
+
+	struct MipSettings
+	{
+		MipFilter filter{ MipFilter::Box };
+
+		// Colour texels are sRGB so averaging them as stored darkens the smaller levels. With this set colour is
+		// filtered in linear light and converted back. Alpha is always linear. Turn off for data such as heightmaps.
+		bool linearLight{ true };
+
+		// Filters reaching off an edge wrap round to the other side, for repeating textures. Otherwise the edge is extended.
+		bool wrap{ true };
+	};
+
+	// One level of a chain, 32 bit RGBA
+	struct MipLevel
+	{
+		int width{ 0 };
+		int height{ 0 };
+		std::vector<unsigned char> data;
+	};
+
+	struct MipChain
+	{
+		// levels[0] is the full size image, each level after is half the last (rounding down) to 1x1
+		std::vector<MipLevel> levels;
+
+		size_t MemoryBytes() const {
+			size_t bytes{ 0 };
+			for (const MipLevel& level : levels)
+				bytes += level.data.size();
+			return bytes;
+		}
+	};
+
+	// Builds the full chain for width x height RGBA texels. Each level is made from the one before kept in floating
+	// point, the rows of each pass shared among the pool. SSE2 where available, filtering the four channels at once.
+	MipChain GenerateMipChain(const unsigned char* rgba, int width, int height, const MipSettings& settings = MipSettings(),
+		ThreadPool& pool = ThreadPool::Shared());
+
+	struct MipBenchmarkResult
+	{
+		int size{ 0 };
+		unsigned int numThreads{ 0 };
+		double boxMilliseconds{ 0 };
+		double lanczosMilliseconds{ 0 };
+
+		// Same chain from two runs, byte for byte
+		bool deterministic{ false };
+
+		// An image of one colour gives that colour at every level, each filter in gamma and linear light
+		bool flatStaysFlat{ false };
+
+		// Largest difference in any byte between the box filter and a plain 2x2 average
+		int maxBoxDifference{ 0 };
+
+		// Largest move of any channel's average value (0 to 255) between the first level and any other with Lanczos3
+		float maxLanczosMeanShift{ 0 };
+
+		// Hash of the box chain of a fixed image, and whether it matched the one recorded
+		uint64_t chainHash{ 0 };
+		bool matchesGolden{ false };
+
+		bool Passed() const {
+			return deterministic && flatStaysFlat && maxBoxDifference <= 1 && maxLanczosMeanShift <= 1.0f && matchesGolden;
+		}
+
+		std::string ToString() const {
+			return "Mips " + std::to_string(size) + "x" + std::to_string(size) + " on " + std::to_string(numThreads) + " threads. Box: " +
+				std::to_string(boxMilliseconds) + " ms Lanczos3: " + std::to_string(lanczosMilliseconds) + " ms Deterministic: " +
+				(deterministic ? "yes" : "NO") + " Flat: " + (flatStaysFlat ? "yes" : "NO") + " Box vs reference: " +
+				std::to_string(maxBoxDifference) + " Lanczos3 mean shift: " + std::to_string(maxLanczosMeanShift) + " Golden: " +
+				(matchesGolden ? "yes" : "NO") + (Passed() ? " PASS" : " FAIL");
+		}
+	};
+
+	// Times building the chain of a size x size test image with each filter, in linear light. Then checks a flat image
+	// stays flat, the box filter against a plain average, that Lanczos3 keeps the average colour and the box chain of a
+	// fixed image against a recorded hash.
+	MipBenchmarkResult BenchmarkMips(int size = 2048, int iterations = 5, ThreadPool& pool = ThreadPool::Shared());
+}
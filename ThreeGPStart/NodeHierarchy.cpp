@@ -0,0 +1,128 @@
+#include "NodeHierarchy.h"
+
+#include <functional>
+
+namespace Helpers
+{
+	// OpenGL uses column major matrices while ASSIMP uses row major - this converts
+	glm::mat4 aiMatrix4x4ToGlm(const aiMatrix4x4& from)
+	{
+		glm::mat4 to;
+
+		to[0][0] = (GLfloat)from.a1; to[0][1] = (GLfloat)from.b1;  to[0][2] = (GLfloat)from.c1; to[0][3] = (GLfloat)from.d1;
+		to[1][0] = (GLfloat)from.a2; to[1][1] = (GLfloat)from.b2;  to[1][2] = (GLfloat)from.c2; to[1][3] = (GLfloat)from.d2;
+		to[2][0] = (GLfloat)from.a3; to[2][1] = (GLfloat)from.b3;  to[2][2] = (GLfloat)from.c3; to[2][3] = (GLfloat)from.d3;
+		to[3][0] = (GLfloat)from.a4; to[3][1] = (GLfloat)from.b4;  to[3][2] = (GLfloat)from.c4; to[3][3] = (GLfloat)from.d4;
+
+		return to;
+	}
+
+	// Flattens the assimp node tree
+	void NodeHierarchy::Build(const aiNode* root)
+	{
+		names.clear();
+		nameHashes.clear();
+		parents.clear();
+		localTransforms.clear();
+		worldTransforms.clear();
+		meshStart.clear();
+		meshCount.clear();
+		meshIndices.clear();
+		m_nameToIndex.clear();
+
+		if (!root)
+			return;
+
+		// Depth first with an explicit stack, children are pushed in reverse so they come out in order
+		struct PendingNode
+		{
+			const aiNode* node;
+			int parent;
+		};
+		std::vector<PendingNode> stack{ { root, kInvalidNode } };
+
+		const std::hash<std::string> hasher;
+		while (!stack.empty())
+		{
+			const PendingNode pending{ stack.back() };
+			stack.pop_back();
+
+			const int index{ (int)parents.size() };
+			const aiNode* node{ pending.node };
+
+			names.push_back(node->mName.C_Str());
+			nameHashes.push_back(hasher(names.back()));
+			parents.push_back(pending.parent);
+			localTransforms.push_back(aiMatrix4x4ToGlm(node->mTransformation));
+
+			meshStart.push_back((unsigned int)meshIndices.size());
+			meshCount.push_back(node->mNumMeshes);
+			meshIndices.insert(meshIndices.end(), node->mMeshes, node->mMeshes + node->mNumMeshes);
+
+			// First node with a name keeps it, matching the old depth first search
+			m_nameToIndex.emplace(nameHashes.back(), index);
+
+			for (unsigned int c = node->mNumChildren; c > 0; c--)
+				stack.push_back(PendingNode{ node->mChildren[c - 1], index });
+		}
+
+		worldTransforms.resize(localTransforms.size());
+		UpdateWorldTransforms();
+	}
+
+	// Retrieve a node index by name, kInvalidNode if not found
+	int NodeHierarchy::FindNode(const std::string& nodeName) const
+	{
+		const size_t hash{ std::hash<std::string>()(nodeName) };
+
+		auto found{ m_nameToIndex.find(hash) };
+		if (found == m_nameToIndex.end())
+			return kInvalidNode;
+
+		if (names[found->second] == nodeName)
+			return found->second;
+
+		// Two names share a hash, very unlikely so just search
+		for (size_t i = 0; i < names.size(); i++)
+			if (nameHashes[i] == hash && names[i] == nodeName)
+				return (int)i;
+
+		return kInvalidNode;
+	}
+
+	// Recalculates every world transform from the local transforms
+	void NodeHierarchy::UpdateWorldTransforms()
+	{
+		// Parents come first so theirs are always already up to date
+		for (size_t i = 0; i < parents.size(); i++)
+		{
+			if (parents[i] == kInvalidNode)
+				worldTransforms[i] = localTransforms[i];
+			else
+				worldTransforms[i] = worldTransforms[parents[i]] * localTransforms[i];
+		}
+	}
+
+	// Helper to output the hierarchy, indented by depth
+	std::string NodeHierarchy::ToString() const
+	{
+		std::vector<int> depths(parents.size(), 0);
+		std::string result;
+
+		for (size_t i = 0; i < parents.size(); i++)
+		{
+			if (parents[i] != kInvalidNode)
+				depths[i] = depths[parents[i]] + 1;
+
+			const glm::vec3 tran{ localTransforms[i][3] };
+
+			result += std::string(depths[i], ' ') + "Node name: " + names[i] +
+				" Trans: " + std::to_string(tran.x) + "," + std::to_string(tran.y) + "," + std::to_string(tran.z) + " Mesh: ";
+			for (unsigned int m = 0; m < meshCount[i]; m++)
+				result += std::to_string(meshIndices[meshStart[i] + m]) + " ";
+			result += "\n";
+		}
+
+		return result;
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+// A model's node hierarchy stored as flat arrays rather than a tree of heap allocated nodes
+
+#include "ExternalLibraryHeaders.h"
+
+#include <unordered_map>
+
+namespace Helpers
+{
+	// OpenGL uses column major matrices while ASSIMP uses row major - this converts
+	glm::mat4 aiMatrix4x4ToGlm(const aiMatrix4x4& from);
+
+	// Nodes are stored in parent before child order (depth first) so every array is indexed by node
+	// and world transforms can be updated in one forward pass
+	struct NodeHierarchy
+	{
+		// Returned by FindNode when there is no node with the name
+		static const int kInvalidNode{ -1 };
+
+		std::vector<std::string> names;
+		std::vector<size_t> nameHashes;
+
+		// Index of each node's parent, kInvalidNode for the root
+		std::vector<int> parents;
+
+		// Transform relative to the parent, and the result of concatenating all the parents
+		std::vector<glm::mat4> localTransforms;
+		std::vector<glm::mat4> worldTransforms;
+
+		// Each node's mesh are meshIndices[meshStart, meshStart + meshCount)
+		std::vector<unsigned int> meshStart;
+		std::vector<unsigned int> meshCount;
+		std::vector<unsigned int> meshIndices;
+
+		// Number of nodes
+		size_t Size() const { return parents.size(); }
+
+		// Flattens the assimp node tree
+		void Build(const aiNode* root);
+
+		// Retrieve a node index by name, kInvalidNode if not found. If names repeat the first found depth first wins.
+		int FindNode(const std::string& nodeName) const;
+
+		// Recalculates every world transform from the local transforms
+		void UpdateWorldTransforms();
+
+		// Helper to output the hierarchy, indented by depth
+		std::string ToString() const;
+
+	private:
+		std::unordered_map<size_t, int> m_nameToIndex;
+	};
+}
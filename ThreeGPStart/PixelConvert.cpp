@@ -0,0 +1,385 @@
+#include "PixelConvert.h"
+#include "Simd.h"
+
+#include <chrono>
+#include <cstring>
+#include <random>
+
+namespace Helpers
+{
+	// Plain C++, the reference the others must match and what runs on the ends of rows
+
+	static void SwizzleBGRAScalar(const unsigned char* source, unsigned char* dest, size_t count)
+	{
+		for (size_t i = 0; i < count; i++, source += 4, dest += 4)
+		{
+			dest[0] = source[2];
+			dest[1] = source[1];
+			dest[2] = source[0];
+			dest[3] = source[3];
+		}
+	}
+
+	static void ConvertRGB24Scalar(const unsigned char* source, unsigned char* dest, size_t count, ChannelOrder order)
+	{
+		const int red{ order == ChannelOrder::BGR ? 2 : 0 };
+		for (size_t i = 0; i < count; i++, source += 3, dest += 4)
+		{
+			dest[0] = source[red];
+			dest[1] = source[1];
+			dest[2] = source[2 - red];
+			dest[3] = 255;
+		}
+	}
+
+	static void ConvertGrey16Scalar(const uint16_t* source, unsigned char* dest, size_t count)
+	{
+		for (size_t i = 0; i < count; i++, dest += 4)
+		{
+			dest[0] = dest[1] = dest[2] = (unsigned char)(source[i] >> 8);
+			dest[3] = 255;
+		}
+	}
+
+	static void ConvertRedTo16Scalar(const unsigned char* rgba, uint16_t* dest, size_t count)
+	{
+		for (size_t i = 0; i < count; i++, rgba += 4)
+			dest[i] = (uint16_t)(rgba[0] * 257);
+	}
+
+	// c * a / 255 rounded, exactly, without a divide
+	static inline unsigned char MultiplyAlpha(unsigned int colour, unsigned int alpha)
+	{
+		const unsigned int product{ colour * alpha + 128 };
+		return (unsigned char)((product + (product >> 8)) >> 8);
+	}
+
+	static void PremultiplyAlphaScalar(unsigned char* rgba, size_t count)
+	{
+		for (size_t i = 0; i < count; i++, rgba += 4)
+		{
+			rgba[0] = MultiplyAlpha(rgba[0], rgba[3]);
+			rgba[1] = MultiplyAlpha(rgba[1], rgba[3]);
+			rgba[2] = MultiplyAlpha(rgba[2], rgba[3]);
+		}
+	}
+
+#if HELPERS_SSE2
+	// SSE2, which every x64 CPU has
+
+	// Swaps bytes 0 and 2 of each texel with shifts and masks, there is no byte shuffle before SSSE3
+	static void SwizzleBGRASSE2(const unsigned char* source, unsigned char* dest, size_t count)
+	{
+		const __m128i greenAlpha{ _mm_set1_epi32((int)0xFF00FF00) };
+		const __m128i low{ _mm_set1_epi32(0xFF) };
+		size_t i{ 0 };
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128i texels{ _mm_loadu_si128((const __m128i*)(source + i * 4)) };
+			const __m128i swapped{ _mm_or_si128(_mm_and_si128(_mm_srli_epi32(texels, 16), low),
+				_mm_slli_epi32(_mm_and_si128(texels, low), 16)) };
+			_mm_storeu_si128((__m128i*)(dest + i * 4), _mm_or_si128(_mm_and_si128(texels, greenAlpha), swapped));
+		}
+		SwizzleBGRAScalar(source + i * 4, dest + i * 4, count - i);
+	}
+
+	// Eight greys at a time, narrowed to bytes and spread across the texels by unpacking
+	static void ConvertGrey16SSE2(const uint16_t* source, unsigned char* dest, size_t count)
+	{
+		const __m128i opaque{ _mm_set1_epi8((char)0xFF) };
+		size_t i{ 0 };
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m128i wide{ _mm_srli_epi16(_mm_loadu_si128((const __m128i*)(source + i)), 8) };
+			const __m128i grey{ _mm_packus_epi16(wide, wide) };
+			const __m128i greyGrey{ _mm_unpacklo_epi8(grey, grey) };
+			const __m128i greyAlpha{ _mm_unpacklo_epi8(grey, opaque) };
+			_mm_storeu_si128((__m128i*)(dest + i * 4), _mm_unpacklo_epi16(greyGrey, greyAlpha));
+			_mm_storeu_si128((__m128i*)(dest + i * 4 + 16), _mm_unpackhi_epi16(greyGrey, greyAlpha));
+		}
+		ConvertGrey16Scalar(source + i, dest + i * 4, count - i);
+	}
+
+	// Eight reds masked out of their texels and packed to 16 bits, x 257 is the byte in both halves
+	static void ConvertRedTo16SSE2(const unsigned char* rgba, uint16_t* dest, size_t count)
+	{
+		const __m128i red{ _mm_set1_epi32(0xFF) };
+		size_t i{ 0 };
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m128i low{ _mm_and_si128(_mm_loadu_si128((const __m128i*)(rgba + i * 4)), red) };
+			const __m128i high{ _mm_and_si128(_mm_loadu_si128((const __m128i*)(rgba + i * 4 + 16)), red) };
+			const __m128i reds{ _mm_packs_epi32(low, high) };
+			_mm_storeu_si128((__m128i*)(dest + i), _mm_or_si128(reds, _mm_slli_epi16(reds, 8)));
+		}
+		ConvertRedTo16Scalar(rgba + i * 4, dest + i, count - i);
+	}
+
+	// Two texels widened to 16 bits a channel, colour times alpha and alpha times 255, each divided by 255 rounded
+	static inline __m128i PremultiplyPairSSE2(__m128i texels)
+	{
+		const __m128i alphaOnly{ _mm_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1) };
+		const __m128i alpha{ _mm_shufflehi_epi16(_mm_shufflelo_epi16(texels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3)) };
+		const __m128i factor{ _mm_or_si128(_mm_andnot_si128(alphaOnly, alpha), _mm_and_si128(alphaOnly, _mm_set1_epi16(255))) };
+		const __m128i product{ _mm_add_epi16(_mm_mullo_epi16(texels, factor), _mm_set1_epi16(128)) };
+		return _mm_srli_epi16(_mm_add_epi16(product, _mm_srli_epi16(product, 8)), 8);
+	}
+
+	static void PremultiplyAlphaSSE2(unsigned char* rgba, size_t count)
+	{
+		const __m128i zero{ _mm_setzero_si128() };
+		size_t i{ 0 };
+		for (; i + 4 <= count; i += 4)
+		{
+			const __m128i texels{ _mm_loadu_si128((const __m128i*)(rgba + i * 4)) };
+			const __m128i low{ PremultiplyPairSSE2(_mm_unpacklo_epi8(texels, zero)) };
+			const __m128i high{ PremultiplyPairSSE2(_mm_unpackhi_epi8(texels, zero)) };
+			_mm_storeu_si128((__m128i*)(rgba + i * 4), _mm_packus_epi16(low, high));
+		}
+		PremultiplyAlphaScalar(rgba + i * 4, count - i);
+	}
+
+	// SSSE3, a byte shuffle does the swizzle and expansion in one instruction
+
+	HELPERS_TARGET("ssse3")
+	static void SwizzleBGRASSSE3(const unsigned char* source, unsigned char* dest, size_t count)
+	{
+		const __m128i swap{ _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15) };
+		size_t i{ 0 };
+		for (; i + 4 <= count; i += 4)
+			_mm_storeu_si128((__m128i*)(dest + i * 4), _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(source + i * 4)), swap));
+		SwizzleBGRAScalar(source + i * 4, dest + i * 4, count - i);
+	}
+
+	// Four texels from twelve bytes. Each load is sixteen bytes so the loop stops while that stays inside the row.
+	HELPERS_TARGET("ssse3")
+	static void ConvertRGB24SSSE3(const unsigned char* source, unsigned char* dest, size_t count, ChannelOrder order)
+	{
+		const __m128i expand{ order == ChannelOrder::BGR ?
+			_mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1) :
+			_mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1) };
+		const __m128i opaque{ _mm_set1_epi32((int)0xFF000000) };
+		size_t i{ 0 };
+		for (; i + 6 <= count; i += 4)
+		{
+			const __m128i texels{ _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(source + i * 3)), expand) };
+			_mm_storeu_si128((__m128i*)(dest + i * 4), _mm_or_si128(texels, opaque));
+		}
+		ConvertRGB24Scalar(source + i * 3, dest + i * 4, count - i, order);
+	}
+
+	// AVX2, the same shuffles on eight texels. The shuffle works within each 128 bit half, so the 24 bit loads put
+	// four texels' bytes at the start of each half.
+
+	HELPERS_TARGET("avx2")
+	static void SwizzleBGRAAVX2(const unsigned char* source, unsigned char* dest, size_t count)
+	{
+		const __m256i swap{ _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+			2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15) };
+		size_t i{ 0 };
+		for (; i + 8 <= count; i += 8)
+			_mm256_storeu_si256((__m256i*)(dest + i * 4), _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(source + i * 4)), swap));
+		SwizzleBGRAScalar(source + i * 4, dest + i * 4, count - i);
+	}
+
+	HELPERS_TARGET("avx2")
+	static void ConvertRGB24AVX2(const unsigned char* source, unsigned char* dest, size_t count, ChannelOrder order)
+	{
+		const __m256i expand{ order == ChannelOrder::BGR ?
+			_mm256_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1) :
+			_mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1) };
+		const __m256i opaque{ _mm256_set1_epi32((int)0xFF000000) };
+		size_t i{ 0 };
+		for (; i + 10 <= count; i += 8)
+		{
+			const __m128i first{ _mm_loadu_si128((const __m128i*)(source + i * 3)) };
+			const __m128i second{ _mm_loadu_si128((const __m128i*)(source + i * 3 + 12)) };
+			const __m256i texels{ _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(first), second, 1), expand) };
+			_mm256_storeu_si256((__m256i*)(dest + i * 4), _mm256_or_si256(texels, opaque));
+		}
+		ConvertRGB24Scalar(source + i * 3, dest + i * 4, count - i, order);
+	}
+
+	// As PremultiplyPairSSE2 on four texels, a byte shuffle copies each alpha across its texel
+	HELPERS_TARGET("avx2")
+	static inline __m256i PremultiplyQuadAVX2(__m256i texels)
+	{
+		const __m256i alphaOnly{ _mm256_setr_epi16(0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1, 0, 0, 0, -1) };
+		const __m256i alphaBytes{ _mm256_setr_epi8(6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15,
+			6, 7, 6, 7, 6, 7, 6, 7, 14, 15, 14, 15, 14, 15, 14, 15) };
+		const __m256i alpha{ _mm256_shuffle_epi8(texels, alphaBytes) };
+		const __m256i factor{ _mm256_blendv_epi8(alpha, _mm256_set1_epi16(255), alphaOnly) };
+		const __m256i product{ _mm256_add_epi16(_mm256_mullo_epi16(texels, factor), _mm256_set1_epi16(128)) };
+		return _mm256_srli_epi16(_mm256_add_epi16(product, _mm256_srli_epi16(product, 8)), 8);
+	}
+
+	HELPERS_TARGET("avx2")
+	static void PremultiplyAlphaAVX2(unsigned char* rgba, size_t count)
+	{
+		const __m256i zero{ _mm256_setzero_si256() };
+		size_t i{ 0 };
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m256i texels{ _mm256_loadu_si256((const __m256i*)(rgba + i * 4)) };
+			const __m256i low{ PremultiplyQuadAVX2(_mm256_unpacklo_epi8(texels, zero)) };
+			const __m256i high{ PremultiplyQuadAVX2(_mm256_unpackhi_epi8(texels, zero)) };
+			_mm256_storeu_si256((__m256i*)(rgba + i * 4), _mm256_packus_epi16(low, high));
+		}
+		PremultiplyAlphaScalar(rgba + i * 4, count - i);
+	}
+#endif
+
+	// One set of kernels. A set uses the best kernel it has for each conversion, which may be an older set's or scalar.
+	struct PixelKernels
+	{
+		std::string name;
+		void (*swizzleBGRA)(const unsigned char*, unsigned char*, size_t);
+		void (*convertRGB24)(const unsigned char*, unsigned char*, size_t, ChannelOrder);
+		void (*convertGrey16)(const uint16_t*, unsigned char*, size_t);
+		void (*convertRedTo16)(const unsigned char*, uint16_t*, size_t);
+		void (*premultiplyAlpha)(unsigned char*, size_t);
+	};
+
+	static const PixelKernels kScalarKernels{ "scalar", SwizzleBGRAScalar, ConvertRGB24Scalar, ConvertGrey16Scalar, ConvertRedTo16Scalar,
+		PremultiplyAlphaScalar };
+
+	// Every set this CPU can run, narrowest first
+	static std::vector<PixelKernels> GetSupportedKernels()
+	{
+		std::vector<PixelKernels> supported;
+#if HELPERS_SSE2
+		const CpuFeatures& cpu{ CpuFeatures::Get() };
+		supported.push_back(PixelKernels{ "SSE2", SwizzleBGRASSE2, ConvertRGB24Scalar, ConvertGrey16SSE2, ConvertRedTo16SSE2, PremultiplyAlphaSSE2 });
+		if (cpu.ssse3)
+			supported.push_back(PixelKernels{ "SSSE3", SwizzleBGRASSSE3, ConvertRGB24SSSE3, ConvertGrey16SSE2, ConvertRedTo16SSE2, PremultiplyAlphaSSE2 });
+		if (cpu.avx2)
+			supported.push_back(PixelKernels{ "AVX2", SwizzleBGRAAVX2, ConvertRGB24AVX2, ConvertGrey16SSE2, ConvertRedTo16SSE2, PremultiplyAlphaAVX2 });
+#else
+		supported.push_back(kScalarKernels);
+#endif
+		return supported;
+	}
+
+	// The widest set, chosen on first use
+	static const PixelKernels& GetKernels()
+	{
+		static const PixelKernels kernels{ GetSupportedKernels().back() };
+		return kernels;
+	}
+
+	// 32 bit texels to RGBA
+	void ConvertRGBA32(const unsigned char* source, unsigned char* dest, size_t count, ChannelOrder order)
+	{
+		if (order == ChannelOrder::RGB)
+			memcpy(dest, source, count * 4);
+		else
+			GetKernels().swizzleBGRA(source, dest, count);
+	}
+
+	// 24 bit texels to RGBA with alpha 255
+	void ConvertRGB24(const unsigned char* source, unsigned char* dest, size_t count, ChannelOrder order)
+	{
+		GetKernels().convertRGB24(source, dest, count, order);
+	}
+
+	// 16 bit grey to RGBA
+	void ConvertGrey16(const uint16_t* source, unsigned char* dest, size_t count)
+	{
+		GetKernels().convertGrey16(source, dest, count);
+	}
+
+	// The red of each RGBA texel to 16 bits
+	void ConvertRedTo16(const unsigned char* rgba, uint16_t* dest, size_t count)
+	{
+		GetKernels().convertRedTo16(rgba, dest, count);
+	}
+
+	// Scales each texel's colour by its alpha in place
+	void PremultiplyAlpha(unsigned char* rgba, size_t count)
+	{
+		GetKernels().premultiplyAlpha(rgba, count);
+	}
+
+	std::string GetPixelKernelName()
+	{
+		return GetKernels().name;
+	}
+
+	// Times each conversion with the scalar code and the kernels asked for, checking they agree
+	PixelConversionBenchmarkResult BenchmarkPixelConversion(int size, int iterations, const std::string& kernelSet)
+	{
+		PixelConversionBenchmarkResult result;
+		result.size = size;
+		result.kernels = GetPixelKernelName();
+		if (size <= 0 || iterations <= 0)
+			return result;
+
+		std::vector<PixelKernels> sets;
+		for (const PixelKernels& kernels : GetSupportedKernels())
+		{
+			if (kernelSet == "all" || kernels.name == (kernelSet.empty() ? result.kernels : kernelSet))
+				sets.push_back(kernels);
+		}
+
+		// Fixed seed so runs are comparable
+		const size_t count{ (size_t)size * size };
+		std::mt19937 random(1234);
+		std::uniform_int_distribution<int> noise(0, 255);
+		std::vector<unsigned char> source(count * 4);
+		for (unsigned char& byte : source)
+			byte = (unsigned char)noise(random);
+
+		std::vector<unsigned char> expected(count * 4);
+		std::vector<unsigned char> actual(count * 4);
+		for (const PixelKernels& kernels : sets)
+		{
+			const auto time{ [&](const std::string& name, auto&& scalar, auto&& kernel)
+			{
+				const auto milliseconds{ [&](auto&& convert)
+				{
+					const auto start{ std::chrono::high_resolution_clock::now() };
+					for (int i = 0; i < iterations; i++)
+						convert();
+					return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count() / iterations;
+				} };
+
+				PixelConversionBenchmarkResult::Entry entry;
+				entry.name = name;
+				entry.kernels = kernels.name;
+				entry.scalarMilliseconds = milliseconds(scalar);
+				entry.milliseconds = milliseconds(kernel);
+				entry.matches = expected == actual;
+				result.entries.push_back(entry);
+			} };
+
+			const uint16_t* grey{ (const uint16_t*)source.data() };
+			uint16_t* expected16{ (uint16_t*)expected.data() };
+			uint16_t* actual16{ (uint16_t*)actual.data() };
+
+			time("BGRA to RGBA",
+				[&]() { kScalarKernels.swizzleBGRA(source.data(), expected.data(), count); },
+				[&]() { kernels.swizzleBGRA(source.data(), actual.data(), count); });
+			time("BGR to RGBA",
+				[&]() { kScalarKernels.convertRGB24(source.data(), expected.data(), count, ChannelOrder::BGR); },
+				[&]() { kernels.convertRGB24(source.data(), actual.data(), count, ChannelOrder::BGR); });
+			time("RGB to RGBA",
+				[&]() { kScalarKernels.convertRGB24(source.data(), expected.data(), count, ChannelOrder::RGB); },
+				[&]() { kernels.convertRGB24(source.data(), actual.data(), count, ChannelOrder::RGB); });
+			time("Grey16 to RGBA",
+				[&]() { kScalarKernels.convertGrey16(grey, expected.data(), count); },
+				[&]() { kernels.convertGrey16(grey, actual.data(), count); });
+
+			// Half the buffers, the rest still agree from the conversion before
+			time("Red to R16",
+				[&]() { kScalarKernels.convertRedTo16(source.data(), expected16, count); },
+				[&]() { kernels.convertRedTo16(source.data(), actual16, count); });
+
+			// In place, so each run starts from a fresh copy of the source
+			time("Premultiply alpha",
+				[&]() { expected = source; kScalarKernels.premultiplyAlpha(expected.data(), count); },
+				[&]() { actual = source; kernels.premultiplyAlpha(actual.data(), count); });
+		}
+
+		return result;
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+// Converts decoded pixels to the 32 bit RGBA the rest of the helpers use
+
+#include "ExternalLibraryHeaders.h"
+
+namespace Helpers
+{
+	// Order of the colour bytes of a 24 or 32 bit texel in memory. Stock FreeImage builds on little endian machines
+	// store BGR, ours was rebuilt to store RGB.
+	enum class ChannelOrder
+	{
+		RGB,
+		BGR
+	};
+
+	// Each of these runs the kernel of the widest set the CPU supports, AVX2, SSSE3 or SSE2, chosen on first use.
+	// Not every conversion has a kernel in every set: 24 bit texels on an SSE2 only CPU run the plain C++ code, and the
+	// 16 bit conversions have an SSE2 kernel that the wider sets use too. Counts are texels.
+
+	// 32 bit texels to RGBA, swizzled from BGRA or copied as they are
+	void ConvertRGBA32(const unsigned char* source, unsigned char* dest, size_t count, ChannelOrder order);
+
+	// 24 bit texels to RGBA with alpha 255
+	void ConvertRGB24(const unsigned char* source, unsigned char* dest, size_t count, ChannelOrder order);
+
+	// 16 bit grey to RGBA, the top 8 bits in each colour channel and alpha 255
+	void ConvertGrey16(const uint16_t* source, unsigned char* dest, size_t count);
+
+	// The red of each RGBA texel to 16 bits (x 257, so 255 is 65535), for R16 images made from 8 bit ones
+	void ConvertRedTo16(const unsigned char* rgba, uint16_t* dest, size_t count);
+
+	// Scales each texel's colour by its alpha in place, rounded to nearest
+	void PremultiplyAlpha(unsigned char* rgba, size_t count);
+
+	// The kernels chosen for this CPU
+	std::string GetPixelKernelName();
+
+	struct PixelConversionBenchmarkResult
+	{
+		int size{ 0 };
+
+		// The set chosen for this CPU
+		std::string kernels;
+
+		// Scalar then a set's kernels, per image, and whether they gave exactly what the scalar code does
+		struct Entry
+		{
+			std::string name;
+			std::string kernels;
+			double scalarMilliseconds{ 0 };
+			double milliseconds{ 0 };
+			bool matches{ false };
+		};
+		std::vector<Entry> entries;
+
+		bool Passed() const {
+			return !entries.empty() && std::all_of(entries.begin(), entries.end(), [](const Entry& entry) { return entry.matches; });
+		}
+
+		std::string ToString() const {
+			std::string result{ "Pixel conversion " + std::to_string(size) + "x" + std::to_string(size) + ", " + kernels + " chosen" };
+			for (const Entry& entry : entries)
+				result += "\n" + entry.kernels + " " + entry.name + ": scalar " + std::to_string(entry.scalarMilliseconds) + " ms, " +
+					std::to_string(entry.milliseconds) + " ms" + (entry.matches ? "" : " DIFFERS");
+			return result + (Passed() ? "\nPASS" : "\nFAIL");
+		}
+	};
+
+	// Times each conversion of a size x size image with the scalar code and with a set of kernels, checking they agree.
+	// kernelSet names one set ("SSE2", "SSSE3" or "AVX2"), is "all" for every set the CPU supports, or empty for the set
+	// chosen for it. A set the CPU cannot run gives no entries, which fails.
+	PixelConversionBenchmarkResult BenchmarkPixelConversion(int size = 2048, int iterations = 20, const std::string& kernelSet = "all");
+}
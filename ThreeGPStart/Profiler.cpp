@@ -0,0 +1,58 @@
+#include "Profiler.h"
+
+#include <algorithm>
+
+namespace Helpers
+{
+	// The program wide profiler
+	Profiler& Profiler::Get()
+	{
+		static Profiler profiler;
+		return profiler;
+	}
+
+	// Adds a sample, safe from any thread
+	void Profiler::Record(const std::string& name, double seconds)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		Entry& entry{ m_entries[name] };
+		entry.count++;
+		entry.totalSeconds += seconds;
+		entry.maxSeconds = std::max(entry.maxSeconds, seconds);
+	}
+
+	// Copy of the entries, by name
+	std::map<std::string, Profiler::Entry> Profiler::GetEntries() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_entries;
+	}
+
+	void Profiler::Clear()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_entries.clear();
+	}
+
+	// Entries whose names start with prefix, slowest total first
+	std::string Profiler::ToString(const std::string& prefix) const
+	{
+		std::vector<std::pair<std::string, Entry>> sorted;
+		for (const auto& entry : GetEntries())
+			if (entry.first.compare(0, prefix.size(), prefix) == 0)
+				sorted.push_back(entry);
+
+		std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second.totalSeconds > b.second.totalSeconds; });
+
+		std::string result;
+		for (const auto& entry : sorted)
+		{
+			result += entry.first + ": " + std::to_string(entry.second.totalSeconds * 1000.0) + " ms";
+			if (entry.second.count > 1)
+				result += " (" + std::to_string(entry.second.count) + " samples, max " + std::to_string(entry.second.maxSeconds * 1000.0) + " ms)";
+			result += "\n";
+		}
+
+		return result;
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+// Collects named timings from anywhere in the program, on any thread
+
+#include "ExternalLibraryHeaders.h"
+
+#include <chrono>
+#include <mutex>
+
+namespace Helpers
+{
+	// Samples recorded under the same name are combined into one entry
+	class Profiler
+	{
+	public:
+		struct Entry
+		{
+			size_t count{ 0 };
+			double totalSeconds{ 0 };
+			double maxSeconds{ 0 };
+		};
+
+		// The program wide profiler
+		static Profiler& Get();
+
+		// Adds a sample, safe from any thread
+		void Record(const std::string& name, double seconds);
+
+		// Copy of the entries, by name
+		std::map<std::string, Entry> GetEntries() const;
+
+		void Clear();
+
+		// Entries whose names start with prefix, slowest total first
+		std::string ToString(const std::string& prefix = "") const;
+
+	private:
+		mutable std::mutex m_mutex;
+		std::map<std::string, Entry> m_entries;
+	};
+
+	// Records the time from construction to destruction with the profiler
+	class ScopedTimer
+	{
+	public:
+		explicit ScopedTimer(std::string name) : m_name(std::move(name)), m_start(std::chrono::high_resolution_clock::now()) {}
+		~ScopedTimer() {
+			Profiler::Get().Record(m_name, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - m_start).count());
+		}
+
+		ScopedTimer(const ScopedTimer&) = delete;
+		ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+	private:
+		std::string m_name;
+		std::chrono::high_resolution_clock::time_point m_start;
+	};
+}
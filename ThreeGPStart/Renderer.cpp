@@ -1,6 +1,31 @@
 #include "Renderer.h"
 #include "Camera.h"
 #include "ImageLoader.h"
+#include "MeshOptimiser.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+	//Request for a material's texture, which is named relative to the model file. Exporters often write absolute paths
+	//from another machine so the bare name in the textures folder is the fallback.
+	Helpers::ImageRequest MaterialTextureRequest(const std::string& modelFilename, const std::string& textureFilename)
+	{
+		if (textureFilename.empty())
+			return Helpers::ImageRequest();
+
+		const size_t modelSlash = modelFilename.find_last_of("/\\");
+		const std::string modelDirectory = modelSlash == std::string::npos ? std::string() : modelFilename.substr(0, modelSlash + 1);
+		const size_t textureSlash = textureFilename.find_last_of("/\\");
+		const std::string bareName = textureSlash == std::string::npos ? textureFilename : textureFilename.substr(textureSlash + 1);
+
+		return Helpers::ImageRequest{ modelDirectory + textureFilename, "Data/Textures/" + bareName };
+	}
+}
 
 Renderer::Renderer() 
 {
@@ -10,10 +35,24 @@ Renderer::Renderer()
 // On exit must clean up any OpenGL resources e.g. the program, the buffers
 Renderer::~Renderer()
 {
+	//Loads still running would queue uploads into a destroyed renderer
+	for (auto& load : m_modelLoads)
+		if (load.valid())
+			load.wait();
+
 	// TODO: clean up any memory used including OpenGL objects via glDelete* calls
 	glDeleteProgram(m_cubeProgram);
 	glDeleteProgram(m_skyProgram);
 	glDeleteProgram(m_program);
+
+	//Drops the materials' texture handles while the cache is still alive
+	m_materials.clear();
+	glDeleteBuffers(1, &m_materialUBO);
+
+	glDeleteTextures(1, &m_skyCubemap);
+	glDeleteVertexArrays(1, &m_skyVAO);
+	glDeleteBuffers(1, &m_skyVBO);
+	glDeleteBuffers(1, &m_skyEBO);
 }
 
 // Use IMGUI for a simple on screen GUI
@@ -28,6 +67,49 @@ void Renderer::DefineGUI()
 
 	ImGui::Checkbox("Wireframe", &m_wireframe);	// A checkbox linked to a member variable
 
+	ImGui::SliderFloat("LOD full detail (px)", &m_lodFullDetailPixels, 50.0f, 2000.0f);
+	ImGui::Text("Triangles drawn %zu", m_trianglesDrawn);
+	ImGui::Text("Terrain optimise %s", m_terrainOptimise.c_str());
+
+	ImGui::Checkbox("Meshlet culling", &m_meshletCulling);
+	ImGui::Text("Meshlets visible %zu / %zu (%.1f us)", m_meshletsVisible, m_meshletsTotal, m_meshletCullMicroseconds);
+
+	ImGui::SliderFloat("Upload budget (ms)", &m_uploadBudgetMilliseconds, 0.1f, 16.0f);
+	if (m_uploadQueue.Pending())
+		ImGui::Text("Uploads pending %zu", m_uploadQueue.Pending());
+
+	ImGui::Text("Shared geometry %zu (%zu reused)", m_geometryCache.size(), m_geometryCacheHits);
+	ImGui::TextUnformatted(m_geometryPool.ToString().c_str());
+	ImGui::Text("Materials %zu, textures %zu (%.1f MB, %.0f%% hits)", m_materials.size(), m_textureCache.GetResidentCount(),
+		m_textureCache.GetResidentBytes() / (1024.0f * 1024.0f), m_textureCache.GetHitRate() * 100.0f);
+	if (ImGui::SliderInt("Texture budget (MB)", &m_textureBudgetMegabytes, 16, 2048))
+		m_textureCache.SetStreamingBudget((size_t)m_textureBudgetMegabytes * 1024 * 1024);
+	ImGui::Text("Streamed textures %zu (%zu sharpening)", m_textureCache.GetStreamedCount(), m_textureCache.GetStreamingPendingCount());
+	ImGui::Text("Program binds %zu, vertex array binds %zu, material binds %zu, texture binds %zu", m_programBinds, m_vertexArrayBinds,
+		m_materialBinds, m_textureBinds);
+	ImGui::Text("Atlas layers %d, textures %zu (%.0f%% full)", m_textureAtlas.NumLayers(), m_textureAtlas.NumEntries(),
+		m_textureAtlas.GetOccupancy() * 100.0f);
+
+	if (ImGui::Button("Screenshot"))
+		m_frameCapture.RequestScreenshot("Captures/Screenshot_" + std::to_string(m_frameCapture.GetFrame()));
+	ImGui::SameLine();
+	bool capturing = m_frameCapture.IsCapturingSequence();
+	if (ImGui::Checkbox("Capture sequence", &capturing))
+	{
+		if (capturing)
+			CaptureFrames("Captures/Frame", (unsigned int)m_captureInterval);
+		else
+			m_frameCapture.StopSequence();
+	}
+	ImGui::SliderInt("Capture every (frames)", &m_captureInterval, 1, 120);
+	ImGui::TextUnformatted(m_frameCapture.ToString().c_str());
+
+	if (!m_skinnedMeshes.empty())
+		ImGui::Text("Skinned verts %zu (%.2f ms)", m_skinnedVertices, m_skinningMilliseconds);
+
+	if (ImGui::CollapsingHeader("Profiler"))
+		ImGui::TextUnformatted(Helpers::Profiler::Get().ToString().c_str());
+
 	ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
 		
 	ImGui::End();
@@ -73,218 +155,46 @@ bool Renderer::InitialiseGeometry()
 	//Create a new program to handle specific vertex and fragment shaders
 	m_skyProgram = CreateProgram("Data/Shaders/sky_vertex_shader.vert", "Data/Shaders/sky_fragment_shader.frag");
 
-	//Loads in the model required using the file location
-	Helpers::ModelLoader loadSkybox;
-	if (!loadSkybox.LoadFromFile("Data/Models/Sky/Mars/skybox.X"))
-	{
-		//Checks for a fail load, cout to determine what load is having issues
-		std::cout << "Failed to Load Skybox Model" << std::endl;
-		return false;
-	}
-
-	//Loads in the texture required using the file location
-	Helpers::ImageLoader loadSkyUp;
-	if (!loadSkyUp.Load("Data/Models/Sky/Mars/Mar_U.dds"))
-	{
-		//Loads an error texture in place when original texture fails to load
-		if (!loadSkyUp.Load("Data/Textures/ErrorTexture.png"))
-		{
-			std::cout << "Failed to Load Skybox Texture - Up" << std::endl;
-			return false;
-		}
-	}
-
-	Helpers::ImageLoader loadSkyDown;
-	if (!loadSkyDown.Load("Data/Models/Sky/Mars/Mar_D.dds"))
-	{
-		if (!loadSkyDown.Load("Data/Textures/ErrorTexture.png"))
-		{
-			std::cout << "Failed to Load Skybox Texture - Down" << std::endl;
-			return false;
-		}
-	}
-
-	Helpers::ImageLoader loadSkyLeft;
-	if (!loadSkyLeft.Load("Data/Models/Sky/Mars/Mar_L.dds"))
-	{
-		if (!loadSkyLeft.Load("Data/Textures/ErrorTexture.png"))
-		{
-			std::cout << "Failed to Load Skybox Texture - Left" << std::endl;
-			return false;
-		}
-	}
-
-	Helpers::ImageLoader loadSkyRight;
-	if (!loadSkyRight.Load("Data/Models/Sky/Mars/Mar_R.dds"))
+	//Every image the scene starts with is decoded at once across the thread pool rather than one after another here,
+	//an error texture standing in for any that fail
+	enum StartupImage { kError, kTerrain, kHeightmap };
+	const std::string errorTexture = "Data/Textures/ErrorTexture.png";
+	const std::vector<Helpers::ImageRequest> startupRequests =
 	{
-		if (!loadSkyRight.Load("Data/Textures/ErrorTexture.png"))
-		{
-			std::cout << "Failed to Load Skybox Texture - Right" << std::endl;
-			return false;
-		}
-	}
+		{ errorTexture, "" },
+		{ "Data/Textures/Terrain_Sand.jpg", errorTexture },
+		{ "Data\\Heightmaps\\TerrainHeightmap.jpg", "" }
+	};
 
-	Helpers::ImageLoader loadSkyFront;
-	if (!loadSkyFront.Load("Data/Models/Sky/Mars/Mar_F.dds"))
+	std::vector<Helpers::ImageLoader> startupImages;
+	std::vector<std::string> startupPaths;
 	{
-		if (!loadSkyFront.Load("Data/Textures/ErrorTexture.png"))
-		{
-			std::cout << "Failed to Load Skybox Texture - Front" << std::endl;
-			return false;
-		}
+		Helpers::ScopedTimer decodeTimer("Startup image decode");
+		Helpers::LoadImages(startupRequests, startupImages, startupPaths);
 	}
 
-	Helpers::ImageLoader loadSkyBack;
-	if (!loadSkyBack.Load("Data/Models/Sky/Mars/Mar_B.dds"))
+	for (size_t i = 0; i < startupRequests.size(); i++)
 	{
-		if (!loadSkyBack.Load("Data/Textures/ErrorTexture.png"))
+		if (startupPaths[i].empty())
 		{
-			std::cout << "Failed to Load Skybox Texture - Back" << std::endl;
+			std::cout << "Failed to Load " << startupRequests[i].path << std::endl;
 			return false;
 		}
 	}
 
-	//Create an instance using a struct and name it (for later use)
-	Model Skybox;
-	Skybox.modelName = "Skybox";
-
-	//Create a counter to handle each mesh for the skybox model
-	int skyMeshTxtr = 0;
-
-	//A loop that goes through each mesh in the skybox
-	for (const Helpers::Mesh& meshSky : loadSkybox.GetMeshVector())
+	//The sky's faces are DDS files, mapped and uploaded as the DXT1 blocks they hold rather than decoded through FreeImage.
+	//In cubemap face order, +X, -X, +Y, -Y, +Z then -Z. The faces were made for a left handed space where the front is +Z,
+	//the sky's fragment shader flips z to match.
+	const std::string skyFaceFiles[6] =
 	{
-		//Create an instance using a struct
-		Mesh skyboxMesh;
-
-		//Creates the texture VBO - vertex buffer object
-		GLuint skyTxtrVBO;
-		glGenBuffers(1, &skyTxtrVBO);
-		glBindBuffer(GL_ARRAY_BUFFER, skyTxtrVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec2) * meshSky.uvCoords.size(), meshSky.uvCoords.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-		//Sets a specific texture based on what counter number each mesh is to have a complete skybox
-		if (skyMeshTxtr == 0)
-		{
-			//Creates the texture using a pre-loaded texture and applies it to the mesh
-			glGenTextures(1, &skyboxMesh.txtr);
-			glBindTexture(GL_TEXTURE_2D, skyboxMesh.txtr);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, loadSkyDown.Width(), loadSkyDown.Height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, loadSkyDown.GetData());
-			glGenerateMipmap(GL_TEXTURE_2D);
-		}
-		else if (skyMeshTxtr == 1)
-		{
-			glGenTextures(1, &skyboxMesh.txtr);
-			glBindTexture(GL_TEXTURE_2D, skyboxMesh.txtr);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, loadSkyRight.Width(), loadSkyRight.Height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, loadSkyRight.GetData());
-			glGenerateMipmap(GL_TEXTURE_2D);
-		}
-		else if (skyMeshTxtr == 2)
-		{
-			glGenTextures(1, &skyboxMesh.txtr);
-			glBindTexture(GL_TEXTURE_2D, skyboxMesh.txtr);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, loadSkyFront.Width(), loadSkyFront.Height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, loadSkyFront.GetData());
-			glGenerateMipmap(GL_TEXTURE_2D);
-		}
-		else if (skyMeshTxtr == 3)
-		{
-			glGenTextures(1, &skyboxMesh.txtr);
-			glBindTexture(GL_TEXTURE_2D, skyboxMesh.txtr);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, loadSkyUp.Width(), loadSkyUp.Height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, loadSkyUp.GetData());
-			glGenerateMipmap(GL_TEXTURE_2D);
-		}
-		else if (skyMeshTxtr == 4)
-		{
-			glGenTextures(1, &skyboxMesh.txtr);
-			glBindTexture(GL_TEXTURE_2D, skyboxMesh.txtr);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, loadSkyLeft.Width(), loadSkyLeft.Height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, loadSkyLeft.GetData());
-			glGenerateMipmap(GL_TEXTURE_2D);
-		}
-		else if (skyMeshTxtr == 5)
-		{
-			glGenTextures(1, &skyboxMesh.txtr);
-			glBindTexture(GL_TEXTURE_2D, skyboxMesh.txtr);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, loadSkyBack.Width(), loadSkyBack.Height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, loadSkyBack.GetData());
-			glGenerateMipmap(GL_TEXTURE_2D);
-		}
-		//Adds 1 to my mesh counter
-		skyMeshTxtr++;
-
-		//Creates the normals VBO - vertex buffer object
-		GLuint skyNormVBO;
-		glGenBuffers(1, &skyNormVBO);
-		glBindBuffer(GL_ARRAY_BUFFER, skyNormVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * meshSky.normals.size(), meshSky.normals.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-		////Creates the position VBO - vertex buffer object
-		GLuint skyPosVBO;
-		glGenBuffers(1, &skyPosVBO);
-		glBindBuffer(GL_ARRAY_BUFFER, skyPosVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * meshSky.vertices.size(), meshSky.vertices.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-		////Creates the Elements EBO - Element Buffer Object
-		GLuint skyElemEBO;
-		glGenBuffers(1, &skyElemEBO);
-		glBindBuffer(GL_ARRAY_BUFFER, skyElemEBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(GLuint) * meshSky.elements.size(), meshSky.elements.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-		//Sets the number of elements using the mesh size
-		skyboxMesh.numElements = meshSky.elements.size();
-
-		//sets the VAO to wrap everything together to allow it to render
-		glGenVertexArrays(1, &skyboxMesh.vao);
-		glBindVertexArray(skyboxMesh.vao);
-
-		glBindBuffer(GL_ARRAY_BUFFER, skyPosVBO);
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-
-		glBindBuffer(GL_ARRAY_BUFFER, skyNormVBO);
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-
-		glBindBuffer(GL_ARRAY_BUFFER, skyTxtrVBO);
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
-
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, skyElemEBO);
-
-		//Always reset the bind to prevent issues
-		glBindVertexArray(0);
-
-		//Pushes the mesh into the mesh vector
-		Skybox.meshVector.push_back(skyboxMesh);
-	}
-	//Pushes the model into the model vector, which now also holds the mesh vector data
-	modelVector.push_back(Skybox);
+		"Data/Models/Sky/Mars/Mar_R.dds",
+		"Data/Models/Sky/Mars/Mar_L.dds",
+		"Data/Models/Sky/Mars/Mar_U.dds",
+		"Data/Models/Sky/Mars/Mar_D.dds",
+		"Data/Models/Sky/Mars/Mar_B.dds",
+		"Data/Models/Sky/Mars/Mar_F.dds"
+	};
+	CreateSkybox(skyFaceFiles, startupImages[kError]);
 
 //--CUBE------------------------------------------------------------------------------------------------------------------//
 	m_cubeProgram = CreateProgram("Data/Shaders/cube_vertex_shader.vert", "Data/Shaders/cube_fragment_shader.frag");
@@ -473,6 +383,7 @@ bool Renderer::InitialiseGeometry()
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
 	//Creating a VAO to wrap all the information gathered, and draw the cube
+	//Its colours make it a vertex format of its own, so it keeps its own array rather than joining the geometry pool
 	glGenVertexArrays(1, &CubeMesh.vao);
 	glBindVertexArray(CubeMesh.vao);
 
@@ -493,34 +404,25 @@ bool Renderer::InitialiseGeometry()
 
 //--TERRAIN-------------------------------------------------------------------------------------------------------------------------------------//
 	m_program = CreateProgram("Data/Shaders/vertex_shader.vert", "Data/Shaders/fragment_shader.frag");
+
+	//Materials bind their record of the material buffer to binding 0
+	glUniformBlockBinding(m_program, glGetUniformBlockIndex(m_program, "Material"), 0);
 	
 	Model Terrain;
 	Terrain.modelName = "Terrain";
 	Mesh TerrainMesh;
 
-	Helpers::ImageLoader loadTerrain;
-	if (!loadTerrain.Load("Data/Textures/Terrain_Sand.jpg"))
-	{
-		if (!loadTerrain.Load("Data/Textures/ErrorTexture.png"))
-		{
-			std::cout << "Failed to Load Terrain Texture" << std::endl;
-			return false;
-		}
-	}
-
-	Helpers::ImageLoader loadHeightMap;
-	if (!loadHeightMap.Load("Data\\Heightmaps\\TerrainHeightmap.jpg"))
-	{
-		std::cout << "Failed to Load Terrain Heightmap" << std::endl;
-		return false;
-	}
+	const Helpers::ImageLoader& loadTerrain = startupImages[kTerrain];
+	const std::string& terrainTexture = startupPaths[kTerrain];
+	const Helpers::ImageLoader& loadHeightMap = startupImages[kHeightmap];
 
-	//Create vectors to handle specific items required for terrain generation
-	std::vector<glm::vec3> colours;
-	std::vector<glm::vec3> verts;
-	std::vector<GLuint> terrainElem;
-	std::vector<glm::vec2> uvCoords;
-	std::vector<glm::vec3> normals;
+	//Create a mesh to hold the generated terrain so it can go through the same optimiser as loaded models
+	Helpers::Mesh terrainGen;
+	terrainGen.name = "Terrain";
+	std::vector<glm::vec3>& verts = terrainGen.vertices;
+	std::vector<GLuint>& terrainElem = terrainGen.elements;
+	std::vector<glm::vec2>& uvCoords = terrainGen.uvCoords;
+	std::vector<glm::vec3>& normals = terrainGen.normals;
 
 	//Sets the number of squares, this can be edited for a bigger or smaller terrain space
 	int numSquaresX = 200;
@@ -528,8 +430,6 @@ bool Renderer::InitialiseGeometry()
 	//Sets the number of verts to the number of squares + 1 - this allows us to easily edit the terrain size
 	int numVertsX = numSquaresX + 1;
 	int numVertsZ = numSquaresZ + 1;
-	float imageX = 0;
-	float imageZ = 0;
 
 	//Loops through the number of vertices on the x-axis
 	for (int i = 0; i < numVertsX; i++)
@@ -539,32 +439,28 @@ bool Renderer::InitialiseGeometry()
 		{
 			//Pushes all the necessary information into the correct vectors
 			verts.push_back(glm::vec3(i * 8, 0, j * 8));
-			colours.push_back(glm::vec3(0.5, 0, 0.8));
 			uvCoords.push_back(glm::vec2((j / (float)numSquaresX), (i / (float)numSquaresZ)));
 			normals.push_back(glm::vec3(0, 0, 0));
 		}
 	}
 
-	//Checking the values of the Heightmap to arrange the y values of the vertices based on the heightmap coplour/shade
-	float vertXtoImage = (float)loadHeightMap.Width() / numVertsX;
-	float vertZtoImage = (float)loadHeightMap.Height() / numVertsZ;
-
-	GLbyte* imageData = (GLbyte*)loadHeightMap.GetData();
-
+	//Checking the values of the Heightmap to arrange the y values of the vertices based on the heightmap coplour/shade.
+	//Every vertex is looked up in one batch, filtered so the slopes are smooth rather than stepped texel to texel.
+	std::vector<glm::vec2> heightUVs;
+	heightUVs.reserve(verts.size());
 	for (int z = 0; z < numVertsZ; z++)
 	{
-		imageZ = vertZtoImage * z;
-
 		for (int x = 0; x < numVertsX; x++)
-		{
-			imageX = vertXtoImage * x;
-			size_t offset = ((size_t)imageX + (size_t)imageZ * loadHeightMap.Width()) * 4;
-			BYTE height = imageData[offset];
-			int myvec = (z * numVertsX) + x;
-			verts[myvec].y = (float)height / 3;
-		}
+			heightUVs.push_back(glm::vec2((float)x / numVertsX, (float)z / numVertsZ));
 	}
 
+	std::vector<float> heights(heightUVs.size());
+	loadHeightMap.SampleGrey(heightUVs.data(), heightUVs.size(), heights.data(),
+		Helpers::SamplerSettings{ Helpers::SampleFilter::Bilinear, Helpers::SampleWrap::Clamp });
+
+	for (size_t myvec = 0; myvec < heights.size(); myvec++)
+		verts[myvec].y = heights[myvec] / 3;
+
 	//Create a toggle to create a diamond pattern for the generation of terrain vertices
 	bool diamondToggle = true;
 
@@ -620,155 +516,565 @@ bool Renderer::InitialiseGeometry()
 		normals[n] = glm::normalize(normals[n]);
 	}
 
-	GLuint terrainTxtrVBO;
-	glGenBuffers(1, &terrainTxtrVBO);
-	glBindBuffer(GL_ARRAY_BUFFER, terrainTxtrVBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec2) * uvCoords.size(), uvCoords.data(), GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	//Reorders the generated grid for the vertex cache, overdraw and vertex fetch
+	m_terrainOptimise = Helpers::OptimiseMesh(terrainGen).ToString();
+	terrainGen.UpdateBounds();
+	TerrainMesh.boundsCentre = terrainGen.bounds.centre;
+	TerrainMesh.boundsRadius = terrainGen.bounds.radius;
 
-	glGenTextures(1, &TerrainMesh.txtr);
-	glBindTexture(GL_TEXTURE_2D, TerrainMesh.txtr);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, loadTerrain.Width(), loadTerrain.Height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, loadTerrain.GetData());
-	glGenerateMipmap(GL_TEXTURE_2D);
-
-	GLuint terrainNormVBO;
-	glGenBuffers(1, &terrainNormVBO);
-	glBindBuffer(GL_ARRAY_BUFFER, terrainNormVBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * normals.size(), normals.data(), GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	//Splits the terrain into meshlets so only the parts in view and facing the camera are drawn
+	TerrainMesh.meshlets = Helpers::BuildMeshlets(terrainGen);
 
-	GLuint terrainPosVBO;
-	glGenBuffers(1, &terrainPosVBO);
-	glBindBuffer(GL_ARRAY_BUFFER, terrainPosVBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * verts.size(), verts.data(), GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	//The terrain is drawn with a plain white material carrying its texture
+	TerrainMesh.material = GetMaterial(Helpers::Material(), m_textureCache.Get(terrainTexture, loadTerrain));
 
-	GLuint terrainColVBO;
-	glGenBuffers(1, &terrainColVBO);
-	glBindBuffer(GL_ARRAY_BUFFER, terrainColVBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * colours.size(), colours.data(), GL_STATIC_DRAW);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	//The meshlet ordered elements hold the same triangles so also serve for drawing it all
+	const std::vector<GLuint>& meshletElements = TerrainMesh.meshlets.elements;
+	const Helpers::GeometryRange terrainRange = m_geometryPool.Add(verts.data(), normals.data(), uvCoords.data(), verts.size(),
+		meshletElements.data(), meshletElements.size());
 
-	TerrainMesh.numElements = terrainElem.size();
+	TerrainMesh.vao = m_geometryPool.GetVertexArray();
+	TerrainMesh.numElements = terrainRange.numElements;
+	TerrainMesh.baseVertex = terrainRange.baseVertex;
+	TerrainMesh.firstElement = terrainRange.firstElement;
 
-	GLuint terrainElemEBO;
-	glGenBuffers(1, &terrainElemEBO);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, terrainElemEBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * terrainElem.size(), terrainElem.data(), GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	Terrain.meshVector.push_back(TerrainMesh);
+	modelVector.push_back(Terrain);
 
-	glGenVertexArrays(1, &TerrainMesh.vao);
-	glBindVertexArray(TerrainMesh.vao);
+//--Model--------------------------------------------------------------------------------------------------------------------------------------//
 
-	glBindBuffer(GL_ARRAY_BUFFER, terrainPosVBO);
-	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	//The jeep loads on a worker thread so the first frame can draw straight away. The worker queues one upload per mesh
+	//which Render runs on this thread, a few each frame, filling the model in as they arrive
+	Model Jeep;
+	Jeep.modelName = "Jeep";
+	const size_t jeepIndex = modelVector.size();
+	modelVector.push_back(Jeep);
 
-	glBindBuffer(GL_ARRAY_BUFFER, terrainNormVBO);
-	glEnableVertexAttribArray(1);
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	m_modelLoads.push_back(Helpers::ModelLoader::LoadFromFileAsync("Data/Models/jeep.obj",
+		[this, jeepIndex](std::shared_ptr<Helpers::ModelLoader> loadModel)
+	{
+		if (!loadModel)
+		{
+			std::cout << "Failed to Load Jeep Model" << std::endl;
+			return;
+		}
 
-	glBindBuffer(GL_ARRAY_BUFFER, terrainTxtrVBO);
-	glEnableVertexAttribArray(2);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+		//Each different texture the materials name is decoded once, all at once across the pool. Materials without one
+		//(or whose file is missing) use the jeep's paint, decoded as the last request.
+		const std::vector<Helpers::Material>& modelMaterials = loadModel->GetMaterialVector();
+		std::vector<Helpers::ImageRequest> requests;
+		std::map<std::string, size_t> requestIndices;
+		std::vector<size_t> materialImages;
+		for (const Helpers::Material& material : modelMaterials)
+		{
+			auto found = requestIndices.find(material.diffuseTextureFilename);
+			if (found == requestIndices.end())
+			{
+				found = requestIndices.insert({ material.diffuseTextureFilename, requests.size() }).first;
+				requests.push_back(MaterialTextureRequest("Data/Models/jeep.obj", material.diffuseTextureFilename));
+			}
+			materialImages.push_back(found->second);
+		}
+		const size_t defaultImage = requests.size();
+		requests.push_back(Helpers::ImageRequest{ "Data/Textures/jeep_army.jpg", "" });
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, terrainElemEBO);
+		std::shared_ptr<std::vector<Helpers::ImageLoader>> images = std::make_shared<std::vector<Helpers::ImageLoader>>();
+		std::vector<std::string> imagePaths;
+		Helpers::LoadImages(requests, *images, imagePaths);
+		if (imagePaths[defaultImage].empty())
+		{
+			std::cout << "Failed to Load Jeep Texture" << std::endl;
+			return;
+		}
 
-	glBindVertexArray(0);
+		for (size_t& image : materialImages)
+		{
+			if (imagePaths[image].empty())
+				image = defaultImage;
+		}
 
-	Terrain.meshVector.push_back(TerrainMesh);
-	modelVector.push_back(Terrain);
+		//Mips are built and block compressed here as well so the main thread only has to upload them, except for
+		//textures small enough for the atlas which keeps its own mips
+		std::vector<Helpers::PreparedTexture> prepared(images->size());
+		for (size_t image = 0; image < images->size(); image++)
+		{
+			const Helpers::ImageLoader& decoded = (*images)[image];
+			if (!imagePaths[image].empty() && !m_textureAtlas.Accepts(decoded.Width(), decoded.Height()))
+				prepared[image] = m_textureCache.Prepare(decoded);
+		}
 
-//--Model--------------------------------------------------------------------------------------------------------------------------------------//
+		//Materials are created before any mesh that uses them, the queue runs jobs in the order pushed
+		std::shared_ptr<std::vector<int>> materials = std::make_shared<std::vector<int>>();
+		m_uploadQueue.Push([this, loadModel, images, imagePaths, prepared, materialImages, materials]()
+		{
+			//Small textures are packed into the atlas together, the rest are textures of their own
+			std::vector<Helpers::TextureAtlas::Request> atlasRequests;
+			for (size_t image = 0; image < images->size(); image++)
+				atlasRequests.push_back({ Helpers::TextureCache::CanonicalPath(imagePaths[image]), &(*images)[image] });
+			const std::vector<Helpers::AtlasEntry> atlasEntries = m_textureAtlas.Add(atlasRequests);
+
+			for (size_t m = 0; m < materialImages.size(); m++)
+			{
+				const size_t image = materialImages[m];
+				Helpers::TextureHandle texture;
+				if (!atlasEntries[image].IsValid())
+					texture = m_textureCache.Get(imagePaths[image], (*images)[image], prepared[image]);
+				materials->push_back(GetMaterial(loadModel->GetMaterialVector()[m], texture, atlasEntries[image]));
+			}
+			std::cout << m_textureCache.ToString() << std::endl;
+			std::cout << m_textureAtlas.ToString() << std::endl;
+			std::cout << Helpers::ImageBufferPool::Shared().ToString() << std::endl;
+		});
+
+		//Each mesh is drawn once for every node that uses it, FindInstances has already merged identical mesh in the file
+		const Helpers::NodeHierarchy& hierarchy = loadModel->GetHierarchy();
+		std::vector<std::vector<glm::mat4>> meshInstances(loadModel->GetMeshVector().size());
+		for (size_t node = 0; node < hierarchy.Size(); node++)
+		{
+			for (unsigned int m = 0; m < hierarchy.meshCount[node]; m++)
+				meshInstances[hierarchy.meshIndices[hierarchy.meshStart[node] + m]].push_back(hierarchy.worldTransforms[node]);
+		}
+
+		for (size_t i = 0; i < loadModel->GetMeshVector().size(); i++)
+		{
+			//Skinned mesh are already in the root's space
+			if (!loadModel->GetMeshVector()[i].bones.empty())
+				meshInstances[i].assign(1, glm::mat4(1));
+
+			m_uploadQueue.Push([this, jeepIndex, loadModel, materials, i, instances = meshInstances[i]]()
+			{
+				const Helpers::Mesh& source = loadModel->GetMeshVector()[i];
+				const int material = source.materialIndex < materials->size() ? (*materials)[source.materialIndex] : -1;
+				CreateModelMesh(modelVector[jeepIndex], source, material, instances);
+			});
+		}
+
+		//Skinned mesh need the skeleton and its animation
+		m_uploadQueue.Push([this, jeepIndex, loadModel]()
+		{
+			Model& model = modelVector[jeepIndex];
+			for (const Mesh& mesh : model.meshVector)
+			{
+				if (mesh.skinnedIndex >= 0)
+				{
+					model.hierarchy = loadModel->GetHierarchy();
+					model.animations = std::make_shared<const std::vector<Helpers::CompressedClip>>(loadModel->GetAnimations());
+					break;
+				}
+			}
+		});
+	}));
 
-	Helpers::ModelLoader loadModel;
-	if (!loadModel.LoadFromFile("Data/Models/jeep.obj"))
+	return true;
+}
+
+//Finds the pooled geometry for a loaded mesh by its content hash, adding it to the pool the first time the content is seen.
+//The same wheel or crate in many models (or many times in one) then uploads once.
+//needsPositions is false for skinned mesh, which only take uvs and elements from the pool.
+const GeometryBuffers& Renderer::GetGeometryBuffers(const Helpers::Mesh& source, bool needsPositions)
+{
+	//A hash match is only reused if the counts and bounds agree too, so a collision cannot draw another mesh's triangles
+	const auto matches = [&](const GeometryBuffers& cached)
 	{
-		std::cout << "Failed to Load Jeep Model" << std::endl;
-		return false;
+		if (cached.range.numVertices != source.vertices.size() || cached.numElements != source.elements.size() ||
+			cached.lods.size() != source.lods.size() + 1 || cached.boundsCentre != source.bounds.centre ||
+			cached.boundsRadius != source.bounds.radius || (needsPositions && !cached.hasPositions))
+			return false;
+		for (size_t i = 0; i < source.lods.size(); i++)
+			if (cached.lods[i + 1].numElements != source.lods[i].elements.size())
+				return false;
+		return true;
+	};
+
+	const auto candidates = m_geometryCache.equal_range(source.contentHash);
+	for (auto found = candidates.first; found != candidates.second; ++found)
+	{
+		if (matches(found->second))
+		{
+			m_geometryCacheHits++;
+			return found->second;
+		}
 	}
 
-	Helpers::ImageLoader loadModelTxtr;
-	if (!loadModelTxtr.Load("Data/Textures/jeep_army.jpg"))
+	GeometryBuffers& geometry = m_geometryCache.emplace(source.contentHash, GeometryBuffers())->second;
+	geometry.hasPositions = needsPositions;
+
+	//Packs every level of detail into the one element range, they all share the same vertices
+	std::vector<GLuint> lodElements(source.elements);
+	geometry.lods.push_back(LodRange{ 0, (GLuint)source.elements.size() });
+	for (const Helpers::MeshLod& lod : source.lods)
 	{
-		std::cout << "Failed to Load Jeep Texture" << std::endl;
-		return false;
+		geometry.lods.push_back(LodRange{ (GLuint)lodElements.size(), (GLuint)lod.elements.size() });
+		lodElements.insert(lodElements.end(), lod.elements.begin(), lod.elements.end());
 	}
 
-	Model Jeep;
-	Jeep.modelName = "Jeep";
+	//Attributes a mesh does not have for every vertex are left unset, as are skinned positions and normals
+	const size_t numVertices = source.vertices.size();
+	geometry.range = m_geometryPool.Add(needsPositions ? source.vertices.data() : nullptr,
+		needsPositions && source.normals.size() == numVertices ? source.normals.data() : nullptr,
+		source.uvCoords.size() == numVertices ? source.uvCoords.data() : nullptr,
+		numVertices, lodElements.data(), lodElements.size());
+
+	geometry.numElements = source.elements.size();
+
+	//Bounding sphere worked out at load, for choosing the level of detail
+	geometry.boundsCentre = source.bounds.centre;
+	geometry.boundsRadius = source.bounds.radius;
 
-	for (const Helpers::Mesh& meshJeep : loadModel.GetMeshVector())
+	return geometry;
+}
+
+//Finds a material with the same parameters and texture or adds a new one, writing its record into the material buffer.
+//Records are spaced to the uniform buffer offset alignment so each can be bound on its own with glBindBufferRange.
+int Renderer::GetMaterial(const Helpers::Material& material, const Helpers::TextureHandle& diffuseTexture,
+	const Helpers::AtlasEntry& atlasEntry)
+{
+	MaterialRecord record;
+	record.diffuseColour = material.diffuseColour;
+	record.ambientColour = material.ambientColour;
+	record.emissiveColour = material.emissiveColour;
+	record.specularColour = material.specularColour;
+	record.specularFactor = material.specularFactor;
+	if (atlasEntry.IsValid())
 	{
-		Mesh jeepMesh;
+		record.atlasRect = atlasEntry.rect;
+		record.atlasLayer = (float)atlasEntry.layer;
+	}
 
-		GLuint modelTxtrVBO;
-		glGenBuffers(1, &modelTxtrVBO);
-		glBindBuffer(GL_ARRAY_BUFFER, modelTxtrVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec2) * meshJeep.uvCoords.size(), meshJeep.uvCoords.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	for (size_t i = 0; i < m_materials.size(); i++)
+	{
+		if ((atlasEntry.IsValid() || m_materials[i].diffuseTexture == diffuseTexture) && std::memcmp(&m_materials[i].record, &record, sizeof(MaterialRecord)) == 0)
+			return (int)i;
+	}
 
-		glGenTextures(1, &jeepMesh.txtr);
-		glBindTexture(GL_TEXTURE_2D, jeepMesh.txtr);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, loadModelTxtr.Width(), loadModelTxtr.Height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, loadModelTxtr.GetData());
-		glGenerateMipmap(GL_TEXTURE_2D);
+	if (!m_materialUBO)
+	{
+		GLint alignment = 0;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		alignment = std::max(alignment, 1);
+		m_materialStride = (sizeof(MaterialRecord) + alignment - 1) / alignment * alignment;
+		glGenBuffers(1, &m_materialUBO);
+	}
 
-		GLuint modelNormVBO;
-		glGenBuffers(1, &modelNormVBO);
-		glBindBuffer(GL_ARRAY_BUFFER, modelNormVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * meshJeep.normals.size(), meshJeep.normals.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	m_materials.push_back(RenderMaterial{ atlasEntry.IsValid() ? nullptr : diffuseTexture, record });
 
-		GLuint modelPosVBO;
-		glGenBuffers(1, &modelPosVBO);
-		glBindBuffer(GL_ARRAY_BUFFER, modelPosVBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3)* meshJeep.vertices.size(), meshJeep.vertices.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	//Grow by doubling, uploading every record again, otherwise just write the new one
+	glBindBuffer(GL_UNIFORM_BUFFER, m_materialUBO);
+	if ((GLsizeiptr)m_materials.size() > m_materialCapacity)
+	{
+		m_materialCapacity = std::max<GLsizeiptr>(m_materialCapacity * 2, 16);
+		glBufferData(GL_UNIFORM_BUFFER, m_materialStride * m_materialCapacity, nullptr, GL_STATIC_DRAW);
+		for (size_t i = 0; i < m_materials.size(); i++)
+			glBufferSubData(GL_UNIFORM_BUFFER, m_materialStride * i, sizeof(MaterialRecord), &m_materials[i].record);
+	}
+	else
+	{
+		glBufferSubData(GL_UNIFORM_BUFFER, m_materialStride * (m_materials.size() - 1), sizeof(MaterialRecord), &record);
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
-		GLuint modelElemEBO;
-		glGenBuffers(1, &modelElemEBO);
-		glBindBuffer(GL_ARRAY_BUFFER, modelElemEBO);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(GLuint) * meshJeep.elements.size(), meshJeep.elements.data(), GL_STATIC_DRAW);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	return (int)m_materials.size() - 1;
+}
 
-		jeepMesh.numElements = meshJeep.elements.size();
+//Adds one loaded mesh to the pool and to the model, after any mesh with the same material. Main thread only.
+//Static mesh share their pooled geometry with any identical mesh already loaded, skinned mesh stream their own.
+void Renderer::CreateModelMesh(Model& model, const Helpers::Mesh& source, int material, const std::vector<glm::mat4>& instances)
+{
+	Mesh newMesh;
+	newMesh.material = material;
 
-		glGenVertexArrays(1, &jeepMesh.vao);
-		glBindVertexArray(jeepMesh.vao);
+	//Skinned mesh are deformed on the CPU every frame so their positions and normals stream rather than stay static
+	std::unique_ptr<SkinnedMesh> skinned;
+	if (!source.bones.empty())
+	{
+		skinned = std::make_unique<SkinnedMesh>();
+		skinned->source = source;
+		if (!skinned->stream.Create(sizeof(glm::vec3) * source.vertices.size() * 2))
+			skinned.reset();
+	}
 
-		glBindBuffer(GL_ARRAY_BUFFER, modelPosVBO);
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	//Skinned mesh still share uvs and elements, their positions and normals are not uploaded
+	const GeometryBuffers& geometry = GetGeometryBuffers(source, !skinned);
+	if (!geometry.range.IsValid())
+		return;
+	newMesh.numElements = geometry.numElements;
+	newMesh.firstElement = geometry.range.firstElement;
+	newMesh.lods = geometry.lods;
+	newMesh.boundsCentre = geometry.boundsCentre;
+	newMesh.boundsRadius = geometry.boundsRadius;
+
+	//Static mesh all draw from the pool's vertex array. Skinned mesh have one of their own reading positions and normals
+	//from the stream, which UpdateSkinning moves on each frame, so their pooled uvs are bound from their first vertex.
+	if (skinned)
+	{
+		skinned->geometry = geometry.range;
+		newMesh.vao = m_geometryPool.CreateVertexArray();
+		m_geometryPool.AttachTo(newMesh.vao, geometry.range);
+		glVertexArrayVertexBuffer(newMesh.vao, 0, skinned->stream.GetBuffer(), 0, sizeof(glm::vec3));
+		glVertexArrayVertexBuffer(newMesh.vao, 1, skinned->stream.GetBuffer(), sizeof(glm::vec3) * source.vertices.size(), sizeof(glm::vec3));
+	}
+	else
+	{
+		newMesh.vao = m_geometryPool.GetVertexArray();
+		newMesh.baseVertex = geometry.range.baseVertex;
+	}
+
+	//A mesh used by several nodes draws once, instanced, with a transform per node from the pool.
+	//Otherwise it draws the pool's identity instance.
+	const bool drawnOnceUntransformed = instances.size() == 1 && instances[0] == glm::mat4(1);
+	if (!instances.empty() && !drawnOnceUntransformed)
+		newMesh.instances = m_geometryPool.AddInstances(instances.data(), instances.size());
+
+	if (skinned)
+	{
+		newMesh.skinnedIndex = (int)m_skinnedMeshes.size();
+		m_skinnedMeshes.push_back(std::move(skinned));
+	}
+
+	//Keep the model's mesh grouped by material
+	auto position = std::upper_bound(model.meshVector.begin(), model.meshVector.end(), newMesh,
+		[](const Mesh& a, const Mesh& b) { return a.material < b.material; });
+	model.meshVector.insert(position, newMesh);
+}
 
-		glBindBuffer(GL_ARRAY_BUFFER, modelNormVBO);
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+//Picks the level of detail for a mesh drawn with model_xform from the size of its bounding sphere on screen
+//projectionScale converts a radius over distance into pixels. Mesh the camera is inside, or without bounds, fill the screen.
+float Renderer::ScreenDiameter(const Mesh& mesh, const glm::mat4& model_xform, const glm::vec3& cameraPos, float projectionScale) const
+{
+	if (mesh.boundsRadius <= 0)
+		return std::numeric_limits<float>::max();
+
+	//Move the sphere into the world, the radius grows with the largest scale on any axis
+	const glm::vec3 worldCentre = glm::vec3(model_xform * glm::vec4(mesh.boundsCentre, 1.0f));
+	const float maxScale = std::max({ glm::length(glm::vec3(model_xform[0])), glm::length(glm::vec3(model_xform[1])), glm::length(glm::vec3(model_xform[2])) });
+	const float worldRadius = mesh.boundsRadius * maxScale;
 
-		glBindBuffer(GL_ARRAY_BUFFER, modelTxtrVBO);
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	const float distance = glm::length(worldCentre - cameraPos);
+	if (distance <= worldRadius)
+		return std::numeric_limits<float>::max();
 
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, modelElemEBO);
+	return 2.0f * worldRadius / distance * projectionScale;
+}
+
+const LodRange* Renderer::SelectLod(const Mesh& mesh, const glm::mat4& model_xform, const glm::vec3& cameraPos, float projectionScale) const
+{
+	if (mesh.lods.empty())
+		return nullptr;
 
-		glBindVertexArray(0);
+	//Each halving of the on screen size drops one level
+	const float screenDiameter = ScreenDiameter(mesh, model_xform, cameraPos, projectionScale);
+	if (screenDiameter >= m_lodFullDetailPixels)
+		return &mesh.lods[0];
 
-		Jeep.meshVector.push_back(jeepMesh);
+	const int level = (int)std::log2(m_lodFullDetailPixels / std::max(screenDiameter, 1e-3f));
+	return &mesh.lods[std::min(level, (int)mesh.lods.size() - 1)];
+}
+
+//Advances every model's animation and poses its hierarchy. Models sharing a clip are sampled in one SampleClipBatch.
+void Renderer::UpdateAnimation(float deltaTime)
+{
+	m_animatedModels.clear();
+	for (Model& model : modelVector)
+	{
+		if (model.animations && !model.animations->empty())
+		{
+			model.animationTime += deltaTime;
+			m_animatedModels.push_back(&model);
+		}
 	}
-	modelVector.push_back(Jeep);
-	return true;
+
+	//Models playing the same clip end up next to each other
+	const auto clipOf = [](const Model* model) { return &model->animations->front(); };
+	std::sort(m_animatedModels.begin(), m_animatedModels.end(), [&](const Model* a, const Model* b)
+	{
+		return std::less<const Helpers::CompressedClip*>()(clipOf(a), clipOf(b));
+	});
+
+	for (size_t first = 0; first < m_animatedModels.size();)
+	{
+		const Helpers::CompressedClip& clip = *clipOf(m_animatedModels[first]);
+		size_t end = first + 1;
+		while (end < m_animatedModels.size() && clipOf(m_animatedModels[end]) == &clip)
+			end++;
+
+		//Cursors move into the batch and back out rather than being copied
+		const size_t count = end - first;
+		const size_t numTracks = clip.tracks.size();
+		m_animationTimes.resize(count);
+		m_animationCursors.resize(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			Model& model = *m_animatedModels[first + i];
+			m_animationTimes[i] = clip.SecondsToTicks(model.animationTime);
+			m_animationCursors[i] = std::move(model.animationCursor);
+		}
+
+		m_poses.resize(count * numTracks);
+		Helpers::SampleClipBatch(clip, m_animationTimes.data(), m_animationCursors.data(), count, m_poses.data());
+
+		for (size_t i = 0; i < count; i++)
+		{
+			Model& model = *m_animatedModels[first + i];
+			model.animationCursor = std::move(m_animationCursors[i]);
+			Helpers::ApplyPoses(clip, &m_poses[i * numTracks], model.hierarchy);
+			model.hierarchy.UpdateWorldTransforms();
+		}
+
+		first = end;
+	}
+}
+
+//Skins the model's mesh into their streaming buffers from its hierarchy's pose
+void Renderer::UpdateSkinning(Model& model)
+{
+	for (Mesh& mesh : model.meshVector)
+	{
+		if (mesh.skinnedIndex < 0)
+			continue;
+
+		SkinnedMesh& skinned = *m_skinnedMeshes[mesh.skinnedIndex];
+		const size_t numVertices = skinned.source.vertices.size();
+
+		glm::vec3* positions = (glm::vec3*)skinned.stream.BeginWrite();
+		if (!positions)
+			continue;
+		glm::vec3* normals = skinned.source.normals.empty() ? nullptr : positions + numVertices;
+
+		Helpers::ComputeSkinningPalette(skinned.source, model.hierarchy, skinned.palette);
+		Helpers::SkinMesh(skinned.source, skinned.palette, positions, normals);
+		m_skinnedVertices += numVertices;
+
+		//Point the mesh at the region just written, attributes 0 and 1 use bindings 0 and 1.
+		//The rest follow the pool, whose buffers are replaced if it grows.
+		const size_t regionOffset = skinned.stream.GetRegionOffset();
+		m_geometryPool.AttachTo(mesh.vao, skinned.geometry);
+		glVertexArrayVertexBuffer(mesh.vao, 0, skinned.stream.GetBuffer(), regionOffset, sizeof(glm::vec3));
+		glVertexArrayVertexBuffer(mesh.vao, 1, skinned.stream.GetBuffer(), regionOffset + sizeof(glm::vec3) * numVertices, sizeof(glm::vec3));
+	}
+}
+
+//Uploads the faces as stored into one cubemap and builds the cube to draw it on
+void Renderer::CreateSkybox(const std::string (&faceFiles)[6], const Helpers::ImageLoader& fallback)
+{
+	//Every face must be a single square image matching the first in size, format and levels
+	Helpers::TextureFile faces[6];
+	bool loaded = true;
+	for (int face = 0; face < 6 && loaded; face++)
+	{
+		loaded = faces[face].Load(faceFiles[face]) && faces[face].NumFaces() == 1 && faces[face].Width() == faces[face].Height() &&
+			faces[face].Width() == faces[0].Width() && faces[face].InternalFormat() == faces[0].InternalFormat() &&
+			faces[face].NumLevels() == faces[0].NumLevels();
+		if (!loaded)
+			std::cout << "Failed to Load " << faceFiles[face] << " as a skybox face" << std::endl;
+	}
+
+	glGenTextures(1, &m_skyCubemap);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, m_skyCubemap);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+	if (loaded)
+	{
+		const Helpers::TextureFile& first = faces[0];
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, first.NumLevels() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+		glTexStorage2D(GL_TEXTURE_CUBE_MAP, first.NumLevels(), first.InternalFormat(), first.Width(), first.Height());
+		for (int face = 0; face < 6; face++)
+		{
+			for (int level = 0; level < first.NumLevels(); level++)
+			{
+				const Helpers::TextureFileLevel& mip = faces[face].GetLevel(0, level);
+				if (first.IsCompressed())
+					glCompressedTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, 0, 0, mip.width, mip.height,
+						first.InternalFormat(), (GLsizei)mip.size, mip.data);
+				else
+					glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, 0, 0, mip.width, mip.height,
+						first.UploadFormat(), GL_UNSIGNED_BYTE, mip.data);
+			}
+		}
+	}
+	else
+	{
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		for (int face = 0; face < 6; face++)
+			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_RGBA, fallback.Width(), fallback.Height(), 0, GL_RGBA,
+				GL_UNSIGNED_BYTE, fallback.GetData());
+	}
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+	//Corner i is at -1 or +1 on x, y and z by its bits 0, 1 and 2. The sky is seen from inside so each face winds
+	//anticlockwise looking out, and culling stays on.
+	glm::vec3 corners[8];
+	for (int i = 0; i < 8; i++)
+		corners[i] = glm::vec3(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f);
+
+	const GLuint elements[36] =
+	{
+		1, 7, 3, 1, 5, 7,	// +X
+		0, 2, 6, 0, 6, 4,	// -X
+		2, 3, 7, 2, 7, 6,	// +Y
+		0, 5, 1, 0, 4, 5,	// -Y
+		4, 7, 5, 4, 6, 7,	// +Z
+		0, 1, 3, 0, 3, 2	// -Z
+	};
+
+	glGenBuffers(1, &m_skyVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, m_skyVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+
+	glGenBuffers(1, &m_skyEBO);
+	glBindBuffer(GL_ARRAY_BUFFER, m_skyEBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(elements), elements, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glGenVertexArrays(1, &m_skyVAO);
+	glBindVertexArray(m_skyVAO);
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_skyVBO);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_skyEBO);
+
+	//Always reset the bind to prevent issues
+	glBindVertexArray(0);
+}
+
+//The shader puts the sky at the far plane, so drawn last with depth testing against LEQUAL it only shades pixels
+//nothing else has covered rather than the whole screen
+void Renderer::DrawSkybox(const glm::mat4& projection_xform, const glm::mat4& view_xform)
+{
+	if (!m_skyVAO)
+		return;
+
+	glDepthFunc(GL_LEQUAL);
+	glDepthMask(GL_FALSE);
+
+	//Rotation only, the sky never gets any closer
+	const glm::mat4 combined_xform = projection_xform * glm::mat4(glm::mat3(view_xform));
+
+	glUseProgram(m_skyProgram);
+	glUniform1i(glGetUniformLocation(m_skyProgram, "sampler_tex"), 0);
+	glUniformMatrix4fv(glGetUniformLocation(m_skyProgram, "combined_xform"), 1, GL_FALSE, glm::value_ptr(combined_xform));
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, m_skyCubemap);
+	glBindVertexArray(m_skyVAO);
+	glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, (void*)0);
+	m_trianglesDrawn += 12;
+
+	glDepthMask(GL_TRUE);
+	glDepthFunc(GL_LESS);
 }
 
 // Render the scene. Passed the delta time since last called.
 void Renderer::Render(const Helpers::Camera& camera, float deltaTime)
 {			
+	//Finish off some of the GL work for models that have loaded, the rest waits for later frames
+	m_uploadQueue.Drain(std::chrono::microseconds((long long)(m_uploadBudgetMilliseconds * 1000.0f)));
+
 	// Configure pipeline settings
 	glEnable(GL_DEPTH_TEST);
 	glEnable(GL_CULL_FACE);
@@ -787,129 +1093,200 @@ void Renderer::Render(const Helpers::Camera& camera, float deltaTime)
 	GLint viewportSize[4];
 	glGetIntegerv(GL_VIEWPORT, viewportSize);
 	const float aspect_ratio = viewportSize[2] / (float)viewportSize[3];
-	glm::mat4 projection_xform = glm::perspective(glm::radians(45.0f), aspect_ratio, 0.1f, 4000.0f);
+	const float fieldOfView = glm::radians(45.0f);
+	glm::mat4 projection_xform = glm::perspective(fieldOfView, aspect_ratio, 0.1f, 4000.0f);
+
+	//Pixels covered by one unit at unit distance, used to turn bounding spheres into a screen size
+	const float projectionScale = viewportSize[3] * 0.5f / std::tan(fieldOfView * 0.5f);
+	m_trianglesDrawn = 0;
+	m_meshletsVisible = 0;
+	m_meshletsTotal = 0;
+	m_meshletCullMicroseconds = 0;
+
+	//Skin before drawing anything so the CPU work overlaps the GPU still finishing last frame
+	m_skinnedVertices = 0;
+	if (!m_skinnedMeshes.empty())
+	{
+		const auto skinStart = std::chrono::high_resolution_clock::now();
+		UpdateAnimation(deltaTime);
+		for (Model& model : modelVector)
+			UpdateSkinning(model);
+		m_skinningMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - skinStart).count();
+	}
 
 	// Compute camera view matrix and combine with projection matrix for passing to shader
-	/*glm::mat4 view_xform = glm::lookAt(camera.GetPosition(), camera.GetPosition() + camera.GetLookVector(), camera.GetUpVector());
-	glm::mat4 view_xform2 = glm::mat4((glm::mat3(view_xform)));
-	glm::mat4 combined_xform = projection_xform * view_xform;*/
+	const glm::mat4 view_xform = glm::lookAt(camera.GetPosition(), camera.GetPosition() + camera.GetLookVector(), camera.GetUpVector());
+
+	//Programs, materials and textures are only bound when they change. Each model's mesh are sorted by material
+	//so a material binds once per model however many of its mesh use it.
+	GLuint boundProgram = 0;
+	GLuint boundVertexArray = 0;
+	int boundMaterial = -1;
+	GLuint boundTexture = 0;
+	m_programBinds = 0;
+	m_vertexArrayBinds = 0;
+	m_materialBinds = 0;
+	m_textureBinds = 0;
+
+	//The atlas sits on unit 1 for the whole frame, materials in it bind nothing more
+	if (m_textureAtlas.GetTexture())
+	{
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureAtlas.GetTexture());
+		m_textureBinds++;
+	}
+	glActiveTexture(GL_TEXTURE0);
 
 	//Loops through each model in the model vector
 	for (Model& model : modelVector)
 	{
-		//Loops through each mesh in the mesh vector
-		for (Mesh& mesh : model.meshVector)
-		{
-			//sets the model_xform, and view_xform
-			glm::mat4 model_xform = glm::mat4(1);
-			glm::mat4 view_xform = glm::lookAt(camera.GetPosition(), camera.GetPosition() + camera.GetLookVector(), camera.GetUpVector());
+		if (model.meshVector.empty())
+			continue;
 
-			//Sets the correct view_xforms, program etc. depending on the model name - This is to make sure each object is using the correct shaders etc.
-			if (model.modelName == "Skybox")
-			{
-				glDepthMask(GL_FALSE);
-				glDisable(GL_DEPTH_TEST);
+		//sets the model_xform and the program, depending on the model name - This is to make sure each object is using the correct shaders etc.
+		glm::mat4 model_xform = glm::mat4(1);
+		glm::mat4 combined_xform = projection_xform * view_xform;
+		GLuint program = m_program;
 
-				glm::mat4 view_xform2 = glm::mat4((glm::mat3(view_xform)));
-				glm::mat4 combined_xform = projection_xform * view_xform2;
+		if (model.modelName == "Cube")
+		{
+			glDepthMask(GL_TRUE);
+			glEnable(GL_DEPTH_TEST);
+			program = m_cubeProgram;
 
-				glUseProgram(m_skyProgram);
+			model_xform = glm::scale(model_xform, glm::vec3{ 2.5, 2.5, 2.5 });
+			model_xform = glm::translate(model_xform, glm::vec3{ 200, 40, 200 });
 
-				GLuint combined_xform_id = glGetUniformLocation(m_skyProgram, "combined_xform");
-				glUniformMatrix4fv(combined_xform_id, 1, GL_FALSE, glm::value_ptr(combined_xform));
+			//Constantly rotates the cube
+			static float angle = 0;
+			static bool rotateY = true;
 
-				glActiveTexture(GL_TEXTURE0);
-				glUniform1i(glGetUniformLocation(m_skyProgram, "sampler_tex"), 0);
-				glBindTexture(GL_TEXTURE_2D, mesh.txtr);
+			if (rotateY) // Rotate around y axis		
+				model_xform = glm::rotate(model_xform, angle, glm::vec3{ 0, 1, 0 });
+			else // Rotate around x axis		
+				model_xform = glm::rotate(model_xform, angle, glm::vec3{ 1, 0, 0 });
 
-				// Send the model matrix to the shader in a uniform
-				GLuint model_xform_id = glGetUniformLocation(m_skyProgram, "model_xform");
-				glUniformMatrix4fv(model_xform_id, 1, GL_FALSE, glm::value_ptr(model_xform));
+			angle += 0.001f;
+			if (angle > glm::two_pi<float>())
+			{
+				angle = 0;
+				rotateY = !rotateY;
 			}
-			else if (model.modelName == "Terrain")
+		}
+		else
+		{
+			glDepthMask(GL_TRUE);
+			glEnable(GL_DEPTH_TEST);
+
+			if (model.modelName == "Jeep")
 			{
-				glDepthMask(GL_TRUE);
-				glEnable(GL_DEPTH_TEST);
+				//Changes the scale, position, and angle of the model
+				model_xform = glm::scale(model_xform, glm::vec3{ 0.4, 0.4, 0.4 });
+				model_xform = glm::translate(model_xform, glm::vec3{ 2000, 60, 2600 });
+				model_xform = glm::rotate(model_xform, 0.5f, glm::vec3{ 0, 1, 0 });
+			}
+		}
 
-				glm::mat4 combined_xform = projection_xform * view_xform;
+		if (program != boundProgram)
+		{
+			glUseProgram(program);
+			glUniform1i(glGetUniformLocation(program, "sampler_tex"), 0);
+			glUniform1i(glGetUniformLocation(program, "sampler_atlas"), 1);
+			boundProgram = program;
+			m_programBinds++;
+		}
 
-				glUseProgram(m_program);
+		GLuint combined_xform_id = glGetUniformLocation(program, "combined_xform");
+		glUniformMatrix4fv(combined_xform_id, 1, GL_FALSE, glm::value_ptr(combined_xform));
 
-				GLuint combined_xform_id = glGetUniformLocation(m_program, "combined_xform");
-				glUniformMatrix4fv(combined_xform_id, 1, GL_FALSE, glm::value_ptr(combined_xform));
+		// Send the model matrix to the shader in a uniform
+		GLuint model_xform_id = glGetUniformLocation(program, "model_xform");
+		glUniformMatrix4fv(model_xform_id, 1, GL_FALSE, glm::value_ptr(model_xform));
 
-				glActiveTexture(GL_TEXTURE0);
-				glUniform1i(glGetUniformLocation(m_program, "sampler_tex"), 0);
-				glBindTexture(GL_TEXTURE_2D, mesh.txtr);
+		//Loops through each mesh in the mesh vector
+		for (Mesh& mesh : model.meshVector)
+		{
+			//Material parameters are this material's record of the buffer, mesh without one just have a texture
+			GLuint texture = mesh.txtr;
+			if (mesh.material >= 0)
+			{
+				if (mesh.material != boundMaterial)
+				{
+					glBindBufferRange(GL_UNIFORM_BUFFER, 0, m_materialUBO, m_materialStride * mesh.material, sizeof(MaterialRecord));
+					boundMaterial = mesh.material;
+					m_materialBinds++;
+				}
+				const Helpers::TextureHandle& diffuseTexture = m_materials[mesh.material].diffuseTexture;
+				texture = diffuseTexture ? diffuseTexture->id : 0;
 
-				// Send the model matrix to the shader in a uniform
-				GLuint model_xform_id = glGetUniformLocation(m_program, "model_xform");
-				glUniformMatrix4fv(model_xform_id, 1, GL_FALSE, glm::value_ptr(model_xform));
+				//Streamed textures are kept as sharp as the mesh's size on screen needs
+				if (diffuseTexture)
+					m_textureCache.RequestLevel(diffuseTexture, Helpers::RequiredMipLevel(diffuseTexture->width, diffuseTexture->height,
+						ScreenDiameter(mesh, model_xform, camera.GetPosition(), projectionScale)));
 			}
-			else if (model.modelName == "Jeep")
-			{
-				glDepthMask(GL_TRUE);
-				glEnable(GL_DEPTH_TEST);
 
-				glm::mat4 combined_xform = projection_xform * view_xform;
+			if (texture && texture != boundTexture)
+			{
+				glBindTexture(GL_TEXTURE_2D, texture);
+				boundTexture = texture;
+				m_textureBinds++;
+			}
 
-				glUseProgram(m_program);
+			//Everything in the pool shares one vertex array, only the cube and skinned mesh change it
+			if (mesh.vao != boundVertexArray)
+			{
+				glBindVertexArray(mesh.vao);
+				boundVertexArray = mesh.vao;
+				m_vertexArrayBinds++;
+			}
 
-				GLuint combined_xform_id = glGetUniformLocation(m_program, "combined_xform");
-				glUniformMatrix4fv(combined_xform_id, 1, GL_FALSE, glm::value_ptr(combined_xform));
+			//Large mesh are culled a meshlet at a time, in model space so the bounds need no transforming
+			if (m_meshletCulling && !mesh.meshlets.meshlets.empty())
+			{
+				const auto cullStart = std::chrono::high_resolution_clock::now();
 
-				//Changes the scale, position, and angle of the model
-				model_xform = glm::scale(model_xform, glm::vec3{ 0.4, 0.4, 0.4 });
-				model_xform = glm::translate(model_xform, glm::vec3{ 2000, 60, 2600 });
-				model_xform = glm::rotate(model_xform, 0.5f , glm::vec3{ 0, 1, 0 });
+				const Helpers::Frustum frustum = Helpers::Frustum::FromMatrix(projection_xform * view_xform * model_xform);
+				const glm::vec3 modelEye = glm::vec3(glm::inverse(model_xform) * glm::vec4(camera.GetPosition(), 1.0f));
+				Helpers::CullMeshlets(mesh.meshlets, frustum, modelEye, m_meshletDrawList, mesh.firstElement, mesh.baseVertex);
 
-				glActiveTexture(GL_TEXTURE0);
-				glUniform1i(glGetUniformLocation(m_program, "sampler_tex"), 0);
-				glBindTexture(GL_TEXTURE_2D, mesh.txtr);
+				m_meshletCullMicroseconds += std::chrono::duration<float, std::micro>(std::chrono::high_resolution_clock::now() - cullStart).count();
+				m_meshletsVisible += m_meshletDrawList.visibleMeshlets;
+				m_meshletsTotal += mesh.meshlets.meshlets.size();
+				m_trianglesDrawn += m_meshletDrawList.visibleTriangles;
 
-				// Send the model matrix to the shader in a uniform
-				GLuint model_xform_id = glGetUniformLocation(m_program, "model_xform");
-				glUniformMatrix4fv(model_xform_id, 1, GL_FALSE, glm::value_ptr(model_xform));
+				glMultiDrawElementsBaseVertex(GL_TRIANGLES, m_meshletDrawList.counts.data(), GL_UNSIGNED_INT,
+					(void**)m_meshletDrawList.offsets.data(), (GLsizei)m_meshletDrawList.counts.size(), m_meshletDrawList.baseVertices.data());
+				continue;
 			}
-			else if (model.modelName == "Cube")
-			{
-				glDepthMask(GL_TRUE);
-				glEnable(GL_DEPTH_TEST);
-
-				glm::mat4 combined_xform = projection_xform * view_xform;
 
-				glUseProgram(m_cubeProgram);
+			//Level of detail from the mesh's size on screen, mesh without levels draw everything
+			LodRange range{ 0, mesh.numElements };
+			if (const LodRange* lod = SelectLod(mesh, model_xform, camera.GetPosition(), projectionScale))
+				range = *lod;
+			m_trianglesDrawn += range.numElements / 3 * mesh.instances.count;
 
-				GLuint combined_xform_id = glGetUniformLocation(m_cubeProgram, "combined_xform");
-				glUniformMatrix4fv(combined_xform_id, 1, GL_FALSE, glm::value_ptr(combined_xform));
-
-				model_xform = glm::scale(model_xform, glm::vec3{ 2.5, 2.5, 2.5 });
-				model_xform = glm::translate(model_xform, glm::vec3{ 200, 40, 200 });
+			//One call for mesh drawn once or instanced, the base vertex and instance place it in the pool
+			glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, range.numElements, GL_UNSIGNED_INT,
+				(void*)(sizeof(GLuint) * (mesh.firstElement + range.firstElement)), mesh.instances.count, mesh.baseVertex, mesh.instances.baseInstance);
+		}
+	}
 
-				//Constantly rotates the cube
-				static float angle = 0;
-				static bool rotateY = true;
+	DrawSkybox(projection_xform, view_xform);
 
-				if (rotateY) // Rotate around y axis		
-					model_xform = glm::rotate(model_xform, angle, glm::vec3{ 0, 1, 0 });
-				else // Rotate around x axis		
-					model_xform = glm::rotate(model_xform, angle, glm::vec3{ 1, 0, 0 });
+	//Sharper levels for the textures drawn this frame, ready from the next
+	m_textureCache.UpdateStreaming(std::chrono::microseconds((long long)(m_uploadBudgetMilliseconds * 1000.0f)));
 
-				angle += 0.001f;
-				if (angle > glm::two_pi<float>())
-				{
-					angle = 0;
-					rotateY = !rotateY;
-				}
+	//Reads back the frame if a capture is due, the pixels arrive and are saved over the next few frames
+	m_frameCapture.EndFrame();
 
-				// Send the model matrix to the shader in a uniform
-				GLuint model_xform_id = glGetUniformLocation(m_cubeProgram, "model_xform");
-				glUniformMatrix4fv(model_xform_id, 1, GL_FALSE, glm::value_ptr(model_xform));
-			}
+	//This frame's skinned vertices are in use until the GPU passes this point
+	for (std::unique_ptr<SkinnedMesh>& skinned : m_skinnedMeshes)
+		skinned->stream.EndFrame();
+}
 
-			// Bind our VAO and render
-			glBindVertexArray(mesh.vao);
-			glDrawElements(GL_TRIANGLES, mesh.numElements, GL_UNSIGNED_INT, (void*)0);
-		}
-	}
-}
\ No newline at end of file
+//Save every interval-th frame from now on as prefix_<frame>.png
+void Renderer::CaptureFrames(const std::string& prefix, unsigned int interval)
+{
+	m_captureInterval = (int)interval;
+	m_frameCapture.StartSequence(prefix, interval);
+}
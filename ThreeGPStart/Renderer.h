@@ -4,20 +4,127 @@
 #include "Helper.h"
 #include "Mesh.h"
 #include "Camera.h"
+#include "Meshlet.h"
+#include "Skinning.h"
+#include "StreamingBuffer.h"
+#include "UploadQueue.h"
+#include "ImageLoader.h"
+#include "TextureCache.h"
+#include "TextureAtlas.h"
+#include "FrameCapture.h"
+#include "GeometryPool.h"
+
+#include <future>
+#include <memory>
+#include <unordered_map>
+
+//A range of the element buffer holding one level of detail
+struct LodRange
+{
+	GLuint firstElement{ 0 };
+	GLuint numElements{ 0 };
+};
+
+//Material parameters laid out as the shader's std140 Material block
+struct MaterialRecord
+{
+	glm::vec4 diffuseColour{ 1 };
+	glm::vec4 ambientColour{ 1 };
+	glm::vec4 emissiveColour{ 0 };
+	glm::vec4 specularColour{ 1 };
+
+	//Where the diffuse texture is in the atlas, layer -1 when it is a texture of its own
+	glm::vec4 atlasRect{ 0, 0, 1, 1 };
+	float specularFactor{ 1 };
+	float atlasLayer{ -1 };
+	float padding[2]{};
+};
+
+//A material on the GPU, its parameters are the record at the same index in the renderer's material buffer.
+//Null diffuseTexture when the texture is in the atlas.
+struct RenderMaterial
+{
+	Helpers::TextureHandle diffuseTexture;
+	MaterialRecord record;
+};
 
 //Creates a struct to hold specific information
 struct Mesh
 {
-	GLuint txtr;
+	//Texture bound for mesh without a material, 0 for none
+	GLuint txtr{ 0 };
+
+	//Index into the renderer's materials, -1 to bind txtr instead
+	int material{ -1 };
+
+	//The geometry pool's vertex array for mesh in the pool, one of its own for the cube and skinned mesh
 	GLuint vao{ 0 };
 	GLuint numElements{ 0 };
+
+	//Where the mesh starts in the pool's buffers, added to every draw
+	GLint baseVertex{ 0 };
+	GLuint firstElement{ 0 };
+
+	//Levels of detail packed one after another from firstElement, lods[0] is full detail
+	//Empty for mesh that only have the one level
+	std::vector<LodRange> lods;
+
+	//Model space bounding sphere used to choose a level of detail
+	glm::vec3 boundsCentre{ 0 };
+	float boundsRadius{ 0 };
+
+	//Clusters for culling parts of large mesh, the element buffer holds meshlets.elements when in use
+	Helpers::MeshletMesh meshlets;
+
+	//Index into the renderer's skinned mesh, -1 for mesh that are not skinned
+	int skinnedIndex{ -1 };
+
+	//Per instance transforms in the pool, the pool's identity for mesh drawn once with no transform of their own
+	Helpers::InstanceRange instances;
+};
+
+//Where one unique piece of geometry sits in the geometry pool, shared by every mesh with the same content hash
+struct GeometryBuffers
+{
+	Helpers::GeometryRange range;
+
+	GLuint numElements{ 0 };
+	std::vector<LodRange> lods;
+	glm::vec3 boundsCentre{ 0 };
+	float boundsRadius{ 0 };
+
+	//False for skinned mesh, whose positions and normals stream from elsewhere so are not pooled
+	bool hasPositions{ true };
+};
+
+//A mesh skinned on the CPU, its positions and normals are rewritten into the stream every frame
+struct SkinnedMesh
+{
+	//Bind pose vertices and bone weights
+	Helpers::Mesh source;
+	std::vector<glm::mat4> palette;
+
+	//Each region holds all the positions followed by all the normals
+	Helpers::StreamingBuffer stream;
+
+	//Texture coordinates and elements stay in the geometry pool
+	Helpers::GeometryRange geometry;
 };
 
 struct Model 
 {
 	std::string modelName;
+
+	//Kept sorted by material so each material is bound once when drawing the model
 	std::vector<Mesh> meshVector;
 	GLuint numCubeElements = 0;
+
+	//Skeleton and animation for models with skinned mesh, the first animation loops.
+	//Shared, so models given the same clips are sampled together.
+	Helpers::NodeHierarchy hierarchy;
+	std::shared_ptr<const std::vector<Helpers::CompressedClip>> animations;
+	Helpers::AnimationCursor animationCursor;
+	float animationTime{ 0 };
 };
 
 class Renderer
@@ -31,8 +138,109 @@ private:
 	//Create a model vector
 	std::vector<Model> modelVector;
 
+	//The sky as one cubemap on a cube of 8 corners and 36 indices, drawn in one call after everything else
+	GLuint m_skyCubemap{ 0 };
+	GLuint m_skyVAO{ 0 };
+	GLuint m_skyVBO{ 0 };
+	GLuint m_skyEBO{ 0 };
+
+	//Uploads the faces (+X, -X, +Y, -Y, +Z, -Z) as stored into the cubemap and builds the cube. Any face that will
+	//not load, or does not match the others, puts fallback on every face instead.
+	void CreateSkybox(const std::string (&faceFiles)[6], const Helpers::ImageLoader& fallback);
+
+	//Draws the sky at the far plane, only where nothing has been drawn
+	void DrawSkybox(const glm::mat4& projection_xform, const glm::mat4& view_xform);
+
 	bool m_wireframe{ false };
 
+	//Projected diameter in pixels at or above which mesh draw at full detail, each halving drops a level
+	float m_lodFullDetailPixels{ 400.0f };
+
+	//Triangles submitted last frame, shown in the GUI
+	size_t m_trianglesDrawn{ 0 };
+
+	//What the optimiser did to the terrain at load, shown in the GUI
+	std::string m_terrainOptimise;
+
+	//Meshlet culling for large mesh, with last frame's results for the GUI
+	bool m_meshletCulling{ true };
+	Helpers::MeshletDrawList m_meshletDrawList;
+	size_t m_meshletsVisible{ 0 };
+	size_t m_meshletsTotal{ 0 };
+	float m_meshletCullMicroseconds{ 0 };
+
+	//CPU skinned mesh, with last frame's cost (animation included) for the GUI
+	std::vector<std::unique_ptr<SkinnedMesh>> m_skinnedMeshes;
+	size_t m_skinnedVertices{ 0 };
+	float m_skinningMilliseconds{ 0 };
+
+	//Animated models grouped by clip, with the times, cursors and poses of the batch being sampled, kept between frames
+	std::vector<Model*> m_animatedModels;
+	std::vector<float> m_animationTimes;
+	std::vector<Helpers::AnimationCursor> m_animationCursors;
+	std::vector<Helpers::NodePose> m_poses;
+
+	//Advances every model's animation and poses its hierarchy, models playing the same clip sampled as one batch
+	void UpdateAnimation(float deltaTime);
+
+	//Skins the model's mesh into their streaming buffers from its hierarchy's pose
+	void UpdateSkinning(Model& model);
+
+	//Models loading on worker threads, they queue their GL work here for Render to run within the budget
+	std::vector<std::future<std::shared_ptr<Helpers::ModelLoader>>> m_modelLoads;
+	Helpers::UploadQueue m_uploadQueue;
+	float m_uploadBudgetMilliseconds{ 2.0f };
+
+	//Vertices, elements and instance transforms of every mesh but the cube, in one set of buffers drawn with a base vertex
+	Helpers::GeometryPool m_geometryPool;
+
+	//Geometry already in the pool by content hash, with how often a mesh found its buffers here
+	std::unordered_multimap<uint64_t, GeometryBuffers> m_geometryCache;
+	size_t m_geometryCacheHits{ 0 };
+
+	//Finds or adds the pooled geometry for a loaded mesh
+	const GeometryBuffers& GetGeometryBuffers(const Helpers::Mesh& source, bool needsPositions);
+
+	//Textures shared by every material that uses them, declared before the materials so it outlives their handles
+	Helpers::TextureCache m_textureCache;
+
+	//GPU memory the streamed textures can grow into, set on the cache when the GUI changes it
+	int m_textureBudgetMegabytes{ (int)(Helpers::TextureCacheSettings().streamingBudgetBytes / (1024 * 1024)) };
+
+	//Small textures packed into the layers of one array, bound once a frame whatever uses them
+	Helpers::TextureAtlas m_textureAtlas;
+
+	//Every material created, with their parameters packed into one uniform buffer a record per material
+	std::vector<RenderMaterial> m_materials;
+	GLuint m_materialUBO{ 0 };
+	GLsizeiptr m_materialStride{ 0 };
+	GLsizeiptr m_materialCapacity{ 0 };
+
+	//Screenshots and frame sequences, read back at the end of Render so the GUI is not in them
+	Helpers::FrameCapture m_frameCapture;
+	int m_captureInterval{ 10 };
+
+	//Program, vertex array, material and texture changes last frame, shown in the GUI
+	size_t m_programBinds{ 0 };
+	size_t m_vertexArrayBinds{ 0 };
+	size_t m_materialBinds{ 0 };
+	size_t m_textureBinds{ 0 };
+
+	//Finds or creates a material with these parameters and texture, returning its index. A valid atlas entry is used
+	//in place of the texture. Main thread only.
+	int GetMaterial(const Helpers::Material& material, const Helpers::TextureHandle& diffuseTexture,
+		const Helpers::AtlasEntry& atlasEntry = Helpers::AtlasEntry());
+
+	//Adds one loaded mesh to the pool, drawn once per instance transform with the given material,
+	//and adds it to the model. Main thread only.
+	void CreateModelMesh(Model& model, const Helpers::Mesh& source, int material, const std::vector<glm::mat4>& instances);
+
+	//Diameter in pixels of a mesh's bounding sphere drawn with model_xform
+	float ScreenDiameter(const Mesh& mesh, const glm::mat4& model_xform, const glm::vec3& cameraPos, float projectionScale) const;
+
+	//Picks the level of detail for a mesh drawn with model_xform
+	const LodRange* SelectLod(const Mesh& mesh, const glm::mat4& model_xform, const glm::vec3& cameraPos, float projectionScale) const;
+
 	//Create a function that allows me to create a program
 	GLuint CreateProgram(std::string, std::string);
 public:
@@ -47,4 +255,7 @@ public:
 
 	// Render the scene
 	void Render(const Helpers::Camera& camera, float deltaTime);
+
+	// Save every interval-th frame from now on as prefix_<frame>.png
+	void CaptureFrames(const std::string& prefix, unsigned int interval);
 }; 
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+// Brings in the SSE intrinsics where the target has them
+// Code using them should check HELPERS_SSE2 and keep a plain C++ path for other targets
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+	#define HELPERS_SSE2 1
+	#include <emmintrin.h>
+#else
+	#define HELPERS_SSE2 0
+#endif
+
+// Wider instruction sets are only used by kernels chosen at run time once the CPU is known to have them.
+// HELPERS_TARGET marks such a function so GCC and Clang compile it for that set, MSVC needs nothing.
+#if HELPERS_SSE2
+	#include <immintrin.h>
+	#if defined(__GNUC__) || defined(__clang__)
+		#include <cpuid.h>
+		#define HELPERS_TARGET(isa) __attribute__((target(isa)))
+	#else
+		#include <intrin.h>
+		#define HELPERS_TARGET(isa)
+	#endif
+#endif
+
+namespace Helpers
+{
+	// Instruction sets of the CPU running the program, beyond the SSE2 every x64 CPU has
+	struct CpuFeatures
+	{
+		bool ssse3{ false };
+		bool sse41{ false };
+		bool avx2{ false };
+
+		// Detected once on first use
+		static const CpuFeatures& Get()
+		{
+			static const CpuFeatures features{ Detect() };
+			return features;
+		}
+
+	private:
+		static CpuFeatures Detect()
+		{
+			CpuFeatures features;
+#if HELPERS_SSE2
+			// Leaf 1 ECX has SSSE3 (bit 9), SSE4.1 (19) and OSXSAVE (27), leaf 7 EBX has AVX2 (bit 5)
+			unsigned int leaf1[4]{}, leaf7[4]{};
+	#if defined(__GNUC__) || defined(__clang__)
+			__get_cpuid(1, &leaf1[0], &leaf1[1], &leaf1[2], &leaf1[3]);
+			__get_cpuid_count(7, 0, &leaf7[0], &leaf7[1], &leaf7[2], &leaf7[3]);
+	#else
+			__cpuid((int*)leaf1, 1);
+			__cpuidex((int*)leaf7, 7, 0);
+	#endif
+			features.ssse3 = (leaf1[2] >> 9) & 1;
+			features.sse41 = (leaf1[2] >> 19) & 1;
+
+			// AVX2 also needs the OS to save the upper halves of the registers, XCR0 bits 1 and 2
+			if ((leaf1[2] >> 27) & 1)
+			{
+				unsigned int xcr0Low, xcr0High;
+	#if defined(__GNUC__) || defined(__clang__)
+				__asm__("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+	#else
+				const unsigned long long xcr0{ _xgetbv(0) };
+				xcr0Low = (unsigned int)xcr0;
+				xcr0High = (unsigned int)(xcr0 >> 32);
+	#endif
+				(void)xcr0High;
+				features.avx2 = (xcr0Low & 6) == 6 && ((leaf7[1] >> 5) & 1);
+			}
+#endif
+			return features;
+		}
+	};
+}
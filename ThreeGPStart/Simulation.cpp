@@ -72,4 +72,10 @@ bool Simulation::Update(GLFWwindow* window)
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
 	return true;
-}
\ No newline at end of file
+}
+
+// Save every interval-th frame from now on as PNGs starting prefix
+void Simulation::CaptureFrames(const std::string& prefix, unsigned int interval)
+{
+	m_renderer->CaptureFrames(prefix, interval);
+}
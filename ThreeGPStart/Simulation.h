@@ -27,5 +27,8 @@ public:
 
 	// Update the simulation (and render) returns false if program should clse
 	bool Update(GLFWwindow* window);
+
+	// Save every interval-th frame from now on as PNGs starting prefix
+	void CaptureFrames(const std::string& prefix, unsigned int interval);
 };
 
@@ -0,0 +1,196 @@
+#include "Skinning.h"
+#include "Simd.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+namespace Helpers
+{
+	namespace
+	{
+		// Vertices per ParallelFor chunk, enough to amortise handing out the work
+		const size_t kSkinningGrain{ 4096 };
+
+#if HELPERS_SSE2
+		inline void StoreVec3(glm::vec3& out, __m128 v)
+		{
+			_mm_storel_pi((__m64*)&out.x, v);
+			_mm_store_ss(&out.z, _mm_movehl_ps(v, v));
+		}
+
+		inline __m128 Normalise3(__m128 v)
+		{
+			// w is 0 for directions so a four lane dot product is fine
+			__m128 squares{ _mm_mul_ps(v, v) };
+			squares = _mm_add_ps(squares, _mm_shuffle_ps(squares, squares, _MM_SHUFFLE(2, 3, 0, 1)));
+			squares = _mm_add_ps(squares, _mm_shuffle_ps(squares, squares, _MM_SHUFFLE(1, 0, 3, 2)));
+			const __m128 nonZero{ _mm_cmpgt_ps(squares, _mm_setzero_ps()) };
+			return _mm_and_ps(_mm_div_ps(v, _mm_sqrt_ps(squares)), nonZero);
+		}
+#endif
+
+		// Plain glm skinning of one vertex, what SkinVertices is checked against
+		void SkinVertexReference(const Mesh& mesh, const glm::mat4* palette, size_t v, glm::vec3& position, glm::vec3& normal)
+		{
+			const glm::uvec4& indices{ mesh.boneIndices[v] };
+			const glm::vec4& weights{ mesh.boneWeights[v] };
+			const glm::mat4 blended{ palette[indices.x] * weights.x + palette[indices.y] * weights.y +
+				palette[indices.z] * weights.z + palette[indices.w] * weights.w };
+
+			position = glm::vec3(blended * glm::vec4(mesh.vertices[v], 1.0f));
+			normal = glm::normalize(glm::vec3(blended * glm::vec4(mesh.normals[v], 0.0f)));
+		}
+	}
+
+	// Palette matrix per bone: world transform of the bone's node times the inverse bind matrix
+	void ComputeSkinningPalette(const Mesh& mesh, const NodeHierarchy& hierarchy, std::vector<glm::mat4>& palette)
+	{
+		palette.resize(mesh.bones.size());
+		for (size_t b = 0; b < mesh.bones.size(); b++)
+		{
+			const Bone& bone{ mesh.bones[b] };
+			if (bone.nodeIndex == NodeHierarchy::kInvalidNode || (size_t)bone.nodeIndex >= hierarchy.Size())
+				palette[b] = glm::mat4(1);
+			else
+				palette[b] = hierarchy.worldTransforms[bone.nodeIndex] * bone.offset;
+		}
+	}
+
+	// Blends the vertex's four palette matrices by weight then transforms the position and normal by the result
+	void SkinVertices(const Mesh& mesh, const glm::mat4* palette, size_t begin, size_t end, glm::vec3* outPositions, glm::vec3* outNormals)
+	{
+		const bool hasNormals{ outNormals && mesh.normals.size() == mesh.vertices.size() };
+
+		for (size_t v = begin; v < end; v++)
+		{
+			const glm::uvec4& indices{ mesh.boneIndices[v] };
+			const glm::vec4& weights{ mesh.boneWeights[v] };
+			const glm::vec3& position{ mesh.vertices[v] };
+
+#if HELPERS_SSE2
+			__m128 columns[4];
+			for (int c = 0; c < 4; c++)
+			{
+				columns[c] = _mm_mul_ps(_mm_loadu_ps(&palette[indices.x][c][0]), _mm_set1_ps(weights.x));
+				columns[c] = _mm_add_ps(columns[c], _mm_mul_ps(_mm_loadu_ps(&palette[indices.y][c][0]), _mm_set1_ps(weights.y)));
+				columns[c] = _mm_add_ps(columns[c], _mm_mul_ps(_mm_loadu_ps(&palette[indices.z][c][0]), _mm_set1_ps(weights.z)));
+				columns[c] = _mm_add_ps(columns[c], _mm_mul_ps(_mm_loadu_ps(&palette[indices.w][c][0]), _mm_set1_ps(weights.w)));
+			}
+
+			__m128 skinned{ _mm_mul_ps(columns[0], _mm_set1_ps(position.x)) };
+			skinned = _mm_add_ps(skinned, _mm_mul_ps(columns[1], _mm_set1_ps(position.y)));
+			skinned = _mm_add_ps(skinned, _mm_mul_ps(columns[2], _mm_set1_ps(position.z)));
+			skinned = _mm_add_ps(skinned, columns[3]);
+			StoreVec3(outPositions[v - begin], skinned);
+
+			if (hasNormals)
+			{
+				const glm::vec3& normal{ mesh.normals[v] };
+				__m128 skinnedNormal{ _mm_mul_ps(columns[0], _mm_set1_ps(normal.x)) };
+				skinnedNormal = _mm_add_ps(skinnedNormal, _mm_mul_ps(columns[1], _mm_set1_ps(normal.y)));
+				skinnedNormal = _mm_add_ps(skinnedNormal, _mm_mul_ps(columns[2], _mm_set1_ps(normal.z)));
+				StoreVec3(outNormals[v - begin], Normalise3(skinnedNormal));
+			}
+#else
+			const glm::mat4 blended{ palette[indices.x] * weights.x + palette[indices.y] * weights.y +
+				palette[indices.z] * weights.z + palette[indices.w] * weights.w };
+
+			outPositions[v - begin] = glm::vec3(blended * glm::vec4(position, 1.0f));
+			if (hasNormals)
+			{
+				const glm::vec3 skinnedNormal{ blended * glm::vec4(mesh.normals[v], 0.0f) };
+				const float length{ glm::length(skinnedNormal) };
+				outNormals[v - begin] = length > 0 ? skinnedNormal / length : skinnedNormal;
+			}
+#endif
+		}
+	}
+
+	// Skins every vertex of the mesh, split across the pool
+	void SkinMesh(const Mesh& mesh, const std::vector<glm::mat4>& palette, glm::vec3* outPositions, glm::vec3* outNormals, ThreadPool& pool)
+	{
+		if (mesh.boneIndices.size() != mesh.vertices.size() || palette.empty())
+			return;
+
+		pool.ParallelFor(mesh.vertices.size(), kSkinningGrain, [&](size_t begin, size_t end)
+		{
+			SkinVertices(mesh, palette.data(), begin, end, outPositions + begin, outNormals ? outNormals + begin : nullptr);
+		});
+	}
+
+	// Skins a generated mesh on one thread then on the pool
+	SkinningBenchmarkResult BenchmarkSkinning(size_t numVertices, unsigned int numBones, int iterations, ThreadPool& pool)
+	{
+		SkinningBenchmarkResult result;
+		result.numVertices = numVertices;
+		result.numThreads = pool.NumThreads() + 1;
+		if (numVertices == 0 || numBones == 0 || iterations <= 0)
+			return result;
+
+		// Fixed seed so runs are comparable
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		std::uniform_int_distribution<unsigned int> anyBone(0, numBones - 1);
+
+		Mesh mesh;
+		mesh.vertices.resize(numVertices);
+		mesh.normals.resize(numVertices);
+		mesh.boneIndices.resize(numVertices);
+		mesh.boneWeights.resize(numVertices);
+		for (size_t v = 0; v < numVertices; v++)
+		{
+			mesh.vertices[v] = glm::vec3(unit(random), unit(random), unit(random)) * 10.0f;
+			mesh.normals[v] = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + 0.1f);
+			mesh.boneIndices[v] = glm::uvec4(anyBone(random), anyBone(random), anyBone(random), anyBone(random));
+
+			const glm::vec4 weights{ unit(random), unit(random), unit(random), unit(random) };
+			mesh.boneWeights[v] = weights / (weights.x + weights.y + weights.z + weights.w);
+		}
+
+		std::vector<glm::mat4> palette(numBones);
+		for (unsigned int b = 0; b < numBones; b++)
+			palette[b] = glm::rotate(glm::translate(glm::mat4(1), glm::vec3(b, 0, 0)), b * 0.1f, glm::vec3(0, 1, 0));
+
+		std::vector<glm::vec3> positions(numVertices);
+		std::vector<glm::vec3> normals(numVertices);
+
+		const auto verticesPerSecond{ [&](const std::function<void()>& skin)
+		{
+			const auto start{ std::chrono::high_resolution_clock::now() };
+			for (int i = 0; i < iterations; i++)
+				skin();
+			const double seconds{ std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count() };
+			return seconds > 0 ? (double)numVertices * iterations / seconds : 0.0;
+		} };
+
+		result.singleThreadVerticesPerSecond = verticesPerSecond([&]()
+		{
+			SkinVertices(mesh, palette.data(), 0, numVertices, positions.data(), normals.data());
+		});
+
+		result.verticesPerSecond = verticesPerSecond([&]()
+		{
+			SkinMesh(mesh, palette, positions.data(), normals.data(), pool);
+		});
+
+		for (size_t v = 0; v < numVertices; v++)
+		{
+			glm::vec3 position, normal;
+			SkinVertexReference(mesh, palette.data(), v, position, normal);
+			result.maxPositionError = std::max(result.maxPositionError, glm::length(positions[v] - position) / std::max(glm::length(position), 1.0f));
+			result.maxNormalError = std::max(result.maxNormalError, glm::length(normals[v] - normal));
+		}
+
+		// Weights sum to 1, so identity matrices should leave every vertex where it is
+		const std::vector<glm::mat4> identity(numBones, glm::mat4(1));
+		SkinMesh(mesh, identity, positions.data(), normals.data(), pool);
+		for (size_t v = 0; v < numVertices; v++)
+		{
+			result.maxBindPoseError = std::max({ result.maxBindPoseError, glm::length(positions[v] - mesh.vertices[v]) / std::max(glm::length(mesh.vertices[v]), 1.0f),
+				glm::length(normals[v] - glm::normalize(mesh.normals[v])) });
+		}
+
+		return result;
+	}
+}
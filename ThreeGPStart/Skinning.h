@@ -0,0 +1,51 @@
+#pragma once
+// CPU linear blend skinning of meshes loaded with bones
+
+#include "ExternalLibraryHeaders.h"
+#include "Mesh.h"
+#include "ThreadPool.h"
+
+namespace Helpers
+{
+	// Fills palette with one matrix per bone of the mesh: the bone's current world transform times its inverse bind matrix.
+	// Skinned output is in the space of the hierarchy's root.
+	void ComputeSkinningPalette(const Mesh& mesh, const NodeHierarchy& hierarchy, std::vector<glm::mat4>& palette);
+
+	// Skins vertices [begin, end) of the mesh. Outputs are indexed from 0 for vertex 0, outNormals may be null.
+	void SkinVertices(const Mesh& mesh, const glm::mat4* palette, size_t begin, size_t end, glm::vec3* outPositions, glm::vec3* outNormals);
+
+	// Skins every vertex of the mesh, split across the pool. outNormals may be null.
+	void SkinMesh(const Mesh& mesh, const std::vector<glm::mat4>& palette, glm::vec3* outPositions, glm::vec3* outNormals,
+		ThreadPool& pool = ThreadPool::Shared());
+
+	// Throughput and correctness of SkinMesh on a generated mesh
+	struct SkinningBenchmarkResult
+	{
+		size_t numVertices{ 0 };
+		unsigned int numThreads{ 0 };
+		double singleThreadVerticesPerSecond{ 0 };
+		double verticesPerSecond{ 0 };
+
+		// Largest difference from blending the palette with glm, positions relative to their distance from the origin
+		float maxPositionError{ 0 };
+		float maxNormalError{ 0 };
+
+		// Largest difference from the bind pose (normals normalised) when every palette matrix is the identity
+		float maxBindPoseError{ 0 };
+
+		bool Passed() const { return maxPositionError <= 1e-5f && maxNormalError <= 1e-5f && maxBindPoseError <= 1e-5f; }
+
+		std::string ToString() const {
+			return "Skinning " + std::to_string(numVertices) + " verts. 1 thread: " +
+				std::to_string(singleThreadVerticesPerSecond / 1e6) + " M verts/s " +
+				std::to_string(numThreads) + " threads: " + std::to_string(verticesPerSecond / 1e6) + " M verts/s" +
+				" Max error position: " + std::to_string(maxPositionError) + " normal: " + std::to_string(maxNormalError) +
+				" bind pose: " + std::to_string(maxBindPoseError) + (Passed() ? " PASS" : " FAIL");
+		}
+	};
+
+	// Skins a generated mesh of numVertices with four influences each from numBones, iterations times, on one thread then on the pool.
+	// Then checks the pool's output against glm, and that an identity palette gives back the bind pose.
+	SkinningBenchmarkResult BenchmarkSkinning(size_t numVertices = 100000, unsigned int numBones = 64, int iterations = 50,
+		ThreadPool& pool = ThreadPool::Shared());
+}
@@ -0,0 +1,89 @@
+#include "StreamingBuffer.h"
+
+namespace Helpers
+{
+	StreamingBuffer::~StreamingBuffer()
+	{
+		Destroy();
+	}
+
+	// Creates the buffer with regionBytes written per frame
+	bool StreamingBuffer::Create(size_t regionBytes)
+	{
+		Destroy();
+
+		const GLbitfield flags{ GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT };
+		const GLsizeiptr totalBytes{ (GLsizeiptr)(regionBytes * kNumRegions) };
+
+		glCreateBuffers(1, &m_buffer);
+		glNamedBufferStorage(m_buffer, totalBytes, nullptr, flags);
+		m_mapped = (unsigned char*)glMapNamedBufferRange(m_buffer, 0, totalBytes, flags);
+		if (!m_mapped)
+		{
+			std::cout << "Failed to map streaming buffer" << std::endl;
+			Destroy();
+			return false;
+		}
+
+		m_regionBytes = regionBytes;
+		m_region = kNumRegions - 1;
+		return true;
+	}
+
+	// Frees the buffer
+	void StreamingBuffer::Destroy()
+	{
+		for (GLsync& fence : m_fences)
+		{
+			if (fence)
+				glDeleteSync(fence);
+			fence = nullptr;
+		}
+
+		if (m_buffer)
+		{
+			if (m_mapped)
+				glUnmapNamedBuffer(m_buffer);
+			glDeleteBuffers(1, &m_buffer);
+		}
+
+		m_buffer = 0;
+		m_mapped = nullptr;
+		m_regionBytes = 0;
+	}
+
+	// Moves to the next region, waiting for the GPU if it is still reading it
+	void* StreamingBuffer::BeginWrite()
+	{
+		if (!m_mapped)
+			return nullptr;
+
+		m_region = (m_region + 1) % kNumRegions;
+
+		GLsync& fence{ m_fences[m_region] };
+		if (fence)
+		{
+			// Only blocks if the GPU is more than kNumRegions - 1 frames behind
+			const GLuint64 kTimeoutNs{ 1000000000 };
+			GLenum status{ glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0) };
+			while (status == GL_TIMEOUT_EXPIRED)
+				status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, kTimeoutNs);
+
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+
+		return m_mapped + GetRegionOffset();
+	}
+
+	// Fences the current region so it is not rewritten while the GPU reads it
+	void StreamingBuffer::EndFrame()
+	{
+		if (!m_mapped)
+			return;
+
+		if (m_fences[m_region])
+			glDeleteSync(m_fences[m_region]);
+		m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+}
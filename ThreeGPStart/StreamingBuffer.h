@@ -0,0 +1,45 @@
+#pragma once
+// A GL buffer the CPU rewrites every frame without waiting on the GPU
+
+#include "ExternalLibraryHeaders.h"
+
+namespace Helpers
+{
+	// Persistently mapped and split into kNumRegions. Each frame the CPU writes the next region while the GPU
+	// may still be drawing from the others, a fence per region stops the CPU catching the GPU up.
+	class StreamingBuffer
+	{
+	public:
+		static const unsigned int kNumRegions{ 3 };
+
+		StreamingBuffer() = default;
+		~StreamingBuffer();
+
+		StreamingBuffer(const StreamingBuffer&) = delete;
+		StreamingBuffer& operator=(const StreamingBuffer&) = delete;
+
+		// Creates the buffer with regionBytes written per frame, false on error
+		bool Create(size_t regionBytes);
+
+		// Frees the buffer, also done by the destructor
+		void Destroy();
+
+		// Moves to the next region, waiting for the GPU to finish with it if need be. Returns where to write.
+		void* BeginWrite();
+
+		// Call once the draws reading the current region have been issued
+		void EndFrame();
+
+		GLuint GetBuffer() const { return m_buffer; }
+
+		// Byte offset of the region last returned by BeginWrite, for binding
+		size_t GetRegionOffset() const { return m_region * m_regionBytes; }
+
+	private:
+		GLuint m_buffer{ 0 };
+		unsigned char* m_mapped{ nullptr };
+		size_t m_regionBytes{ 0 };
+		unsigned int m_region{ kNumRegions - 1 };
+		GLsync m_fences[kNumRegions]{};
+	};
+}
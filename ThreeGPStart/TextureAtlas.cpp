@@ -0,0 +1,177 @@
+#include "TextureAtlas.h"
+
+#include <algorithm>
+#include <cstring>
+
+// The IMGUI build has its own copy of the packer, static in imgui_draw.cpp, so this one is static here
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imstb_rectpack.h"
+
+namespace Helpers
+{
+	struct TextureAtlas::Layer
+	{
+		stbrp_context context;
+		std::vector<stbrp_node> nodes;
+	};
+
+	TextureAtlas::TextureAtlas(const AtlasSettings& settings) : m_settings(settings)
+	{
+		while ((1 << m_numLevels) <= m_settings.padding && (m_settings.layerSize >> m_numLevels) > 0)
+			m_numLevels++;
+	}
+
+	TextureAtlas::~TextureAtlas()
+	{
+		glDeleteTextures(1, &m_texture);
+	}
+
+	bool TextureAtlas::Accepts(int width, int height) const
+	{
+		// Packed with padding, rounded up to the alignment Add gives each rect
+		const int alignment{ 1 << (m_numLevels - 1) };
+		const int packedWidth{ (width + m_settings.padding * 2 + alignment - 1) / alignment * alignment };
+		const int packedHeight{ (height + m_settings.padding * 2 + alignment - 1) / alignment * alignment };
+		return width > 0 && height > 0 && width <= m_settings.maxEntrySize && height <= m_settings.maxEntrySize &&
+			packedWidth <= m_settings.layerSize && packedHeight <= m_settings.layerSize;
+	}
+
+	// Packs the requests together, larger first, into the existing layers and then new ones
+	std::vector<AtlasEntry> TextureAtlas::Add(const std::vector<Request>& requests)
+	{
+		// One rect per image not already packed, the same key twice in one batch is packed once. Sizes are rounded up so
+		// every rect starts on a texel of the smallest mip, where its neighbours would otherwise share texels with it.
+		const int alignment{ 1 << (m_numLevels - 1) };
+		const auto aligned{ [alignment](int size) { return (size + alignment - 1) / alignment * alignment; } };
+		std::vector<stbrp_rect> rects;
+		std::unordered_map<std::string, size_t> firstRequest;
+		for (size_t i = 0; i < requests.size(); i++)
+		{
+			const ImageLoader* image{ requests[i].image };
+			if (!m_entries.count(requests[i].key) && image && image->GetData() && Accepts(image->Width(), image->Height()) &&
+				firstRequest.insert({ requests[i].key, i }).second)
+			{
+				stbrp_rect rect{};
+				rect.id = (int)i;
+				rect.w = (stbrp_coord)aligned(image->Width() + m_settings.padding * 2);
+				rect.h = (stbrp_coord)aligned(image->Height() + m_settings.padding * 2);
+				rects.push_back(rect);
+			}
+		}
+
+		// Each layer takes what it can, whatever is left over goes on to the next, then to new layers
+		std::vector<std::pair<int, stbrp_rect>> placed;
+		for (size_t layer = 0; !rects.empty(); layer++)
+		{
+			const bool newLayer{ layer == m_layers.size() };
+			if (newLayer)
+				AddLayer();
+
+			stbrp_pack_rects(&m_layers[layer]->context, rects.data(), (int)rects.size());
+
+			std::vector<stbrp_rect> remaining;
+			for (const stbrp_rect& rect : rects)
+			{
+				if (rect.was_packed)
+					placed.push_back({ (int)layer, rect });
+				else
+					remaining.push_back(rect);
+			}
+
+			// Accepts means anything fits an empty layer, this only guards against looping forever
+			if (newLayer && remaining.size() == rects.size())
+				break;
+			rects.swap(remaining);
+		}
+
+		// Each image with its padding filled by wrapping round, as GL_REPEAT would read past its edges
+		const int padding{ m_settings.padding };
+		const float layerSize{ (float)m_settings.layerSize };
+		std::vector<unsigned char> padded;
+		glBindTexture(GL_TEXTURE_2D_ARRAY, m_texture);
+		for (const auto& [packedLayer, rect] : placed)
+		{
+			const Request& request{ requests[rect.id] };
+			const int width{ request.image->Width() };
+			const int height{ request.image->Height() };
+			const unsigned char* source{ request.image->GetData() };
+
+			padded.resize((size_t)rect.w * rect.h * 4);
+			for (int y = 0; y < rect.h; y++)
+			{
+				const int sourceY{ ((y - padding) % height + height) % height };
+				for (int x = 0; x < rect.w; x++)
+				{
+					const int sourceX{ ((x - padding) % width + width) % width };
+					std::memcpy(&padded[((size_t)y * rect.w + x) * 4], source + ((size_t)sourceY * width + sourceX) * 4, 4);
+				}
+			}
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, rect.x, rect.y, packedLayer, rect.w, rect.h, 1, GL_RGBA, GL_UNSIGNED_BYTE, padded.data());
+
+			AtlasEntry entry;
+			entry.layer = packedLayer;
+			entry.rect = glm::vec4((rect.x + padding) / layerSize, (rect.y + padding) / layerSize, width / layerSize, height / layerSize);
+			m_entries[request.key] = entry;
+			m_usedTexels += (size_t)rect.w * rect.h;
+		}
+
+		// Mips for every layer again, only the regions just written change
+		if (!placed.empty())
+			glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+		std::vector<AtlasEntry> entries(requests.size());
+		for (size_t i = 0; i < requests.size(); i++)
+		{
+			auto packed{ m_entries.find(requests[i].key) };
+			if (packed != m_entries.end())
+				entries[i] = packed->second;
+		}
+		return entries;
+	}
+
+	// Grows the array by one empty layer, copying the existing layers across
+	void TextureAtlas::AddLayer()
+	{
+		std::unique_ptr<Layer> layer{ std::make_unique<Layer>() };
+		layer->nodes.resize(m_settings.layerSize);
+		stbrp_init_target(&layer->context, m_settings.layerSize, m_settings.layerSize, layer->nodes.data(), (int)layer->nodes.size());
+		m_layers.push_back(std::move(layer));
+
+		GLuint texture{ 0 };
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexStorage3D(GL_TEXTURE_2D_ARRAY, m_numLevels, GL_RGBA8, m_settings.layerSize, m_settings.layerSize, (GLsizei)m_layers.size());
+
+		if (m_texture)
+		{
+			for (int level = 0; level < m_numLevels; level++)
+			{
+				const int size{ std::max(1, m_settings.layerSize >> level) };
+				glCopyImageSubData(m_texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+					size, size, (GLsizei)m_layers.size() - 1);
+			}
+			glDeleteTextures(1, &m_texture);
+		}
+		m_texture = texture;
+	}
+
+	// Fraction of the layers' area holding entries, padding included
+	float TextureAtlas::GetOccupancy() const
+	{
+		if (m_layers.empty())
+			return 0.0f;
+		return (float)m_usedTexels / ((float)m_settings.layerSize * m_settings.layerSize * m_layers.size());
+	}
+
+	std::string TextureAtlas::ToString() const
+	{
+		return "Atlas layers: " + std::to_string(m_layers.size()) + " Textures: " + std::to_string(m_entries.size()) +
+			" Occupancy: " + std::to_string((int)(GetOccupancy() * 100.0f)) + "%";
+	}
+}
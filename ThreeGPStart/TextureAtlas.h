@@ -0,0 +1,88 @@
+#pragma once
+// Packs small textures into the layers of one texture array, so everything using them shares a single bind
+
+#include "ExternalLibraryHeaders.h"
+#include "ImageLoader.h"
+
+#include <memory>
+#include <unordered_map>
+
+namespace Helpers
+{
+	struct AtlasSettings
+	{
+		// Width and height of every layer
+		int layerSize{ 2048 };
+
+		// Larger textures are left to be textures of their own
+		int maxEntrySize{ 512 };
+
+		// Texels round each entry filled by wrapping it, so filtering and the smaller mips do not reach its neighbours.
+		// The array has only as many mips as the padding covers, log2(padding) + 1, and a power of 2 is best.
+		int padding{ 8 };
+	};
+
+	// Where a texture was packed. rect.xy is its corner and rect.zw its size in the layer's texture coordinates,
+	// so a texture coordinate uv becomes rect.xy + fract(uv) * rect.zw.
+	struct AtlasEntry
+	{
+		int layer{ -1 };
+		glm::vec4 rect{ 0, 0, 1, 1 };
+
+		bool IsValid() const { return layer >= 0; }
+	};
+
+	// A GL_TEXTURE_2D_ARRAY of RGBA8 layers, grown a layer at a time as textures are added.
+	// Repeating textures still repeat if the shader wraps their coordinates within the rect as above.
+	// Adding textures and getting the array must happen on the GL thread, the array is replaced when it grows.
+	class TextureAtlas
+	{
+	public:
+		explicit TextureAtlas(const AtlasSettings& settings = AtlasSettings());
+		~TextureAtlas();
+
+		TextureAtlas(const TextureAtlas&) = delete;
+		TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+		// Whether a texture this size is packed rather than left on its own. Safe from any thread.
+		bool Accepts(int width, int height) const;
+
+		// key names the image (a canonical path, say), an image already packed under the same key is not packed again
+		struct Request
+		{
+			std::string key;
+			const ImageLoader* image{ nullptr };
+		};
+
+		// Packs the requests together, larger first, into the existing layers and then new ones.
+		// Entries are in the same order as the requests, not valid for any the atlas does not accept.
+		std::vector<AtlasEntry> Add(const std::vector<Request>& requests);
+
+		// 0 until something is added
+		GLuint GetTexture() const { return m_texture; }
+
+		int NumLayers() const { return (int)m_layers.size(); }
+		size_t NumEntries() const { return m_entries.size(); }
+
+		// Fraction of the layers' area holding entries, padding included
+		float GetOccupancy() const;
+
+		std::string ToString() const;
+
+	private:
+		// Grows the array by one empty layer, copying the existing layers across
+		void AddLayer();
+
+		AtlasSettings m_settings;
+		int m_numLevels{ 1 };
+
+		GLuint m_texture{ 0 };
+
+		// Packer state for each layer, which carries on where the last Add left off
+		struct Layer;
+		std::vector<std::unique_ptr<Layer>> m_layers;
+
+		std::unordered_map<std::string, AtlasEntry> m_entries;
+		size_t m_usedTexels{ 0 };
+	};
+}
@@ -0,0 +1,650 @@
+#include "TextureCache.h"
+#include "Hash.h"
+
+#include <algorithm>
+#include <filesystem>
+namespace fs = std::filesystem;
+
+namespace Helpers
+{
+	// Texels of one level in a source
+	struct SourceLevel
+	{
+		int width{ 0 };
+		int height{ 0 };
+		const unsigned char* data{ nullptr };
+		size_t size{ 0 };
+	};
+
+	// Levels in the source, 0 if it has none the cache can upload
+	static int NumSourceLevels(const TextureLevelSource& source)
+	{
+		if (source.prepared.compressed && !source.prepared.compressed->levels.empty())
+			return (int)source.prepared.compressed->levels.size();
+		if (source.prepared.mips && !source.prepared.mips->levels.empty())
+			return (int)source.prepared.mips->levels.size();
+		if (source.file && source.file->NumFaces() == 1)
+			return source.file->NumLevels();
+		return 0;
+	}
+
+	static SourceLevel GetSourceLevel(const TextureLevelSource& source, int level)
+	{
+		if (source.prepared.compressed)
+		{
+			const CompressedLevel& blocks{ source.prepared.compressed->levels[level] };
+			return SourceLevel{ blocks.width, blocks.height, blocks.data.data(), blocks.data.size() };
+		}
+		if (source.prepared.mips)
+		{
+			const MipLevel& mip{ source.prepared.mips->levels[level] };
+			return SourceLevel{ mip.width, mip.height, mip.data.data(), mip.data.size() };
+		}
+		const TextureFileLevel& mip{ source.file->GetLevel(0, level) };
+		return SourceLevel{ mip.width, mip.height, mip.data, mip.size };
+	}
+
+	// Records the size of each of the source's levels and the format they go up in
+	static void SetLevels(CachedTexture& texture, const TextureLevelSource& source)
+	{
+		texture.numLevels = NumSourceLevels(source);
+		texture.levels.clear();
+		for (int level = 0; level < texture.numLevels; level++)
+		{
+			const SourceLevel mip{ GetSourceLevel(source, level) };
+			texture.levels.push_back(CachedLevel{ mip.width, mip.height, mip.size });
+		}
+
+		if (source.prepared.compressed)
+		{
+			texture.internalFormat = BlockInternalFormat(source.prepared.compressed->format);
+			texture.isCompressed = true;
+		}
+		else if (source.file && !source.prepared.mips)
+		{
+			texture.internalFormat = source.file->InternalFormat();
+			texture.uploadFormat = source.file->UploadFormat();
+			texture.isCompressed = source.file->IsCompressed();
+		}
+	}
+
+	// A source read again must give the levels the texture was made with, a file changed on disk since will not
+	static bool MatchesLevels(const CachedTexture& texture, const TextureLevelSource& source)
+	{
+		if (NumSourceLevels(source) != texture.numLevels)
+			return false;
+
+		CachedTexture read;
+		SetLevels(read, source);
+		if (read.internalFormat != texture.internalFormat || read.uploadFormat != texture.uploadFormat)
+			return false;
+		for (int level = 0; level < texture.numLevels; level++)
+		{
+			if (read.levels[level].width != texture.levels[level].width || read.levels[level].height != texture.levels[level].height ||
+				read.levels[level].bytes != texture.levels[level].bytes)
+				return false;
+		}
+		return true;
+	}
+
+	// Bytes of the levels from firstLevel down
+	static size_t GetLevelBytes(const CachedTexture& texture, int firstLevel)
+	{
+		size_t bytes{ 0 };
+		for (int level = firstLevel; level < texture.numLevels; level++)
+			bytes += texture.levels[level].bytes;
+		return bytes;
+	}
+
+	// Uploads a source level into level destLevel of the bound texture
+	static void UploadSourceLevel(const CachedTexture& texture, const TextureLevelSource& source, int level, int destLevel)
+	{
+		const SourceLevel mip{ GetSourceLevel(source, level) };
+		if (texture.isCompressed)
+			glCompressedTexSubImage2D(GL_TEXTURE_2D, destLevel, 0, 0, mip.width, mip.height, texture.internalFormat, (GLsizei)mip.size, mip.data);
+		else
+			glTexSubImage2D(GL_TEXTURE_2D, destLevel, 0, 0, mip.width, mip.height, texture.uploadFormat, GL_UNSIGNED_BYTE, mip.data);
+	}
+
+	// First level of streamingTailSize texels or fewer, the levels that stay on the GPU. 0 when not streaming.
+	static int ChooseTailLevel(const CachedTexture& texture, const TextureCacheSettings& settings)
+	{
+		int tailLevel{ 0 };
+		if (!settings.streaming)
+			return tailLevel;
+
+		for (; tailLevel < texture.numLevels - 1; tailLevel++)
+		{
+			if (std::max(texture.levels[tailLevel].width, texture.levels[tailLevel].height) <= settings.streamingTailSize)
+				break;
+		}
+		return tailLevel;
+	}
+
+	// Builds the mips and compresses them as the settings ask
+	static PreparedTexture PrepareImage(const ImageLoader& image, const TextureCacheSettings& settings)
+	{
+		PreparedTexture prepared;
+		if (!image.GetData() || (!settings.cpuMips && !settings.compress))
+			return prepared;
+
+		std::shared_ptr<MipChain> mips{ std::make_shared<MipChain>(
+			GenerateMipChain(image.GetData(), image.Width(), image.Height(), settings.mipSettings)) };
+
+		if (settings.compress && image.Width() % 4 == 0 && image.Height() % 4 == 0)
+		{
+			const BlockFormat format{ ChooseBlockFormat(image.GetData(), image.Width(), image.Height(), settings.highQuality) };
+			prepared.compressed = std::make_shared<CompressedImage>(CompressMipChain(*mips, format));
+		}
+		else
+			prepared.mips = mips;
+
+		return prepared;
+	}
+
+	// Reads a texture's levels from its file again, on a worker, null if it cannot. An image is decoded and prepared
+	// with the same settings, which gives the same levels. A DDS / KTX2 file is mapped and the pages of the levels
+	// sharper than residentLevel touched, so they come off the disk here rather than stalling the upload.
+	static std::shared_ptr<const TextureLevelSource> ReadLevelSource(const std::string& path, bool fromFile, int residentLevel,
+		const TextureCacheSettings& settings)
+	{
+		std::shared_ptr<TextureLevelSource> source{ std::make_shared<TextureLevelSource>() };
+		if (fromFile)
+		{
+			std::shared_ptr<TextureFile> file{ std::make_shared<TextureFile>() };
+			if (!file->Load(path) || file->NumFaces() != 1)
+				return nullptr;
+
+			// A byte a page, read through volatile so the reads that fault the pages in are not optimised away
+			const size_t kPageBytes{ 4096 };
+			for (int level = 0; level < std::min(residentLevel, file->NumLevels()); level++)
+			{
+				const TextureFileLevel& mip{ file->GetLevel(0, level) };
+				const volatile unsigned char* bytes{ mip.data };
+				for (size_t offset = 0; offset < mip.size; offset += kPageBytes)
+					(void)bytes[offset];
+			}
+			source->file = file;
+		}
+		else
+		{
+			ImageLoader image;
+			if (!image.Load(path))
+				return nullptr;
+			source->prepared = PrepareImage(image, settings);
+		}
+		return source;
+	}
+
+	// The sampling every cached texture uses, on the bound texture
+	static void SetSampling()
+	{
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	}
+
+	// Mip level a width x height texture needs when stretched once across screenPixels
+	int RequiredMipLevel(int width, int height, float screenPixels)
+	{
+		// Rounded down, a level sharper than needed rather than one blurrier
+		const float texels{ (float)std::max(width, height) };
+		if (screenPixels >= texels)
+			return 0;
+		return (int)std::log2(texels / std::max(screenPixels, 1.0f));
+	}
+
+	TextureCache::~TextureCache()
+	{
+		if (m_residentCount)
+			std::cout << "Texture cache destroyed with " << m_residentCount << " textures still referenced" << std::endl;
+	}
+
+	// Path with separators, case (on Windows) and relative parts normalised
+	std::string TextureCache::CanonicalPath(const std::string& path)
+	{
+		std::string canonical{ path };
+		std::replace(canonical.begin(), canonical.end(), '\\', '/');
+
+		std::error_code error;
+		const fs::path absolute{ fs::weakly_canonical(fs::path(canonical), error) };
+		canonical = (error ? fs::path(canonical).lexically_normal() : absolute).generic_string();
+
+#if defined(_WIN32)
+		std::transform(canonical.begin(), canonical.end(), canonical.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+#endif
+		return canonical;
+	}
+
+	// The resident texture loaded from path, null if there is none
+	TextureHandle TextureCache::Find(const std::string& path)
+	{
+		const std::string canonical{ CanonicalPath(path) };
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto found{ m_byPath.find(canonical) };
+		return found == m_byPath.end() ? nullptr : found->second.lock();
+	}
+
+	// The texture for path, uploading image if neither its path nor its pixels are resident
+	TextureHandle TextureCache::Get(const std::string& path, const ImageLoader& image, PreparedTexture prepared)
+	{
+		const std::string canonical{ CanonicalPath(path) };
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_requests++;
+		if (TextureHandle texture{ FindByPath(canonical) })
+			return texture;
+
+		// Hash outside the lock, it reads every pixel
+		uint64_t contentHash{ 0 };
+		if (m_settings.hashContent && image.GetData())
+		{
+			lock.unlock();
+			const uint64_t size{ (uint64_t)image.Width() << 32 | (uint32_t)image.Height() };
+			contentHash = HashBytes(image.GetData(), (size_t)image.Width() * image.Height() * 4, HashBytes(&size, sizeof(size)));
+			lock.lock();
+
+			if (TextureHandle texture{ FindByContent(canonical, contentHash) })
+				return texture;
+		}
+
+		// Building mips and compressing take a while, lookups from other threads are not kept waiting
+		if (!prepared.mips && !prepared.compressed)
+		{
+			lock.unlock();
+			prepared = Prepare(image);
+			lock.lock();
+		}
+		CachedTexture* texture{ CreateTexture(canonical, image.Width(), image.Height(), contentHash) };
+
+		TextureLevelSource source;
+		source.prepared = prepared;
+		if (NumSourceLevels(source) > 0)
+		{
+			// The blocks go up as they are when compressed, the driver has nothing to convert.
+			// Streamed textures start with just the small levels, the rest are read again as they are asked for.
+			SetLevels(*texture, source);
+			texture->tailLevel = ChooseTailLevel(*texture, m_settings);
+			texture->residentLevel = texture->tailLevel;
+			UploadLevels(texture, source);
+		}
+		else
+		{
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.Width(), image.Height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, image.GetData());
+			glGenerateMipmap(GL_TEXTURE_2D);
+
+			// A full mip chain adds a third
+			texture->bytes = (size_t)texture->width * texture->height * 4 * 4 / 3;
+		}
+
+		return AddTexture(texture);
+	}
+
+	// The texture for a DDS or KTX2 file, its levels uploaded straight from the mapped file
+	TextureHandle TextureCache::Get(const std::string& path, const TextureFile& file)
+	{
+		if (file.NumFaces() != 1)
+		{
+			std::cout << "Texture cache only holds 2D textures, " << path << " has " << file.NumFaces() << " faces" << std::endl;
+			return nullptr;
+		}
+
+		const std::string canonical{ CanonicalPath(path) };
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_requests++;
+		if (TextureHandle texture{ FindByPath(canonical) })
+			return texture;
+
+		// The top level as stored identifies the texture, the same image in another format is another texture
+		uint64_t contentHash{ 0 };
+		if (m_settings.hashContent)
+		{
+			lock.unlock();
+			const TextureFileLevel& top{ file.GetLevel(0, 0) };
+			const uint64_t key[2]{ (uint64_t)top.width << 32 | (uint32_t)top.height, file.InternalFormat() };
+			contentHash = HashBytes(top.data, top.size, HashBytes(key, sizeof(key)));
+			lock.lock();
+
+			if (TextureHandle texture{ FindByContent(canonical, contentHash) })
+				return texture;
+		}
+
+		CachedTexture* texture{ CreateTexture(canonical, file.Width(), file.Height(), contentHash) };
+		texture->fromFile = true;
+
+		// Only the levels in the file, compressed formats cannot be relied on to have mips generated for them
+		if (file.NumLevels() == 1)
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+		// The caller's file, borrowed for the upload. Streamed it starts with just the small levels like any other,
+		// sharper ones are read from the file again as they are asked for.
+		TextureLevelSource source;
+		source.file = std::shared_ptr<const TextureFile>(&file, [](const TextureFile*) {});
+		SetLevels(*texture, source);
+		texture->tailLevel = ChooseTailLevel(*texture, m_settings);
+		texture->residentLevel = texture->tailLevel;
+		UploadLevels(texture, source);
+
+		return AddTexture(texture);
+	}
+
+	// Resident texture already loaded from this path, counting the hit
+	TextureHandle TextureCache::FindByPath(const std::string& canonical)
+	{
+		auto found{ m_byPath.find(canonical) };
+		if (found == m_byPath.end())
+			return nullptr;
+
+		TextureHandle texture{ found->second.lock() };
+		if (texture)
+			m_pathHits++;
+		return texture;
+	}
+
+	// Resident texture with these contents, remembering it for this path too
+	TextureHandle TextureCache::FindByContent(const std::string& canonical, uint64_t contentHash)
+	{
+		auto same{ m_byContent.find(contentHash) };
+		if (same == m_byContent.end())
+			return nullptr;
+
+		TextureHandle texture{ same->second.lock() };
+		if (texture)
+		{
+			m_contentHits++;
+			m_byPath[canonical] = texture;
+		}
+		return texture;
+	}
+
+	// A new texture object, bound, with the sampling every cached texture uses
+	CachedTexture* TextureCache::CreateTexture(const std::string& canonical, int width, int height, uint64_t contentHash)
+	{
+		CachedTexture* texture{ new CachedTexture };
+		texture->width = width;
+		texture->height = height;
+		texture->path = canonical;
+		texture->contentHash = contentHash;
+
+		glGenTextures(1, &texture->id);
+		glBindTexture(GL_TEXTURE_2D, texture->id);
+		SetSampling();
+		return texture;
+	}
+
+	// Hands out the first handle to an uploaded texture and makes it findable
+	TextureHandle TextureCache::AddTexture(CachedTexture* texture)
+	{
+		TextureHandle handle(texture, [this](const CachedTexture* released) { Release(const_cast<CachedTexture*>(released)); });
+		m_byPath[texture->path] = handle;
+		if (texture->contentHash)
+			m_byContent[texture->contentHash] = handle;
+		m_residentCount++;
+		m_residentBytes += texture->bytes;
+		if (texture->isCompressed)
+			m_compressedCount++;
+		if (texture->tailLevel > 0)
+			m_streamed.push_back(texture);
+		return handle;
+	}
+
+	// Storage for the levels from residentLevel down, uploaded from source
+	void TextureCache::UploadLevels(CachedTexture* texture, const TextureLevelSource& source)
+	{
+		const CachedLevel& top{ texture->levels[texture->residentLevel] };
+		glTexStorage2D(GL_TEXTURE_2D, texture->numLevels - texture->residentLevel, texture->internalFormat, top.width, top.height);
+		for (int level = texture->residentLevel; level < texture->numLevels; level++)
+			UploadSourceLevel(*texture, source, level, level - texture->residentLevel);
+		texture->bytes = GetLevelBytes(*texture, texture->residentLevel);
+	}
+
+	// Recreates the texture with levels from level down. Immutable storage cannot grow or shrink, so this is a new
+	// texture object with the levels it shares with the old one copied on the GPU. Sharper levels need the source read.
+	size_t TextureCache::SetResidentLevel(CachedTexture* texture, int level)
+	{
+		GLuint id{ 0 };
+		glGenTextures(1, &id);
+		glBindTexture(GL_TEXTURE_2D, id);
+		SetSampling();
+
+		const CachedLevel& top{ texture->levels[level] };
+		glTexStorage2D(GL_TEXTURE_2D, texture->numLevels - level, texture->internalFormat, top.width, top.height);
+
+		size_t uploaded{ 0 };
+		for (int source = level; source < texture->numLevels; source++)
+		{
+			const CachedLevel& mip{ texture->levels[source] };
+			if (source >= texture->residentLevel)
+			{
+				glCopyImageSubData(texture->id, GL_TEXTURE_2D, source - texture->residentLevel, 0, 0, 0,
+					id, GL_TEXTURE_2D, source - level, 0, 0, 0, mip.width, mip.height, 1);
+			}
+			else
+			{
+				UploadSourceLevel(*texture, *texture->source, source, source - level);
+				uploaded += mip.bytes;
+			}
+		}
+
+		glDeleteTextures(1, &texture->id);
+		texture->id = id;
+		texture->residentLevel = level;
+
+		const size_t bytes{ GetLevelBytes(*texture, level) };
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_residentBytes = m_residentBytes - texture->bytes + bytes;
+		}
+		texture->bytes = bytes;
+		return uploaded;
+	}
+
+	// Drops the sharpest level of least recently used textures until bytes more fit the budget
+	bool TextureCache::MakeRoom(size_t bytes, const CachedTexture* forTexture)
+	{
+		while (GetResidentBytes() + bytes > m_settings.streamingBudgetBytes)
+		{
+			// A texture used as recently as the one asking only gives up levels sharper than it wants
+			CachedTexture* victim{ nullptr };
+			for (CachedTexture* texture : m_streamed)
+			{
+				if (texture == forTexture || texture->residentLevel >= texture->tailLevel)
+					continue;
+				if (texture->lastUsedFrame >= forTexture->lastUsedFrame && texture->residentLevel >= texture->wantedLevel)
+					continue;
+				if (!victim || texture->lastUsedFrame < victim->lastUsedFrame)
+					victim = texture;
+			}
+
+			if (!victim)
+				return false;
+			SetResidentLevel(victim, victim->residentLevel + 1);
+		}
+		return true;
+	}
+
+	// Asks for the texture to be sharp to level this frame
+	void TextureCache::RequestLevel(const TextureHandle& handle, int level)
+	{
+		// Only the cache hands out handles and never to const textures, so the const can go
+		CachedTexture* texture{ const_cast<CachedTexture*>(handle.get()) };
+		if (!texture || texture->tailLevel == 0)
+			return;
+
+		level = std::clamp(level, 0, texture->numLevels - 1);
+		if (texture->lastUsedFrame != m_frame)
+		{
+			texture->lastUsedFrame = m_frame;
+			texture->wantedLevel = level;
+		}
+		else
+			texture->wantedLevel = std::min(texture->wantedLevel, level);
+	}
+
+	// Reads the texture's levels from its path again on the thread pool
+	void TextureCache::StartRead(CachedTexture* texture)
+	{
+		const std::string path{ texture->path };
+		const bool fromFile{ texture->fromFile };
+		const int residentLevel{ texture->residentLevel };
+		const TextureCacheSettings settings{ m_settings };
+		texture->reading = ThreadPool::Shared().Submit([path, fromFile, residentLevel, settings]() {
+			return ReadLevelSource(path, fromFile, residentLevel, settings); });
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_levelReads++;
+	}
+
+	// Starts reads for the textures asked for this frame and uploads sharper levels from those read until uploadBudget has gone
+	void TextureCache::UpdateStreaming(std::chrono::microseconds uploadBudget)
+	{
+		const auto start{ std::chrono::steady_clock::now() };
+
+		// Collects finished reads, keeping them only for textures still short of what they asked for
+		std::vector<CachedTexture*> wanting;
+		for (CachedTexture* texture : m_streamed)
+		{
+			if (texture->reading.valid() && texture->reading.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+			{
+				texture->source = texture->reading.get();
+				if (!texture->source || !MatchesLevels(*texture, *texture->source))
+				{
+					std::cout << "Texture cache could not read the levels of " << texture->path << " again, it stops streaming" << std::endl;
+					texture->source.reset();
+					texture->tailLevel = 0;
+				}
+			}
+
+			if (texture->tailLevel == 0 || texture->lastUsedFrame != m_frame || texture->wantedLevel >= texture->residentLevel)
+			{
+				texture->source.reset();
+				continue;
+			}
+
+			wanting.push_back(texture);
+			if (!texture->source && !texture->reading.valid())
+				StartRead(texture);
+		}
+
+		// Those furthest from what they asked for first
+		std::sort(wanting.begin(), wanting.end(), [](const CachedTexture* a, const CachedTexture* b) {
+			return a->residentLevel - a->wantedLevel > b->residentLevel - b->wantedLevel; });
+
+		// A level at a time, so a texture sharpens over a few frames and no one upload is the whole texture.
+		// At least one upload a frame whatever the budget.
+		bool uploaded{ false };
+		for (CachedTexture* texture : wanting)
+		{
+			if (!texture->source)
+				continue;
+			if (uploaded && std::chrono::steady_clock::now() - start >= uploadBudget)
+				break;
+
+			const int level{ texture->residentLevel - 1 };
+			if (MakeRoom(texture->levels[level].bytes, texture))
+			{
+				SetResidentLevel(texture, level);
+				uploaded = true;
+			}
+
+			// Its texels are only needed until the texture has the levels it asked for
+			if (texture->residentLevel <= texture->wantedLevel)
+				texture->source.reset();
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_streamingPending = wanting.size();
+		m_frame++;
+	}
+
+	void TextureCache::SetStreamingBudget(size_t bytes)
+	{
+		m_settings.streamingBudgetBytes = bytes;
+	}
+
+	size_t TextureCache::GetStreamedCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_streamed.size();
+	}
+
+	size_t TextureCache::GetStreamingPendingCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_streamingPending;
+	}
+
+	// Builds the mips and compresses them as the settings ask
+	PreparedTexture TextureCache::Prepare(const ImageLoader& image) const
+	{
+		return PrepareImage(image, m_settings);
+	}
+
+	// Deletes the texture and forgets every path that led to it
+	void TextureCache::Release(CachedTexture* texture)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+
+			for (auto entry{ m_byPath.begin() }; entry != m_byPath.end();)
+			{
+				if (entry->second.expired())
+					entry = m_byPath.erase(entry);
+				else
+					++entry;
+			}
+
+			// A texture with the same pixels may have been made since this one's last handle went
+			auto same{ m_byContent.find(texture->contentHash) };
+			if (same != m_byContent.end() && same->second.expired())
+				m_byContent.erase(same);
+
+			auto streamed{ std::find(m_streamed.begin(), m_streamed.end(), texture) };
+			if (streamed != m_streamed.end())
+				m_streamed.erase(streamed);
+
+			m_residentCount--;
+			m_residentBytes -= texture->bytes;
+			if (texture->isCompressed)
+				m_compressedCount--;
+		}
+
+		glDeleteTextures(1, &texture->id);
+		delete texture;
+	}
+
+	size_t TextureCache::GetResidentCount() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_residentCount;
+	}
+
+	size_t TextureCache::GetResidentBytes() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_residentBytes;
+	}
+
+	// Requests answered without an upload, as a fraction of all requests
+	float TextureCache::GetHitRate() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_requests ? (float)(m_pathHits + m_contentHits) / m_requests : 0.0f;
+	}
+
+	std::string TextureCache::ToString() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return "Textures: " + std::to_string(m_residentCount) +
+			" Compressed: " + std::to_string(m_compressedCount) +
+			" Streamed: " + std::to_string(m_streamed.size()) +
+			" Level reads: " + std::to_string(m_levelReads) +
+			" Resident: " + std::to_string(m_residentBytes / 1024) + " KB" +
+			" Requests: " + std::to_string(m_requests) +
+			" Path hits: " + std::to_string(m_pathHits) +
+			" Content hits: " + std::to_string(m_contentHits);
+	}
+}
@@ -0,0 +1,210 @@
+#pragma once
+// Uploads each texture once however many materials, mesh or models use it
+
+#include "ExternalLibraryHeaders.h"
+#include "BlockCompression.h"
+#include "ImageLoader.h"
+#include "MipGenerator.h"
+#include "TextureFile.h"
+
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace Helpers
+{
+	// The work done before a texture can be uploaded, which can be done ahead of time off the GL thread
+	struct PreparedTexture
+	{
+		std::shared_ptr<const MipChain> mips;
+		std::shared_ptr<const CompressedImage> compressed;
+	};
+
+	// Texels for a texture's levels while they go up: the levels prepared from an image, or a DDS / KTX2 file mapped in place
+	struct TextureLevelSource
+	{
+		PreparedTexture prepared;
+		std::shared_ptr<const TextureFile> file;
+	};
+
+	// Size of one level of a texture the cache uploads level by level
+	struct CachedLevel
+	{
+		int width{ 0 };
+		int height{ 0 };
+		size_t bytes{ 0 };
+	};
+
+	// A texture on the GPU along with what it was made from
+	struct CachedTexture
+	{
+		GLuint id{ 0 };
+		int width{ 0 };
+		int height{ 0 };
+
+		// On the GPU, including the mip chain
+		size_t bytes{ 0 };
+
+		// Block compressed on the GPU, by the cache or in the file it came from
+		bool isCompressed{ false };
+
+		// Canonical path it was first loaded from, and the hash of its pixels (0 if not hashed)
+		std::string path;
+		uint64_t contentHash{ 0 };
+
+		// Every level the cache uploads itself, from mips it built or a file's, and the format they go up in.
+		// Empty for textures left to glGenerateMipmap. No texels stay on the CPU once uploaded.
+		std::vector<CachedLevel> levels;
+		GLenum internalFormat{ GL_RGBA8 };
+		GLenum uploadFormat{ GL_RGBA };
+
+		// Streaming, for textures with levels above. Levels sharper than residentLevel are not on the GPU, levels from
+		// tailLevel down always are. Both are 0 for a texture that does not stream.
+		int numLevels{ 1 };
+		int residentLevel{ 0 };
+		int tailLevel{ 0 };
+
+		// Sharper levels are read from path again on the thread pool, a DDS / KTX2 file mapped or an image decoded and
+		// prepared as it first was. The source is held while the texture sharpens and dropped once it has what it asked for.
+		bool fromFile{ false };
+		std::future<std::shared_ptr<const TextureLevelSource>> reading;
+		std::shared_ptr<const TextureLevelSource> source;
+
+		// Sharpest level asked for by RequestLevel in the frame it was last used
+		int wantedLevel{ 0 };
+		uint64_t lastUsedFrame{ 0 };
+	};
+
+	struct TextureCacheSettings
+	{
+		// Also match a texture loaded from a new path against the pixels already resident
+		bool hashContent{ true };
+
+		// Build mips with GenerateMipChain, uploaded level by level, rather than glGenerateMipmap
+		bool cpuMips{ true };
+		MipSettings mipSettings;
+
+		// Block compress every level on the CPU, BC1 for opaque textures and BC3 otherwise. A quarter (BC1) or half the
+		// memory and bandwidth of RGBA8. Mips are built on the CPU for this whatever cpuMips says. Textures whose sides
+		// are not a multiple of 4 are left uncompressed.
+		bool compress{ true };
+
+		// BC7 in place of BC1 / BC3: smooth gradients band far less (about 11 dB better in the BC benchmark), noisy
+		// detail comes out no better. Slower to encode and twice the size of BC1.
+		bool highQuality{ false };
+
+		// Textures with a mip chain the cache uploads (built on the CPU or from a DDS / KTX2 file) start with only levels
+		// of streamingTailSize texels or fewer on the GPU. Sharper levels are read back from the texture's file on the
+		// thread pool and uploaded as RequestLevel asks for them while the total stays under streamingBudgetBytes, the
+		// least recently used textures giving up their sharpest levels to make room.
+		bool streaming{ true };
+		size_t streamingBudgetBytes{ 128 * 1024 * 1024 };
+		int streamingTailSize{ 64 };
+	};
+
+	// Mip level a width x height texture needs when stretched once across screenPixels
+	int RequiredMipLevel(int width, int height, float screenPixels);
+
+	// Reference counted, the texture is deleted when the last handle goes
+	using TextureHandle = std::shared_ptr<const CachedTexture>;
+
+	// Textures are found by canonical path, so "Data\Textures\a.png" and "Data/Models/../Textures/a.png" are one texture.
+	// With content hashing on a texture loaded from a new path is also matched against the pixels already resident,
+	// catching the same image copied beside several models.
+	// Lookups are safe from any thread, creating textures, dropping handles and streaming must happen on the GL thread.
+	// The cache must outlive every handle it gives out.
+	class TextureCache
+	{
+	public:
+		explicit TextureCache(const TextureCacheSettings& settings = TextureCacheSettings()) : m_settings(settings) {}
+		~TextureCache();
+
+		TextureCache(const TextureCache&) = delete;
+		TextureCache& operator=(const TextureCache&) = delete;
+
+		// Path with separators, case (on Windows) and relative parts normalised
+		static std::string CanonicalPath(const std::string& path);
+
+		// The resident texture loaded from path, null if there is none
+		TextureHandle Find(const std::string& path);
+
+		// The texture for path, uploading image if neither its path nor (when hashing) its pixels are resident.
+		// Levels prepared ahead of time (on a loading thread, say) can be passed in, otherwise they are made here if needed.
+		TextureHandle Get(const std::string& path, const ImageLoader& image, PreparedTexture prepared = PreparedTexture());
+
+		// The texture for a DDS or KTX2 file, its levels uploaded as stored with nothing decoded or copied on the way.
+		// Only files with a single face, null for cubemaps.
+		TextureHandle Get(const std::string& path, const TextureFile& file);
+
+		// Builds the mips and compresses them as the settings ask. Safe from any thread, nothing touches GL.
+		PreparedTexture Prepare(const ImageLoader& image) const;
+
+		const TextureCacheSettings& GetSettings() const { return m_settings; }
+
+		// Asks for the texture to be sharp to level this frame, the sharpest of a frame's requests is kept. Main thread only.
+		void RequestLevel(const TextureHandle& texture, int level);
+
+		// Once a frame after the requests, on the GL thread. Starts reading the sharper levels of the textures asked for
+		// and uploads those already read, furthest from what they asked for first, until uploadBudget has gone.
+		// The textures' ids change as their levels do.
+		void UpdateStreaming(std::chrono::microseconds uploadBudget);
+
+		void SetStreamingBudget(size_t bytes);
+
+		// Streamed textures, and those of them without every level they asked for
+		size_t GetStreamedCount() const;
+		size_t GetStreamingPendingCount() const;
+
+		size_t GetResidentCount() const;
+		size_t GetResidentBytes() const;
+
+		// Requests answered without an upload, as a fraction of all requests
+		float GetHitRate() const;
+
+		std::string ToString() const;
+
+	private:
+		// Lookups and creation, all with the mutex held
+		TextureHandle FindByPath(const std::string& canonical);
+		TextureHandle FindByContent(const std::string& canonical, uint64_t contentHash);
+		CachedTexture* CreateTexture(const std::string& canonical, int width, int height, uint64_t contentHash);
+		TextureHandle AddTexture(CachedTexture* texture);
+
+		// Storage for the levels from residentLevel down, uploaded from source, on the bound texture
+		void UploadLevels(CachedTexture* texture, const TextureLevelSource& source);
+
+		// Recreates the texture with levels from level down, copying the levels already on the GPU and uploading sharper
+		// ones from the texture's source. Returns bytes uploaded.
+		size_t SetResidentLevel(CachedTexture* texture, int level);
+
+		// Reads the texture's levels from its path again on the thread pool, into texture->reading
+		void StartRead(CachedTexture* texture);
+
+		// Drops the sharpest level of least recently used textures until bytes more fit the budget, false if they cannot
+		bool MakeRoom(size_t bytes, const CachedTexture* forTexture);
+
+		// Deleter for the handles
+		void Release(CachedTexture* texture);
+
+		TextureCacheSettings m_settings;
+
+		mutable std::mutex m_mutex;
+		std::unordered_map<std::string, std::weak_ptr<const CachedTexture>> m_byPath;
+		std::unordered_map<uint64_t, std::weak_ptr<const CachedTexture>> m_byContent;
+
+		// Textures that stream, and the frame RequestLevel stamps them with
+		std::vector<CachedTexture*> m_streamed;
+		uint64_t m_frame{ 1 };
+		size_t m_streamingPending{ 0 };
+		size_t m_levelReads{ 0 };
+
+		size_t m_residentCount{ 0 };
+		size_t m_residentBytes{ 0 };
+		size_t m_compressedCount{ 0 };
+		size_t m_requests{ 0 };
+		size_t m_pathHits{ 0 };
+		size_t m_contentHits{ 0 };
+	};
+}
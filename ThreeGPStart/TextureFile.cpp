@@ -0,0 +1,299 @@
+#include "TextureFile.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Helpers
+{
+	namespace
+	{
+		// How a file's format goes to GL. blockBytes is 0 for uncompressed formats, which are 4 bytes a texel.
+		// The renderer does no sRGB conversion on output so sRGB formats are read as their UNORM twins, like every other texture.
+		struct FileFormat
+		{
+			GLenum internalFormat{ 0 };
+			GLenum uploadFormat{ GL_RGBA };
+			size_t blockBytes{ 0 };
+		};
+
+		inline uint32_t Read32(const unsigned char* data)
+		{
+			uint32_t value;
+			std::memcpy(&value, data, sizeof(value));
+			return value;
+		}
+
+		inline uint64_t Read64(const unsigned char* data)
+		{
+			uint64_t value;
+			std::memcpy(&value, data, sizeof(value));
+			return value;
+		}
+
+		constexpr uint32_t FourCC(char a, char b, char c, char d)
+		{
+			return (uint32_t)(unsigned char)a | (uint32_t)(unsigned char)b << 8 | (uint32_t)(unsigned char)c << 16 | (uint32_t)(unsigned char)d << 24;
+		}
+
+		FileFormat FromDDSFourCC(uint32_t fourCC)
+		{
+			switch (fourCC)
+			{
+			case FourCC('D', 'X', 'T', '1'): return { GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 0, 8 };
+			case FourCC('D', 'X', 'T', '3'): return { GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, 0, 16 };
+			case FourCC('D', 'X', 'T', '5'): return { GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 0, 16 };
+			case FourCC('A', 'T', 'I', '1'):
+			case FourCC('B', 'C', '4', 'U'): return { GL_COMPRESSED_RED_RGTC1, 0, 8 };
+			case FourCC('B', 'C', '4', 'S'): return { GL_COMPRESSED_SIGNED_RED_RGTC1, 0, 8 };
+			case FourCC('A', 'T', 'I', '2'):
+			case FourCC('B', 'C', '5', 'U'): return { GL_COMPRESSED_RG_RGTC2, 0, 16 };
+			case FourCC('B', 'C', '5', 'S'): return { GL_COMPRESSED_SIGNED_RG_RGTC2, 0, 16 };
+			}
+			return {};
+		}
+
+		FileFormat FromDXGIFormat(uint32_t format)
+		{
+			switch (format)
+			{
+			case 28: case 29: return { GL_RGBA8, GL_RGBA, 0 };
+			case 87: case 91: return { GL_RGBA8, GL_BGRA, 0 };
+			case 71: case 72: return { GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 0, 8 };
+			case 74: case 75: return { GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, 0, 16 };
+			case 77: case 78: return { GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 0, 16 };
+			case 80: return { GL_COMPRESSED_RED_RGTC1, 0, 8 };
+			case 81: return { GL_COMPRESSED_SIGNED_RED_RGTC1, 0, 8 };
+			case 83: return { GL_COMPRESSED_RG_RGTC2, 0, 16 };
+			case 84: return { GL_COMPRESSED_SIGNED_RG_RGTC2, 0, 16 };
+			case 98: case 99: return { GL_COMPRESSED_RGBA_BPTC_UNORM, 0, 16 };
+			}
+			return {};
+		}
+
+		FileFormat FromVkFormat(uint32_t format)
+		{
+			switch (format)
+			{
+			case 37: case 43: return { GL_RGBA8, GL_RGBA, 0 };
+			case 44: case 50: return { GL_RGBA8, GL_BGRA, 0 };
+			case 131: case 132: return { GL_COMPRESSED_RGB_S3TC_DXT1_EXT, 0, 8 };
+			case 133: case 134: return { GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 0, 8 };
+			case 135: case 136: return { GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, 0, 16 };
+			case 137: case 138: return { GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 0, 16 };
+			case 139: return { GL_COMPRESSED_RED_RGTC1, 0, 8 };
+			case 140: return { GL_COMPRESSED_SIGNED_RED_RGTC1, 0, 8 };
+			case 141: return { GL_COMPRESSED_RG_RGTC2, 0, 16 };
+			case 142: return { GL_COMPRESSED_SIGNED_RG_RGTC2, 0, 16 };
+			case 145: case 146: return { GL_COMPRESSED_RGBA_BPTC_UNORM, 0, 16 };
+			}
+			return {};
+		}
+
+		// Levels in a full chain down to 1x1
+		int FullChainLevels(int width, int height)
+		{
+			int levels{ 1 };
+			while ((width | height) >> levels)
+				levels++;
+			return levels;
+		}
+
+		const unsigned char kKTX2Identifier[12]{ 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+	}
+
+	// DDS or KTX2, told apart by the file's contents
+	bool TextureFile::Load(const std::string& filepath)
+	{
+		m_levels.clear();
+		if (!m_file.Open(filepath))
+		{
+			std::cout << "Could not open texture file " << filepath << std::endl;
+			return false;
+		}
+
+		bool loaded{ false };
+		if (m_file.Size() >= 4 && Read32(m_file.Data()) == FourCC('D', 'D', 'S', ' '))
+			loaded = LoadDDS();
+		else if (m_file.Size() >= sizeof(kKTX2Identifier) && std::memcmp(m_file.Data(), kKTX2Identifier, sizeof(kKTX2Identifier)) == 0)
+			loaded = LoadKTX2();
+
+		if (!loaded)
+		{
+			std::cout << "Unsupported or damaged texture file " << filepath << std::endl;
+			m_levels.clear();
+			m_file.Close();
+		}
+		return loaded;
+	}
+
+	// True for paths ending .dds or .ktx2
+	bool TextureFile::IsTextureFile(const std::string& filepath)
+	{
+		std::string extension{ filepath.substr(std::min(filepath.size(), filepath.find_last_of('.'))) };
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+		return extension == ".dds" || extension == ".ktx2";
+	}
+
+	size_t TextureFile::DataBytes() const
+	{
+		size_t bytes{ 0 };
+		for (const TextureFileLevel& level : m_levels)
+			bytes += level.size;
+		return bytes;
+	}
+
+	size_t TextureFile::LevelBytes(int width, int height) const
+	{
+		if (m_compressed)
+			return (size_t)((width + 3) / 4) * ((height + 3) / 4) * m_blockBytes;
+		return (size_t)width * height * 4;
+	}
+
+	// Header then, after the optional DX10 header, every level of each face in turn
+	bool TextureFile::LoadDDS()
+	{
+		const size_t kHeaderBytes{ 4 + 124 };
+		const size_t kDX10HeaderBytes{ 20 };
+
+		const unsigned char* data{ m_file.Data() };
+		if (m_file.Size() < kHeaderBytes || Read32(data + 4) != 124)
+			return false;
+
+		const uint32_t flags{ Read32(data + 8) };
+		m_height = (int)Read32(data + 12);
+		m_width = (int)Read32(data + 16);
+		const uint32_t mipMapCount{ Read32(data + 28) };
+		const uint32_t pixelFlags{ Read32(data + 80) };
+		const uint32_t fourCC{ Read32(data + 84) };
+		const uint32_t caps2{ Read32(data + 112) };
+
+		if (m_width <= 0 || m_height <= 0)
+			return false;
+
+		// Volumes are not supported, cubemaps must have all six faces
+		if (caps2 & 0x200000)
+			return false;
+		m_numFaces = 1;
+		if (caps2 & 0x200)
+		{
+			if ((caps2 & 0xFC00) != 0xFC00)
+				return false;
+			m_numFaces = 6;
+		}
+
+		size_t offset{ kHeaderBytes };
+		FileFormat format;
+		if ((pixelFlags & 0x4) && fourCC == FourCC('D', 'X', '1', '0'))
+		{
+			if (m_file.Size() < kHeaderBytes + kDX10HeaderBytes)
+				return false;
+
+			const uint32_t resourceDimension{ Read32(data + kHeaderBytes + 4) };
+			const uint32_t miscFlags{ Read32(data + kHeaderBytes + 8) };
+			const uint32_t arraySize{ Read32(data + kHeaderBytes + 12) };
+			if (resourceDimension != 3 || arraySize > 1)
+				return false;
+
+			m_numFaces = miscFlags & 0x4 ? 6 : 1;
+			format = FromDXGIFormat(Read32(data + kHeaderBytes));
+			offset += kDX10HeaderBytes;
+		}
+		else if (pixelFlags & 0x4)
+			format = FromDDSFourCC(fourCC);
+		else if ((pixelFlags & 0x40) && Read32(data + 88) == 32)
+		{
+			// Uncompressed 32 bit, the masks say which way round the channels are
+			const uint32_t redMask{ Read32(data + 92) };
+			const uint32_t blueMask{ Read32(data + 100) };
+			const bool alpha{ (pixelFlags & 0x1) != 0 };
+			if (redMask == 0x000000FF && blueMask == 0x00FF0000)
+				format = { alpha ? (GLenum)GL_RGBA8 : (GLenum)GL_RGB8, GL_RGBA, 0 };
+			else if (redMask == 0x00FF0000 && blueMask == 0x000000FF)
+				format = { alpha ? (GLenum)GL_RGBA8 : (GLenum)GL_RGB8, GL_BGRA, 0 };
+		}
+
+		if (!format.internalFormat)
+			return false;
+
+		m_internalFormat = format.internalFormat;
+		m_uploadFormat = format.uploadFormat;
+		m_blockBytes = format.blockBytes;
+		m_compressed = format.blockBytes != 0;
+
+		m_numLevels = (flags & 0x20000) && mipMapCount > 0 ? (int)mipMapCount : 1;
+		m_numLevels = std::min(m_numLevels, FullChainLevels(m_width, m_height));
+
+		for (int face = 0; face < m_numFaces; face++)
+		{
+			for (int level = 0; level < m_numLevels; level++)
+			{
+				TextureFileLevel mip;
+				mip.width = std::max(1, m_width >> level);
+				mip.height = std::max(1, m_height >> level);
+				mip.size = LevelBytes(mip.width, mip.height);
+				if (offset + mip.size > m_file.Size())
+					return false;
+
+				mip.data = data + offset;
+				offset += mip.size;
+				m_levels.push_back(mip);
+			}
+		}
+		return true;
+	}
+
+	// Header and a level index giving where each level's faces are, smallest level usually first in the file
+	bool TextureFile::LoadKTX2()
+	{
+		const size_t kHeaderBytes{ 80 };
+		const size_t kLevelIndexBytes{ 24 };
+
+		const unsigned char* data{ m_file.Data() };
+		if (m_file.Size() < kHeaderBytes)
+			return false;
+
+		const FileFormat format{ FromVkFormat(Read32(data + 12)) };
+		m_width = (int)Read32(data + 20);
+		m_height = (int)Read32(data + 24);
+		const uint32_t depth{ Read32(data + 28) };
+		const uint32_t layers{ Read32(data + 32) };
+		const uint32_t faces{ Read32(data + 36) };
+		const uint32_t levels{ Read32(data + 40) };
+		const uint32_t supercompression{ Read32(data + 44) };
+
+		// Basis and zstd supercompression need decoding first, which would defeat reading the file in place
+		if (!format.internalFormat || m_width <= 0 || m_height <= 0 || depth > 0 || layers > 1 || supercompression != 0 ||
+			(faces != 1 && faces != 6))
+			return false;
+
+		m_internalFormat = format.internalFormat;
+		m_uploadFormat = format.uploadFormat;
+		m_blockBytes = format.blockBytes;
+		m_compressed = format.blockBytes != 0;
+		m_numFaces = (int)faces;
+
+		// 0 levels asks for them to be generated, only the top level is stored
+		m_numLevels = std::min(std::max(1, (int)levels), FullChainLevels(m_width, m_height));
+		if (m_file.Size() < kHeaderBytes + kLevelIndexBytes * m_numLevels)
+			return false;
+
+		m_levels.resize((size_t)m_numFaces * m_numLevels);
+		for (int level = 0; level < m_numLevels; level++)
+		{
+			const unsigned char* index{ data + kHeaderBytes + kLevelIndexBytes * level };
+			const uint64_t offset{ Read64(index) };
+			const uint64_t length{ Read64(index + 8) };
+
+			const int width{ std::max(1, m_width >> level) };
+			const int height{ std::max(1, m_height >> level) };
+			const size_t faceBytes{ LevelBytes(width, height) };
+			if (length < faceBytes * m_numFaces || offset + length > m_file.Size())
+				return false;
+
+			// A level's faces are packed one after another
+			for (int face = 0; face < m_numFaces; face++)
+				m_levels[(size_t)face * m_numLevels + level] = TextureFileLevel{ width, height, data + offset + faceBytes * face, faceBytes };
+		}
+		return true;
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+// DDS and KTX2 textures read as stored, so block compressed levels go to the GPU without being decoded first
+
+#include "ExternalLibraryHeaders.h"
+#include "MappedFile.h"
+
+namespace Helpers
+{
+	// One face of one level, pointing into the mapped file
+	struct TextureFileLevel
+	{
+		int width{ 0 };
+		int height{ 0 };
+		const unsigned char* data{ nullptr };
+		size_t size{ 0 };
+	};
+
+	// The file is memory mapped and stays mapped while this lives, its levels are never copied.
+	// Handles BC1 to BC7 (DXT1 / 3 / 5, ATI1 / 2 and the DX10 header's formats in DDS) and 32 bit RGBA / BGRA.
+	// Cubemaps and mip chains are kept, arrays and volumes are not supported.
+	// Rows are top first as stored, where ImageLoader's are bottom first, so a 2D texture from here is upside down
+	// against the same image through ImageLoader.
+	class TextureFile
+	{
+	public:
+		// DDS or KTX2, told apart by the file's contents. Returns false on error or for a layout not supported.
+		bool Load(const std::string& filepath);
+
+		// True for paths ending .dds or .ktx2, the files Load can read
+		static bool IsTextureFile(const std::string& filepath);
+
+		int Width() const { return m_width; }
+		int Height() const { return m_height; }
+
+		// 6 for a cubemap, in the order +X, -X, +Y, -Y, +Z, -Z
+		int NumFaces() const { return m_numFaces; }
+
+		// Levels stored in the file, at least 1
+		int NumLevels() const { return m_numLevels; }
+
+		// Internal format for glTexStorage2D, and whether the levels go to glCompressedTexSubImage2D
+		GLenum InternalFormat() const { return m_internalFormat; }
+		bool IsCompressed() const { return m_compressed; }
+
+		// Format and type for glTexSubImage2D when not compressed
+		GLenum UploadFormat() const { return m_uploadFormat; }
+
+		const TextureFileLevel& GetLevel(int face, int level) const { return m_levels[(size_t)face * m_numLevels + level]; }
+
+		// Bytes of texel data over every face and level
+		size_t DataBytes() const;
+
+	private:
+		bool LoadDDS();
+		bool LoadKTX2();
+
+		// Size of a level's face in this format
+		size_t LevelBytes(int width, int height) const;
+
+		MappedFile m_file;
+
+		int m_width{ 0 };
+		int m_height{ 0 };
+		int m_numFaces{ 1 };
+		int m_numLevels{ 1 };
+
+		GLenum m_internalFormat{ 0 };
+		GLenum m_uploadFormat{ GL_RGBA };
+		bool m_compressed{ false };
+		size_t m_blockBytes{ 0 };
+
+		// Face major, every level of face 0 then every level of face 1
+		std::vector<TextureFileLevel> m_levels;
+	};
+}
@@ -0,0 +1,117 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+namespace Helpers
+{
+	ThreadPool::ThreadPool(unsigned int numThreads)
+	{
+		if (numThreads == 0)
+			numThreads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+
+		for (unsigned int i = 0; i < numThreads; i++)
+			m_workers.emplace_back([this]() { WorkerLoop(); });
+	}
+
+	// Finishes any queued tasks then joins the workers
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stopping = true;
+		}
+		m_wake.notify_all();
+
+		for (std::thread& worker : m_workers)
+			worker.join();
+	}
+
+	void ThreadPool::Enqueue(std::function<void()> task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_tasks.push_back(std::move(task));
+		}
+		m_wake.notify_one();
+	}
+
+	void ThreadPool::WorkerLoop()
+	{
+		for (;;)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_wake.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+				if (m_tasks.empty())
+					return;
+
+				task = std::move(m_tasks.front());
+				m_tasks.pop_front();
+			}
+			task();
+		}
+	}
+
+	// Chunks are claimed from a shared counter so fast threads take more of them.
+	// Helpers that start after the last chunk has gone simply return.
+	void ThreadPool::ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& body)
+	{
+		if (count == 0)
+			return;
+
+		grainSize = std::max(grainSize, (size_t)1);
+		const size_t numChunks{ (count + grainSize - 1) / grainSize };
+		if (numChunks == 1 || m_workers.empty())
+		{
+			body(0, count);
+			return;
+		}
+
+		struct SharedState
+		{
+			std::atomic<size_t> nextChunk{ 0 };
+			std::atomic<size_t> chunksDone{ 0 };
+			std::mutex mutex;
+			std::condition_variable finished;
+		};
+		auto state{ std::make_shared<SharedState>() };
+
+		// body outlives every chunk as the caller waits for them all, helpers arriving late never touch it
+		const std::function<void(size_t, size_t)>* bodyPtr{ &body };
+		auto runChunks{ [state, bodyPtr, count, grainSize, numChunks]()
+		{
+			for (;;)
+			{
+				const size_t chunk{ state->nextChunk.fetch_add(1) };
+				if (chunk >= numChunks)
+					return;
+
+				const size_t begin{ chunk * grainSize };
+				(*bodyPtr)(begin, std::min(begin + grainSize, count));
+
+				if (state->chunksDone.fetch_add(1) + 1 == numChunks)
+				{
+					std::lock_guard<std::mutex> lock(state->mutex);
+					state->finished.notify_all();
+				}
+			}
+		} };
+
+		const size_t numHelpers{ std::min((size_t)m_workers.size(), numChunks - 1) };
+		for (size_t i = 0; i < numHelpers; i++)
+			Enqueue(runChunks);
+
+		runChunks();
+
+		std::unique_lock<std::mutex> lock(state->mutex);
+		state->finished.wait(lock, [&state, numChunks]() { return state->chunksDone.load() == numChunks; });
+	}
+
+	// Pool shared by the helpers, created on first use
+	ThreadPool& ThreadPool::Shared()
+	{
+		static ThreadPool pool;
+		return pool;
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+// A fixed set of worker threads for splitting CPU work across cores
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Helpers
+{
+	class ThreadPool
+	{
+	public:
+		// numThreads of 0 uses one per hardware thread, less one for the thread that hands out the work
+		explicit ThreadPool(unsigned int numThreads = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		// Number of worker threads, not counting callers
+		unsigned int NumThreads() const { return (unsigned int)m_workers.size(); }
+
+		// Runs task on a worker, the future holds its result (or exception)
+		template<typename Task>
+		auto Submit(Task&& task) -> std::future<decltype(task())>
+		{
+			using Result = decltype(task());
+			auto packaged{ std::make_shared<std::packaged_task<Result()>>(std::forward<Task>(task)) };
+			std::future<Result> future{ packaged->get_future() };
+			Enqueue([packaged]() { (*packaged)(); });
+			return future;
+		}
+
+		// Splits [0, count) into chunks of grainSize and calls body(begin, end) for each across the workers.
+		// The calling thread works too and the call returns once every chunk is done, so it is safe to call from a worker.
+		void ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& body);
+
+		// Pool shared by the helpers, created on first use
+		static ThreadPool& Shared();
+
+	private:
+		std::vector<std::thread> m_workers;
+		std::deque<std::function<void()>> m_tasks;
+		std::mutex m_mutex;
+		std::condition_variable m_wake;
+		bool m_stopping{ false };
+
+		void Enqueue(std::function<void()> task);
+		void WorkerLoop();
+	};
+}
@@ -0,0 +1,65 @@
+#include "UploadQueue.h"
+
+namespace Helpers
+{
+	UploadQueue::UploadQueue()
+	{
+		Node* stub{ new Node() };
+		m_head.store(stub, std::memory_order_relaxed);
+		m_tail = stub;
+	}
+
+	// Any jobs still queued are dropped without running
+	UploadQueue::~UploadQueue()
+	{
+		std::function<void()> job;
+		while (TryPop(job))
+			;
+		delete m_tail;
+	}
+
+	// Queues a job, safe from any thread
+	void UploadQueue::Push(std::function<void()> job)
+	{
+		Node* node{ new Node() };
+		node->job = std::move(job);
+		m_pending.fetch_add(1, std::memory_order_relaxed);
+
+		// Between the exchange and the store the node is unreachable, the consumer just sees an empty queue until it is linked
+		Node* previous{ m_head.exchange(node, std::memory_order_acq_rel) };
+		previous->next.store(node, std::memory_order_release);
+	}
+
+	bool UploadQueue::TryPop(std::function<void()>& job)
+	{
+		Node* next{ m_tail->next.load(std::memory_order_acquire) };
+		if (!next)
+			return false;
+
+		// next becomes the new stub once its job is taken
+		job = std::move(next->job);
+		delete m_tail;
+		m_tail = next;
+		m_pending.fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	// Runs queued jobs until the queue is empty or the budget has been used
+	size_t UploadQueue::Drain(std::chrono::microseconds budget)
+	{
+		const auto start{ std::chrono::high_resolution_clock::now() };
+		size_t jobsRun{ 0 };
+
+		std::function<void()> job;
+		while (TryPop(job))
+		{
+			job();
+			jobsRun++;
+
+			if (std::chrono::high_resolution_clock::now() - start >= budget)
+				break;
+		}
+
+		return jobsRun;
+	}
+}
@@ -0,0 +1,46 @@
+#pragma once
+// Hands GL work from loader threads to the main thread, which owns the GL context
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+
+namespace Helpers
+{
+	// Lock-free multiple producer, single consumer queue of jobs (Vyukov's intrusive MPSC queue).
+	// Any thread may Push, only the thread with the GL context may Drain.
+	class UploadQueue
+	{
+	public:
+		UploadQueue();
+		~UploadQueue();
+
+		UploadQueue(const UploadQueue&) = delete;
+		UploadQueue& operator=(const UploadQueue&) = delete;
+
+		// Queues a job, safe from any thread
+		void Push(std::function<void()> job);
+
+		// Runs queued jobs in order until the queue is empty or budget has been used. At least one job runs if any are queued
+		// so a slow job cannot stall the queue. Returns the number run. Main thread only.
+		size_t Drain(std::chrono::microseconds budget);
+
+		// Jobs pushed but not yet run
+		size_t Pending() const { return m_pending.load(std::memory_order_relaxed); }
+
+	private:
+		struct Node
+		{
+			std::function<void()> job;
+			std::atomic<Node*> next{ nullptr };
+		};
+
+		// Producers swap themselves in at the head, the consumer follows next pointers from the tail.
+		// The tail is always a stub whose job has already been taken.
+		std::atomic<Node*> m_head;
+		Node* m_tail;
+		std::atomic<size_t> m_pending{ 0 };
+
+		bool TryPop(std::function<void()>& job);
+	};
+}
@@ -38,13 +38,94 @@
 
 #include "Helper.h"
 #include "Simulation.h"
+#include "Meshlet.h"
+#include "Skinning.h"
+#include "MipGenerator.h"
+#include "BlockCompression.h"
+#include "ImageSampler.h"
+#include "PixelConvert.h"
+#include "Animation.h"
+#include "AnimationCompression.h"
+#include "GeometryPool.h"
 
 // Note: you should not need to edit any of this
-int main()
+int main(int argc, char* argv[])
 {	
 	// Allows cout to go to the output pane in Visual Studio rather than have to open a console window
 	RedirectStandardOuput();
 
+	// Headless CPU benchmarks, no window is needed. --capture-every N saves every Nth frame of the run to Captures,
+	// for comparing runs image by image.
+	unsigned int captureInterval{ 0 };
+	for (int arg = 1; arg < argc; arg++)
+	{
+		if (std::string(argv[arg]) == "--capture-every" && arg + 1 < argc)
+			captureInterval = (unsigned int)std::max(std::atoi(argv[++arg]), 1);
+
+		if (std::string(argv[arg]) == "--benchmark-skinning")
+		{
+			const Helpers::SkinningBenchmarkResult result{ Helpers::BenchmarkSkinning() };
+			std::cout << result.ToString() << std::endl;
+			return result.Passed() ? 0 : 1;
+		}
+
+		if (std::string(argv[arg]) == "--benchmark-meshlets")
+		{
+			const Helpers::MeshletBenchmarkResult result{ Helpers::BenchmarkMeshlets() };
+			std::cout << result.ToString() << std::endl;
+			return result.Passed() ? 0 : 1;
+		}
+
+		if (std::string(argv[arg]) == "--benchmark-animation")
+		{
+			const Helpers::AnimationBenchmarkResult result{ Helpers::BenchmarkAnimation() };
+			std::cout << result.ToString() << std::endl;
+			return result.Passed() ? 0 : 1;
+		}
+
+		if (std::string(argv[arg]) == "--benchmark-compression")
+		{
+			const Helpers::ClipCompressionBenchmarkResult result{ Helpers::BenchmarkClipCompression() };
+			std::cout << result.ToString() << std::endl;
+			return result.Passed() ? 0 : 1;
+		}
+
+		if (std::string(argv[arg]) == "--benchmark-mips")
+		{
+			const Helpers::MipBenchmarkResult result{ Helpers::BenchmarkMips() };
+			std::cout << result.ToString() << std::endl;
+			return result.Passed() ? 0 : 1;
+		}
+
+		if (std::string(argv[arg]) == "--benchmark-bc")
+		{
+			const Helpers::BlockCompressionBenchmarkResult result{ Helpers::BenchmarkBlockCompression() };
+			std::cout << result.ToString() << std::endl;
+			return result.Passed() ? 0 : 1;
+		}
+
+		if (std::string(argv[arg]) == "--benchmark-sampler")
+		{
+			const Helpers::SamplerBenchmarkResult result{ Helpers::BenchmarkSampler() };
+			std::cout << result.ToString() << std::endl;
+			return result.Passed() ? 0 : 1;
+		}
+
+		if (std::string(argv[arg]) == "--benchmark-allocator")
+		{
+			const Helpers::RangeAllocatorBenchmarkResult result{ Helpers::BenchmarkRangeAllocator() };
+			std::cout << result.ToString() << std::endl;
+			return result.Passed() ? 0 : 1;
+		}
+
+		if (std::string(argv[arg]) == "--benchmark-pixels")
+		{
+			const Helpers::PixelConversionBenchmarkResult result{ Helpers::BenchmarkPixelConversion() };
+			std::cout << result.ToString() << std::endl;
+			return result.Passed() ? 0 : 1;
+		}
+	}
+
 	// Use the provided helper function to set up GLFW, GLEW and OpenGL
 	GLFWwindow* window{ Helpers::CreateGLFWWindow(1280, 720, "3GP Framework") };
 	if (!window)
@@ -61,6 +142,9 @@ int main()
 		
 	glfwSetInputMode(window, GLFW_STICKY_KEYS, GLFW_TRUE);
 
+	if (captureInterval)
+		simulation.CaptureFrames("Captures/Frame", captureInterval);
+
 	// Enter main GLFW loop until the user closes the window
 	while (!glfwWindowShouldClose(window))
 	{				